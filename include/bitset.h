@@ -0,0 +1,73 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Fixed-size bitsets over 64-bit words, one bit per member slot. Single
+ * bits are set and cleared with atomic read-modify-writes, since member
+ * steps running on different threads may touch the same word; the
+ * queries are plain reads for the thread that owns the gang.
+ */
+
+#define BITSET_WORD_BITS 64
+#define BITSET_WORDS(bits) (((bits) + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS)
+
+static inline bool bitset_test(const uint64_t *set, int bit) {
+    return (__atomic_load_n(&set[bit / BITSET_WORD_BITS], __ATOMIC_RELAXED) >> (bit % BITSET_WORD_BITS)) & 1;
+}
+
+static inline void bitset_set(uint64_t *set, int bit) {
+    __atomic_fetch_or(&set[bit / BITSET_WORD_BITS], 1ULL << (bit % BITSET_WORD_BITS), __ATOMIC_RELAXED);
+}
+
+static inline void bitset_clear(uint64_t *set, int bit) {
+    __atomic_fetch_and(&set[bit / BITSET_WORD_BITS], ~(1ULL << (bit % BITSET_WORD_BITS)), __ATOMIC_RELAXED);
+}
+
+static inline void bitset_assign(uint64_t *set, int bit, bool value) {
+    if (value) {
+        bitset_set(set, bit);
+    } else {
+        bitset_clear(set, bit);
+    }
+}
+
+/* Mask of the bits of word that lie below limit */
+static inline uint64_t bitset_word_limit(int word, int limit) {
+    int bits = limit - word * BITSET_WORD_BITS;
+    if (bits >= BITSET_WORD_BITS) {
+        return ~0ULL;
+    }
+    return bits <= 0 ? 0 : (1ULL << bits) - 1;
+}
+
+/* Bits below limit set in include and clear in exclude */
+static inline int bitset_count_and_not(const uint64_t *include, const uint64_t *exclude, int limit) {
+    int count = 0;
+    for (int w = 0; w < BITSET_WORDS(limit); w++) {
+        count += __builtin_popcountll(include[w] & ~exclude[w] & bitset_word_limit(w, limit));
+    }
+    return count;
+}
+
+/* The rank-th (from 0) bit below limit set in include and clear in
+ * exclude, or -1; whole words are skipped by their popcount */
+static inline int bitset_select_and_not(const uint64_t *include, const uint64_t *exclude, int limit, int rank) {
+    for (int w = 0; w < BITSET_WORDS(limit); w++) {
+        uint64_t word = include[w] & ~exclude[w] & bitset_word_limit(w, limit);
+        int count = __builtin_popcountll(word);
+        if (rank >= count) {
+            rank -= count;
+            continue;
+        }
+        while (rank-- > 0) {
+            word &= word - 1;  // Drop the lowest set bit
+        }
+        return w * BITSET_WORD_BITS + __builtin_ctzll(word);
+    }
+    return -1;
+}
+
+#endif /* BITSET_H */
@@ -0,0 +1,69 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "common.h"
+#include "police.h"
+
+/*
+ * Checkpoints of a running simulation. The file is a header followed by
+ * an image of the shared segment at the segment's own offsets (page
+ * aligned, so the image can be mapped as is) and the police tables.
+ *
+ * Taking one never stops the world: once the monitor asks for it, every
+ * gang copies its own slice of the segment at the end of its next tick,
+ * under the lock it already holds, and the police copies its tables at
+ * the end of its next tick. Each part is consistent on its own; parts
+ * are at most a tick apart. Messages still in flight are not saved.
+ * The outcome counters of the image are summed from the parts (each
+ * gang's missions and executions, the police's thwarted plans and
+ * discoveries), so they always agree with the tables next to them.
+ *
+ * Restoring maps the file and copies the image back into a fresh
+ * segment before any actor starts. Locks, events and channels are
+ * recreated rather than restored. A run restored without a seed, or
+ * with the master seed of the checkpoint, continues its random streams;
+ * any other seed reseeds every stream, so many runs can branch off one
+ * checkpoint.
+ */
+
+#define CHECKPOINT_MAGIC "SIMCHKPT"
+#define CHECKPOINT_VERSION 5
+#define CHECKPOINT_DEFAULT_AT 60.0f /* Simulated seconds of warm-up */
+
+typedef struct {
+    char magic[8];            /* CHECKPOINT_MAGIC, without the terminator */
+    uint32_t version;
+    uint32_t complete;        /* Set once every part is in */
+    uint32_t requested;       /* Set by the monitor; the actors then save their parts */
+    uint32_t parts_expected;  /* Every gang plus the police */
+    uint32_t parts_done;
+    int32_t agent_count;      /* Police agent table in use */
+    int32_t thwarted_plans;   /* total_thwarted_plans when the police saved its part */
+    uint64_t segment_offset;  /* Page-aligned image of the shared segment */
+    uint64_t police_offset;   /* SecretAgent[agent_capacity], GangIntelligence[gangs], int[agent_capacity] */
+    uint64_t file_size;
+    uint64_t master_seed;
+    int64_t sim_origin;       /* Simulated clock the run started at (seconds) */
+    double sim_elapsed;       /* Simulated seconds into the run at the request */
+    SharedLayout layout;
+    RngStream police_rng;
+} __attribute__((aligned(64))) CheckpointHeader;
+
+/* Writing: open before any actor starts, close after they are all gone */
+int checkpoint_open(const char *path, const SimConfig *config);
+/* Called by the monitor; returns how long it may sleep before calling again */
+long checkpoint_poll(SharedState *state, long idle_ms);
+bool checkpoint_requested(void);
+void checkpoint_save_gang(Gang *gang);
+void checkpoint_save_police(const PoliceRuntime *runtime);
+void checkpoint_close(void);
+
+/* Restoring: load before the shared state is set up, unload at the end */
+int checkpoint_load(const char *path, const SimConfig *config);
+bool checkpoint_restoring(void);
+void checkpoint_restore_state(SharedState *state);
+int checkpoint_restore_gang(SharedState *state, int gang_id);
+void checkpoint_restore_police(PoliceRuntime *runtime);
+void checkpoint_unload(void);
+
+#endif /* CHECKPOINT_H */
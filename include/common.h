@@ -15,17 +15,17 @@
 #include <time.h>
 #include <string.h>
 #include <stdbool.h>
+#include "rng.h"
+#include "event.h"
 
-/* Shared memory key definitions */
-#define SHM_KEY_BASE 9000
-#define MSG_KEY_BASE 8000
-
-/* Maximum values for various elements */
-#define MAX_GANGS 20
-#define MAX_MEMBERS 50
+/* Maximum values for various elements; gang, member, agent and mission
+ * counts are sized at runtime from SimConfig (see shared_state.h) */
 #define MAX_RANKS 10
-#define MAX_AGENTS 50
-#define MAX_CONCURRENT_MISSIONS 5
+#define DEFAULT_MAX_CONCURRENT_MISSIONS 5
+
+/* Each gang's member slots are padded to a whole number of SIMD lanes */
+#define MEMBER_LANE_PAD 8
+#define MEMBER_CAPACITY(count) (((count) + MEMBER_LANE_PAD - 1) & ~(MEMBER_LANE_PAD - 1))
 
 /* Message types for inter-process communication */
 #define MSG_TYPE_GANG_REPORT 1
@@ -75,9 +75,32 @@ typedef enum
     SIM_STATUS_POLICE_WIN,
     SIM_STATUS_GANGS_WIN,
     SIM_STATUS_AGENTS_LOST,
+    SIM_STATUS_TIME_LIMIT, /* Ran for max_sim_seconds */
     SIM_STATUS_SHUTDOWN
 } SimulationStatus;
 
+/* How gangs and police are run */
+typedef enum
+{
+    EXECUTION_MODE_PROCESS,   /* One forked process per gang plus one for the police */
+    EXECUTION_MODE_INPROCESS  /* Everything in one process, gangs sharded over threads */
+} ExecutionMode;
+
+/* How agent reports, police orders and status messages travel */
+typedef enum
+{
+    MESSAGE_TRANSPORT_QUEUE, /* One System V (or in-memory) queue shared by everyone */
+    MESSAGE_TRANSPORT_RINGS  /* Lock-free rings inside the shared state */
+} MessageTransport;
+
+/* How much is logged; each level includes the ones before it */
+typedef enum
+{
+    LOG_LEVEL_ERROR,   /* Failures only */
+    LOG_LEVEL_INFO,    /* Gang, mission and police events */
+    LOG_LEVEL_VERBOSE  /* Every member's arrests, releases, promotions and reports too */
+} LogLevel;
+
 /* Structure for individual missions */
 typedef struct
 {
@@ -87,8 +110,8 @@ typedef struct
     float required_preparation_level;
     bool in_progress;
     bool disrupted;
-    int assigned_members[MAX_MEMBERS]; /* Array of member indices assigned to this mission */
-    int assigned_count; /* Number of members assigned */
+    int assigned_count; /* Number of members assigned, listed by mission_assigned_members() */
+    int unprepared_count; /* Active assigned members still below required_preparation_level */
     time_t start_time;
 } Mission;
 
@@ -140,38 +163,88 @@ typedef struct
     float preparation_knowledge_factor;
     float preparation_rank_factor;
     int max_agents_per_gang;
+
+    float time_scale; /* Simulated seconds per wall second, 0 = as fast as possible */
+    bool headless;    /* Run without visualization and print a summary at the end */
+    char summary_file[256]; /* Where the headless summary goes, empty = stdout */
+    unsigned int seed; /* Random seed, 0 = seed from the clock */
+    int worker_threads; /* Member worker threads per gang, 0 = the cores shared among the gangs */
+    ExecutionMode execution_mode;
+    int shard_threads; /* Gang shard threads in in-process mode, 0 = one per core */
+    int max_concurrent_missions; /* Mission slots per gang */
+    MessageTransport message_transport;
+    LogLevel log_level;
+    char trace_file[256]; /* Binary event trace, empty = no trace */
+    long trace_capacity;  /* Records the trace file has room for */
+    char checkpoint_file[256]; /* Checkpoint taken during the run, empty = none */
+    float checkpoint_at;       /* Simulated seconds into the run the checkpoint is taken */
+    char restore_file[256];    /* Checkpoint the run starts from, empty = a fresh start */
+    int initial_raid_gang;     /* Gang the police raids as soon as it starts, -1 = none */
+    float max_sim_seconds;     /* Simulated seconds the run may last, 0 = until an end condition */
 } SimConfig;
 
-/* Structure for a gang member */
+/*
+ * Structure-of-arrays view of the members of one gang, indexed by member
+ * index. Every field points into a world-wide array in the shared state,
+ * so hot per-tick fields (preparation, knowledge, rank) are contiguous
+ * and bulk kernels can update a whole gang at once. The pointers are
+ * only valid in the process that built the view (gang_members()).
+ */
 typedef struct
 {
-    int id;
-    int gang_id;
-    int rank;
-    bool is_agent;
-    int agent_id; /* -1 if not an agent */
-    MemberStatus status;
-    int assigned_mission_id; /* ID of mission this member is assigned to, -1 if not assigned */
-    float preparation_level;
-    float knowledge_level; /* How much correct info they have about current plan */
-    time_t release_time;   /* When arrested, this indicates release time */
-    pthread_t thread_id;
-} GangMember;
+    float *preparation_level;
+    float *knowledge_level; /* How much correct info they have about current plan */
+    int *rank;
+    MemberStatus *status;
+    int *assigned_mission_id; /* ID of mission this member is assigned to, -1 if not assigned */
+    int *assigned_mission_slot; /* Where that mission sits in the gang's table, -1 if not assigned;
+                                 * the ID tells whether the slot still holds it (member_mission()) */
+    int *agent_id; /* -1 if not an agent */
+    time_t *release_time; /* When arrested, this indicates release time */
+    RngStream *rng; /* Private random stream of each member */
+    /* One bit per member, mirroring status == ACTIVE, assigned_mission_id
+     * != -1 and status == ARRESTED, plus the active members counted in
+     * their mission's unprepared_count; change members through the
+     * setters in gang.c so they stay in step */
+    uint64_t *active_bits;
+    uint64_t *assigned_bits;
+    uint64_t *arrested_bits;
+    uint64_t *unprepared_bits;
+} MemberStore;
+
+/* Copy of a gang's progress for readers outside the gang (see seqlock.h) */
+typedef struct
+{
+    int member_count;
+    int active_mission_count;
+    int successful_missions;
+    int failed_missions;
+    bool has_mission; /* The fields below describe the first live mission */
+    CrimeTarget mission_target;
+    float mission_required_preparation;
+    int mission_assigned_count;
+} GangSnapshot;
 
 /* Structure for a gang */
 typedef struct
 {
     int id;
     int member_count;
-    Mission missions[MAX_CONCURRENT_MISSIONS]; /* Array of concurrent missions */
+    int member_capacity; /* Member slots reserved for this gang */
+    int member_base; /* First slot of this gang in the member arrays */
+    int wake_slot; /* Wake event of whoever drives the gang (shared_wake_event) */
     int active_mission_count; /* Number of currently active missions */
     int next_mission_id; /* Counter for assigning unique mission IDs */
     int successful_missions;
     int failed_missions;
+    int executed_agents; /* Agents this gang executed, its share of total_executed_agents */
     pid_t process_id;
-    sem_t *member_semaphore; /* For synchronizing member threads */
-    GangMember members[MAX_MEMBERS];
-    SharedState *shared_state;
+    pthread_mutex_t lock; /* Held by the gang for a tick, and by other actors changing its members */
+    RngStream rng; /* Random stream of the gang main loop */
+    /* Published by the gang's own thread only; on its own cache line so
+     * readers polling it don't bounce the gang's working fields */
+    unsigned int snapshot_sequence __attribute__((aligned(64)));
+    GangSnapshot snapshot;
 } Gang;
 
 /* Structure for a secret agent report */
@@ -182,8 +255,18 @@ typedef struct
     CrimeTarget suspected_target;
     float confidence_level;
     time_t estimated_execution_time;
+    uint64_t sent_ns; /* CLOCK_MONOTONIC when sent, for the report-to-order latency */
 } AgentReport;
 
+/* Latest report of one agent that the full report channel turned away;
+ * a newer report replaces it until the police takes it */
+typedef struct
+{
+    unsigned int sequence; /* Seqlock of the report, written by the agent's gang */
+    unsigned int delivered; /* Sequence the police last took; equal when nothing is parked */
+    AgentReport report;
+} ReportMailbox;
+
 /* Structure for police orders */
 typedef struct
 {
@@ -204,25 +287,104 @@ typedef struct
     } data;
 } IpcMessage;
 
-/* Global shared memory structure for visualization and coordination */
+/*
+ * One message channel: a ring in the segment or a kernel queue of its
+ * own, plus the accounting of how far behind its consumer is. Every
+ * channel carries a single message type, so a receive never has to skip
+ * other actors' messages.
+ */
+typedef struct
+{
+    int queue_id; /* System V queue, -1 for a ring */
+    unsigned int capacity; /* Messages it holds before senders are turned away */
+    size_t ring_offset; /* Ring position in the segment, 0 for a queue */
+    unsigned long sent;
+    unsigned long received;
+    unsigned long rejected; /* Sends refused because the channel was full */
+    unsigned long peak_depth; /* Most messages ever waiting at once */
+} __attribute__((aligned(64))) MessageChannel;
+
+/*
+ * Where the variable-size arrays live, as byte offsets from the start of
+ * the SharedState. Fixed when the segment is created, so every process
+ * can find them wherever it maps the segment.
+ */
+typedef struct
+{
+    size_t total_size;
+    int gang_capacity;
+    int member_slots; /* Sum of every gang's member capacity */
+    int member_capacity; /* Member slots per gang */
+    int agent_capacity;
+    int missions_per_gang;
+    int mission_member_capacity; /* Member slots per mission */
+    int member_bitset_words; /* Words of each gang's member bitsets */
+    MessageTransport message_transport;
+    int channel_count; /* 0 when an in-memory queue carries the messages */
+    unsigned int report_channel_capacity; /* Messages each channel accepts before it is full */
+    unsigned int status_channel_capacity;
+    unsigned int order_channel_capacity;
+    size_t gangs_offset;
+    size_t missions_offset;
+    size_t mission_members_offset;
+    size_t agent_statuses_offset;
+    size_t wake_events_offset; /* One per gang capacity; see Gang.wake_slot */
+    size_t preparation_offset;
+    size_t knowledge_offset;
+    size_t rank_offset;
+    size_t member_status_offset;
+    size_t assigned_mission_offset;
+    size_t assigned_slot_offset;
+    size_t agent_id_offset;
+    size_t release_time_offset;
+    size_t member_rng_offset;
+    size_t active_bits_offset;
+    size_t assigned_bits_offset;
+    size_t arrested_bits_offset;
+    size_t unprepared_bits_offset;
+    size_t metrics_offset; /* MetricsHeader, then GangMetrics per gang (metrics.h) */
+    size_t gang_metrics_offset;
+    size_t agent_reports_offset; /* Reports sent by each agent */
+    size_t clock_offset; /* Virtual clock and its actors (sim_clock.h) */
+    size_t channels_offset;
+    size_t report_mailboxes_offset; /* One per agent */
+    size_t report_ring_offset; /* The rings exist with the ring transport only */
+    size_t status_ring_offset;
+    size_t order_rings_offset;
+    size_t order_ring_stride; /* Bytes from one gang's order ring to the next */
+} SharedLayout;
+
+/* Global shared memory structure for visualization and coordination.
+ * The gangs, missions, members and agent statuses follow it in the same
+ * segment; use the accessors in shared_state.h to reach them. */
 struct SharedState
 {
+    /* There is no global lock: status goes through get_simulation_status()
+     * and end_simulation(), the counters through __atomic builtins */
     SimulationStatus status;
     int gang_count;
-    int total_thwarted_plans;
-    int total_successful_plans;
-    int total_executed_agents;
-    Gang gangs[MAX_GANGS];
     int agent_count;
-    AgentStatus agent_statuses[MAX_AGENTS];
-    pthread_mutex_t status_mutex;
     int agent_execution_loss_count;
+    SharedLayout layout;
+    SimEvent police_event; /* Agent reports and counter changes */
+    SimEvent status_event; /* Changes of status */
+    /* Bumped by every actor, so kept off the line everyone polls status on */
+    int total_thwarted_plans __attribute__((aligned(64)));
+    int total_successful_plans;
+    int total_executed_agents;
+    /* What became of the agent reports (send_agent_report) */
+    unsigned long reports_delivered __attribute__((aligned(64)));
+    unsigned long reports_coalesced; /* Replaced while parked in a mailbox */
+    unsigned long reports_dropped;
+    int report_mailboxes_dirty; /* Set when a report is parked, cleared by the police scan */
 };
 
 /* Function prototypes for utility functions */
-void log_message(const char *format, ...);
 const char *get_target_name(CrimeTarget target);
 float rand_float(void);
 int rand_range(int min, int max);
 
+/* Logging needs the types above */
+#include "logger.h"
+
 #endif /* COMMON_H */
\ No newline at end of file
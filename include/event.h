@@ -0,0 +1,28 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <stdbool.h>
+#include <time.h>
+
+/*
+ * Wakeup event that can live in shared memory (futex based). Every
+ * signal bumps the sequence; a waiter remembers the sequence it last
+ * saw and sleeps until it moves or a simulated timeout expires. Signals
+ * only enter the kernel when someone is actually asleep.
+ *
+ *     seen = event_prepare(&ev);      post work, then event_signal(&ev);
+ *     ... drain pending work ...
+ *     event_wait_ms(&ev, seen, ms);
+ */
+
+typedef struct {
+    unsigned int sequence; /* Bumped by every signal; the futex word */
+    unsigned int waiters;  /* Threads asleep or about to sleep */
+} SimEvent;
+
+unsigned int event_prepare(SimEvent *event);
+bool event_wait_ms(SimEvent *event, unsigned int seen, long timeout_ms);
+bool event_wait_wall(SimEvent *event, unsigned int seen, const struct timespec *timeout);
+void event_signal(SimEvent *event);
+
+#endif /* EVENT_H */
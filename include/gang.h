@@ -1,38 +1,74 @@
-#ifndef GANG_H
-#define GANG_H
-
-#include "common.h"
-
-/* Structure for passing data to gang member threads */
-typedef struct {
-    int member_index;
-    Gang *gang;
-    SimConfig *config;
-    int msg_queue_id;
-    SharedState *shared_state;
-} GangMemberArgs;
-
-
-int gang_init(Gang *gang, int id, int member_count, SimConfig *config);
-void gang_process_main(int gang_id, SimConfig *config, int msg_queue_id, int shared_mem_id);
-
-// Multi-mission management functions
-int get_available_members_count(Gang *gang);
-int create_new_mission(Gang *gang, SimConfig *config);
-void assign_members_to_mission(Gang *gang, Mission *mission, SimConfig *config);
-void check_and_execute_ready_missions(Gang *gang, SimConfig *config, int msg_queue_id);
-bool execute_mission(Gang *gang, Mission *mission, SimConfig *config, int msg_queue_id);
-void complete_mission(Gang *gang, Mission *mission, bool success, SimConfig *config, int msg_queue_id);
-void investigate_mission_for_agents(Gang *gang, Mission *mission, SimConfig *config, int msg_queue_id);
-
-// Member and gang management functions
-void* gang_member_thread(void *arg);
-void process_arrest(Gang *gang, int duration);
-void recruit_new_members(Gang *gang, SimConfig *config);
-void promote_members(Gang *gang, SimConfig *config);
-void execute_agent(Gang *gang, int member_index, int msg_queue_id, SharedState *shared_state);
-void member_interaction(Gang *gang, int member_index, int target_index, SimConfig *config);
-void update_preparation_levels(Gang *gang, SimConfig *config);
-void gang_cleanup(Gang *gang);
-
+#ifndef GANG_H
+#define GANG_H
+
+#include "common.h"
+#include "pool.h"
+#include "social_graph.h"
+
+/* Pacing of the gang main loop and of each member's own activity (simulated ms) */
+#define GANG_TICK_MS 100
+#define MEMBER_STEP_MIN_MS 100
+#define MEMBER_STEP_MAX_MS 300
+
+/* State of a running gang owned by whoever drives it; members run as tasks */
+typedef struct GangRuntime GangRuntime;
+
+typedef struct {
+    int member_index;
+    GangRuntime *runtime;
+} MemberTask;
+
+struct GangRuntime {
+    Gang *gang;
+    SimConfig *config;
+    int msg_queue_id;
+    SharedState *shared_state;
+    WorkPool *pool;                      /* NULL runs member steps inline */
+    long long *next_step_ms;             /* Simulated time of each member's next step */
+    time_t first_knowledge_time;         /* When an agent first gained mission knowledge */
+    MemberTask *tasks;                   /* One per member slot */
+    SocialGraph graph;                   /* Who exchanges knowledge, rebuilt every tick */
+    /* Per-member scratch of the bulk kernels, one slot per member slot and
+     * aligned and padded like the member arrays; reused every tick */
+    float *scratch_mask;                 /* Lanes a kernel works on */
+    float *scratch_values;               /* Per-lane values: promotion draws, knowledge gains */
+    unsigned char *scratch_flags;        /* Per-lane results, such as promotions */
+    bool checkpointed;                   /* Already copied into the checkpoint */
+};
+
+
+int gang_init(Gang *gang, int id, int member_count, SimConfig *config);
+void gang_process_main(int gang_id, SimConfig *config, int msg_queue_id, int shared_mem_id);
+int gang_runtime_start(GangRuntime *runtime, int gang_id, SimConfig *config, int msg_queue_id,
+                       SharedState *shared_state, int num_workers);
+bool gang_tick(GangRuntime *runtime);
+void gang_lock(Gang *gang);
+void gang_handle_orders(GangRuntime *runtime);
+void gang_wait(GangRuntime *runtime, long ms);
+void gang_runtime_stop(GangRuntime *runtime);
+
+// Multi-mission management functions
+int get_available_members_count(Gang *gang);
+int create_new_mission(Gang *gang, SimConfig *config);
+void assign_members_to_mission(Gang *gang, Mission *mission, SimConfig *config);
+void update_mission_members(GangRuntime *runtime);
+void check_and_execute_ready_missions(Gang *gang, SimConfig *config, int msg_queue_id);
+bool execute_mission(Gang *gang, Mission *mission, SimConfig *config, int msg_queue_id);
+void complete_mission(Gang *gang, Mission *mission, bool success, SimConfig *config, int msg_queue_id);
+void abandon_mission(Gang *gang, Mission *mission);
+void investigate_mission_for_agents(Gang *gang, Mission *mission, SimConfig *config, int msg_queue_id);
+
+// Member and gang management functions
+void set_member_status(Gang *gang, MemberStore *ms, int member_index, MemberStatus status);
+void set_member_mission(Gang *gang, MemberStore *ms, int member_index, int slot, int mission_id);
+Mission *member_mission(Gang *gang, const MemberStore *ms, int member_index);
+void gang_member_step(void *arg);
+void schedule_member_steps(GangRuntime *runtime);
+void process_arrest(Gang *gang, int duration);
+void recruit_new_members(Gang *gang, SimConfig *config);
+void promote_members(GangRuntime *runtime);
+void execute_agent(Gang *gang, int member_index, int msg_queue_id, SharedState *shared_state);
+void diffuse_knowledge(GangRuntime *runtime);
+void gang_cleanup(Gang *gang);
+
 #endif /* GANG_H */
\ No newline at end of file
@@ -3,8 +3,17 @@
 
 #include "common.h"
 
+/* Queue ID handed out when messages go through the per-type channels of
+ * the shared state; below every in-memory queue ID, and never a valid
+ * System V ID */
+#define MESSAGE_CHANNELS_ID -1000
 
 int init_message_queue(void);
+int init_local_message_queue(void);
+int remove_message_queue(int msg_queue_id);
+void ipc_attach_state(SharedState *state);
+void remove_message_channels(SharedState *state);
+void log_channel_stats(SharedState *state);
 int create_shared_memory(size_t size);
 void* attach_shared_memory(int shm_id);
 int detach_shared_memory(void *ptr);
@@ -17,8 +26,15 @@ int send_police_order(int msg_queue_id, int gang_id, int duration);
 int send_status_update(int msg_queue_id, SimulationStatus status);
 int init_shared_mutex(pthread_mutex_t *mutex);
 int cleanup_shared_mutex(pthread_mutex_t *mutex);
-int init_shared_state(SharedState *state);
+int init_shared_state(SharedState *state, const SimConfig *config);
 int update_gang_status(SharedState *state, Gang *gang);
+int read_gang_status(SharedState *state, int gang_id, GangSnapshot *snapshot);
 int update_agent_status(SharedState *state, int agent_id, AgentStatus status);
+AgentStatus read_agent_status(SharedState *state, int agent_id);
+void notify_police(SharedState *state);
+void notify_gang(SharedState *state, int gang_id);
+SimulationStatus get_simulation_status(SharedState *state);
+void set_simulation_status(SharedState *state, SimulationStatus status);
+bool end_simulation(SharedState *state, SimulationStatus status);
 
 #endif /* IPC_H */
\ No newline at end of file
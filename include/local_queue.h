@@ -0,0 +1,25 @@
+#ifndef LOCAL_QUEUE_H
+#define LOCAL_QUEUE_H
+
+#include "common.h"
+
+/*
+ * In-memory message queues for the in-process execution mode. They keep
+ * the System V semantics the rest of the code relies on (receive the
+ * oldest message of a given mtype, or of any type when mtype is 0) but
+ * never enter the kernel on the fast path.
+ *
+ * Queue IDs are negative (<= LOCAL_QUEUE_ID_FIRST) so they can travel
+ * through the same int msg_queue_id as a System V queue ID.
+ */
+
+#define LOCAL_QUEUE_ID_FIRST -2
+#define LOCAL_QUEUE_MAX 64
+
+int local_queue_create(void);
+bool local_queue_is_local(int queue_id);
+int local_queue_send(int queue_id, const IpcMessage *message);
+int local_queue_receive(int queue_id, IpcMessage *message, long msg_type, bool no_wait);
+int local_queue_remove(int queue_id);
+
+#endif /* LOCAL_QUEUE_H */
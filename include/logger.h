@@ -0,0 +1,40 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "common.h"
+
+/*
+ * Asynchronous logger. Each thread formats its lines into a ring of its
+ * own without taking any lock; one writer thread per process drains the
+ * rings in timestamp order and writes them to stdout in batches. Lines
+ * above the current level are dropped before they are formatted, and
+ * building with -DLOG_STRIP_VERBOSE compiles log_verbose() out entirely.
+ *
+ * Anything printed to stdout directly should come after logger_flush(),
+ * so that it lands after the lines logged before it.
+ */
+
+#define LOG_LINE_MAX 256       /* Longest line, timestamp excluded */
+#define LOG_RING_ENTRIES 256   /* Lines a thread can have in flight (power of two) */
+
+void log_message(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void log_error(const char *format, ...) __attribute__((format(printf, 1, 2)));
+#ifdef LOG_STRIP_VERBOSE
+#define log_verbose(...) ((void)0)
+#else
+void log_verbose(const char *format, ...) __attribute__((format(printf, 1, 2)));
+#endif
+
+/* For signal handlers: writes "[signal N] text" straight to stdout with
+ * write(2), bypassing the rings and stdio; no timestamp, since
+ * formatting one is not async-signal-safe */
+void log_signal_safe(int sig, const char *text);
+
+void logger_set_level(LogLevel level);
+/* Block until every line logged so far is out, then flush stdout */
+void logger_flush(void);
+
+bool log_level_from_string(const char *name, LogLevel *level);
+const char *log_level_to_string(LogLevel level);
+
+#endif /* LOGGER_H */
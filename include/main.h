@@ -8,9 +8,30 @@
 #include "simulation.h"
 #include "utils.h"
 
+/* Command line overrides applied on top of the configuration file */
+typedef struct {
+    bool time_scale_set;
+    float time_scale;
+    bool headless;
+    const char *summary_file;
+    bool seed_set;
+    unsigned int seed;
+    bool in_process;
+    int shard_threads; /* 0 = keep the configured value */
+    bool rings; /* Use the shared-memory ring transport */
+    const char *trace_file; /* NULL = keep the configured trace file */
+    const char *checkpoint_file; /* NULL = keep the configured checkpoint */
+    bool checkpoint_at_set;
+    float checkpoint_at;
+    const char *restore_file; /* NULL = keep the configured restore file */
+    bool log_level_set;
+    LogLevel log_level;
+} RunOptions;
 
-int parse_arguments(int argc, char *argv[], char *config_file, size_t config_file_size);
-int initialize_environment(SimConfig *config, const char *config_file);
+
+int parse_arguments(int argc, char *argv[], char *config_file, size_t config_file_size, RunOptions *options);
+void apply_run_options(SimConfig *config, const RunOptions *options);
+int initialize_environment(SimConfig *config, const char *config_file, const RunOptions *options);
 void register_signal_handlers(void);
 void display_welcome(SimConfig *config);
 
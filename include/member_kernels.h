@@ -0,0 +1,39 @@
+#ifndef MEMBER_KERNELS_H
+#define MEMBER_KERNELS_H
+
+#include "common.h"
+
+/*
+ * Bulk kernels over the member store. Every array argument must be
+ * 16-byte aligned and padded so that count rounded up to a multiple of 4
+ * stays in bounds; lanes with a zero mask are left unchanged.
+ */
+
+/* Per-tick mission work of the members selected by mask */
+typedef struct {
+    float prep_base;   /* Preparation gained per tick */
+    float prep_rank;   /* Extra preparation per tick at the top rank */
+    float info_base;   /* Knowledge gained per tick */
+    float info_rank;   /* Extra knowledge per tick at the top rank */
+    float inv_ranks;   /* 1 / num_ranks */
+} MissionProgressParams;
+
+void member_mission_progress_kernel(float *prep, float *knowledge, const int *rank,
+                                    const float *mask, int count, const MissionProgressParams *params);
+int member_promotion_kernel(int *rank, const float *mask, const float *draws, int count,
+                            float base_chance, float inv_ranks, unsigned char *promoted);
+
+/* One knowledge exchange of every member with its neighbors in a CSR graph */
+typedef struct {
+    float transfer_base;  /* Knowledge a superior or peer passes down per exchange */
+    float transfer_gap;   /* Extra knowledge passed down per unit of knowledge gap */
+    float pull_rate;      /* Expected share of the gap drawn up from a superior */
+    float agent_gain;     /* Knowledge an agent picks up per exchange */
+    float step;           /* Exchanges per member per call */
+} DiffusionParams;
+
+void member_diffusion_kernel(float *knowledge, float *gain, const int *rank, const int *agent_id,
+                             const int *row_offsets, const int *neighbors, int count,
+                             const DiffusionParams *params);
+
+#endif /* MEMBER_KERNELS_H */
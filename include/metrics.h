@@ -0,0 +1,133 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "common.h"
+
+/*
+ * Live counters in the shared segment, read by tools/simstat.c while a
+ * run is going. Every gang has a block of its own and the police has
+ * one in the header, each on its own cache lines, so the actors never
+ * bump a line another actor writes. Counters only grow and are updated
+ * with relaxed atomic adds; readers take differences between two
+ * samples. Message counts per type are the channels' own counters.
+ */
+
+#define METRICS_MAGIC "SIMSTATS"
+#define METRICS_VERSION 3
+
+/* Latency histogram: four buckets per power of two of nanoseconds, so a
+ * bucket is at most a quarter of its value wide; the last one takes
+ * everything from about 18 minutes up */
+#define METRICS_LATENCY_BUCKETS 160
+
+typedef struct {
+    unsigned long ticks;
+    unsigned long member_steps;
+    unsigned long missions_created;
+    unsigned long missions_succeeded;
+    unsigned long missions_failed;
+    unsigned long missions_disrupted;  /* Hit by an arrest while being prepared */
+    unsigned long missions_abandoned;
+    unsigned long arrests;             /* Members taken by an arrest order */
+    unsigned long members_killed;
+    unsigned long members_recruited;
+    unsigned long reports_sent;        /* By the agents in this gang */
+    unsigned long lock_waits;          /* Acquisitions of the gang lock that had to wait */
+    unsigned long lock_wait_ns;
+} __attribute__((aligned(64))) GangMetrics;
+
+typedef struct {
+    unsigned long ticks;
+    unsigned long reports_processed;
+    unsigned long actions;
+    unsigned long agents_discovered;
+    /* Wall time from an agent sending a report to the order it set off */
+    unsigned long order_latency_count;
+    unsigned long order_latency_ns;
+    unsigned long order_latency_hist[METRICS_LATENCY_BUCKETS];
+} __attribute__((aligned(64))) PoliceMetrics;
+
+typedef struct {
+    char magic[8];            /* METRICS_MAGIC, without the terminator */
+    uint32_t version;
+    pid_t owner_pid;          /* Main process of the run */
+    /* Simulated clock: sim seconds = clock_sim + (now - clock_ns) * time_scale,
+     * with now read from CLOCK_MONOTONIC; with a time_scale of 0 the clock
+     * is virtual and sim seconds = clock_sim + shared_clock()->now_ms / 1000 */
+    uint64_t clock_ns;
+    double clock_sim;
+    double time_scale;
+    PoliceMetrics police;
+} MetricsHeader;
+
+static inline void metric_add(unsigned long *counter, unsigned long value) {
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static inline void gang_metrics_accumulate(GangMetrics *sum, const GangMetrics *m) {
+    sum->ticks += m->ticks;
+    sum->member_steps += m->member_steps;
+    sum->missions_created += m->missions_created;
+    sum->missions_succeeded += m->missions_succeeded;
+    sum->missions_failed += m->missions_failed;
+    sum->missions_disrupted += m->missions_disrupted;
+    sum->missions_abandoned += m->missions_abandoned;
+    sum->arrests += m->arrests;
+    sum->members_killed += m->members_killed;
+    sum->members_recruited += m->members_recruited;
+    sum->reports_sent += m->reports_sent;
+    sum->lock_waits += m->lock_waits;
+    sum->lock_wait_ns += m->lock_wait_ns;
+}
+
+static inline uint64_t metrics_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static inline int metrics_latency_bucket(uint64_t ns) {
+    if (ns < 4) {
+        return (int)ns;
+    }
+    int log2 = 63 - __builtin_clzll(ns);
+    int bucket = log2 * 4 + (int)((ns >> (log2 - 2)) & 3);
+    return bucket < METRICS_LATENCY_BUCKETS ? bucket : METRICS_LATENCY_BUCKETS - 1;
+}
+
+// Smallest latency that lands in a bucket
+static inline uint64_t metrics_latency_bucket_floor(int bucket) {
+    if (bucket < 8) {
+        return bucket < 4 ? (uint64_t)bucket : 4;
+    }
+    return (uint64_t)(4 + bucket % 4) << (bucket / 4 - 2);
+}
+
+static inline void metrics_record_latency(PoliceMetrics *metrics, uint64_t ns) {
+    metric_add(&metrics->order_latency_count, 1);
+    metric_add(&metrics->order_latency_ns, ns);
+    metric_add(&metrics->order_latency_hist[metrics_latency_bucket(ns)], 1);
+}
+
+// Latency at percentile p (0-100) of a histogram, as the middle of its bucket
+static inline double metrics_latency_percentile(const unsigned long *hist, double p) {
+    unsigned long total = 0, seen = 0;
+    for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+        total += hist[i];
+    }
+    if (total == 0) {
+        return 0.0;
+    }
+    double wanted = p / 100.0 * total;
+    for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+        seen += hist[i];
+        if (hist[i] > 0 && seen >= wanted) {
+            uint64_t low = metrics_latency_bucket_floor(i);
+            uint64_t high = i + 1 < METRICS_LATENCY_BUCKETS ? metrics_latency_bucket_floor(i + 1) : low;
+            return (low + high) / 2.0;
+        }
+    }
+    return (double)metrics_latency_bucket_floor(METRICS_LATENCY_BUCKETS - 1);
+}
+
+#endif /* METRICS_H */
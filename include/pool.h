@@ -0,0 +1,24 @@
+#ifndef POOL_H
+#define POOL_H
+
+/*
+ * Fixed-size work-stealing thread pool. Every worker owns a deque: it
+ * pops its own work LIFO and, when that runs dry, steals FIFO from the
+ * other workers. Tasks submitted from outside the pool are spread over
+ * the deques round-robin; tasks submitted from a worker go to its own.
+ * External submits and pool_wait() come from a single driving thread.
+ */
+
+typedef void (*pool_task_fn)(void *arg);
+
+typedef struct WorkPool WorkPool;
+
+/* num_workers <= 0 means one worker per online core */
+WorkPool *pool_create(int num_workers);
+int pool_submit(WorkPool *pool, pool_task_fn fn, void *arg);
+/* Block until every task submitted so far has finished */
+void pool_wait(WorkPool *pool);
+int pool_worker_count(const WorkPool *pool);
+void pool_destroy(WorkPool *pool);
+
+#endif /* POOL_H */
@@ -0,0 +1,38 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+ * Counter-based random streams (Philox4x32-10). A stream is fully
+ * described by its key (derived from the master seed) and a counter
+ * whose upper half holds the stream ID, so every actor gets an
+ * independent, reproducible sequence without sharing any state.
+ */
+
+/* Stream ID layout: one stream per actor */
+#define RNG_STREAM_MAIN 0ULL
+#define RNG_STREAM_POLICE 1ULL
+#define RNG_STREAM_FALLBACK_BASE 0x00FF000000000000ULL
+#define RNG_STREAM_GANG(gang_id) (0x0100000000000000ULL | ((uint64_t)(gang_id) << 24))
+#define RNG_STREAM_MEMBER(gang_id, member_id) (RNG_STREAM_GANG(gang_id) | ((uint64_t)(member_id) + 1))
+
+typedef struct {
+    uint32_t key[2];
+    uint32_t counter[4];
+    uint32_t block[4];
+    int index; /* Next unused word in block, 4 when exhausted */
+} RngStream;
+
+void rng_set_master_seed(uint64_t seed);
+uint64_t rng_master_seed(void);
+void rng_seed_stream(RngStream *rng, uint64_t stream_id);
+uint32_t rng_next_u32(RngStream *rng);
+float rng_float(RngStream *rng);
+int rng_range(RngStream *rng, int min, int max);
+
+/* Stream used by rand_float()/rand_range() on the calling thread */
+void rng_bind_thread(RngStream *rng);
+RngStream *rng_thread_stream(void);
+
+#endif /* RNG_H */
@@ -0,0 +1,43 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <sched.h>
+
+/*
+ * Single-writer sequence lock over a plain unsigned counter, usable in
+ * shared memory across processes. The writer makes the counter odd while
+ * it updates the protected data and even again when done; readers copy
+ * the data and retry if the counter moved or was odd. Writers never wait
+ * for readers, and readers never take a lock.
+ *
+ *     seqlock_write_begin(&seq);      do {
+ *     ... update data ...                 start = seqlock_read_begin(&seq);
+ *     seqlock_write_end(&seq);            ... copy data ...
+ *                                     } while (seqlock_read_retry(&seq, start));
+ */
+
+static inline void seqlock_write_begin(unsigned int *sequence) {
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seqlock_write_end(unsigned int *sequence) {
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELEASE);
+}
+
+// Waits out a writer in progress and returns the counter to check against;
+// writers hold the counter odd only for a few stores, so yielding is enough
+static inline unsigned int seqlock_read_begin(const unsigned int *sequence) {
+    unsigned int start;
+    while ((start = __atomic_load_n(sequence, __ATOMIC_ACQUIRE)) & 1) {
+        sched_yield();
+    }
+    return start;
+}
+
+static inline int seqlock_read_retry(const unsigned int *sequence, unsigned int start) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(sequence, __ATOMIC_RELAXED) != start;
+}
+
+#endif /* SEQLOCK_H */
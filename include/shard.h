@@ -0,0 +1,25 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "common.h"
+#include "gang.h"
+#include "police.h"
+
+/*
+ * In-process execution mode: every gang and the police actor run inside
+ * the calling process. Gangs are partitioned round-robin over a fixed
+ * set of shard threads, each of which ticks its gangs in turn; the
+ * police actor gets a thread of its own. Messages go through an
+ * in-memory queue (see local_queue.h).
+ */
+
+typedef struct {
+    int index;
+    int gang_count;         /* Gangs owned by this shard */
+    GangRuntime **gangs;
+    pthread_t thread;
+} GangShard;
+
+int run_inprocess_simulation(SharedState *shared_state, SimConfig *config, int msg_queue_id);
+
+#endif /* SHARD_H */
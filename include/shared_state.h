@@ -0,0 +1,103 @@
+#ifndef SHARED_STATE_H
+#define SHARED_STATE_H
+
+#include "common.h"
+#include "shm_ring.h"
+#include "metrics.h"
+#include "sim_clock.h"
+
+/*
+ * Runtime-sized layout of the shared state. The segment starts with the
+ * SharedState header, followed by the gang table and the world-wide
+ * mission, member and agent arrays. Everything is addressed by offset
+ * from the header, so the segment has no pointers into itself.
+ */
+
+/* Alignment of every array in the segment (one cache line) */
+#define SHARED_ALIGNMENT 64
+#define SHARED_ALIGN(size) (((size) + SHARED_ALIGNMENT - 1) & ~((size_t)SHARED_ALIGNMENT - 1))
+
+/* Message channels: reports, status, then one per gang for its orders */
+#define CHANNEL_REPORTS 0
+#define CHANNEL_STATUS 1
+#define CHANNEL_GANG_ORDERS(gang_id) (2 + (gang_id))
+
+/* Channel capacities in messages (powers of two, so they also fit rings) */
+#define CHANNEL_MIN_REPORTS 1024
+#define CHANNEL_MAX_REPORTS (1 << 20)
+#define CHANNEL_REPORTS_PER_AGENT 4
+#define CHANNEL_STATUS_CAPACITY 64
+#define CHANNEL_ORDER_CAPACITY 16
+
+/* The gang table always comes right after the header */
+#define SHARED_GANGS_OFFSET SHARED_ALIGN(sizeof(SharedState))
+
+int shared_layout_compute(SharedLayout *layout, const SimConfig *config);
+size_t shared_state_size(const SimConfig *config);
+
+static inline Gang *shared_gang(SharedState *state, int gang_id) {
+    return (Gang *)((char *)state + SHARED_GANGS_OFFSET) + gang_id;
+}
+
+/* Every gang can find its segment from its own position in the table */
+static inline SharedState *gang_shared_state(const Gang *gang) {
+    return (SharedState *)((char *)(gang - gang->id) - SHARED_GANGS_OFFSET);
+}
+
+static inline AgentStatus *shared_agent_statuses(SharedState *state) {
+    return (AgentStatus *)((char *)state + state->layout.agent_statuses_offset);
+}
+
+static inline ReportMailbox *shared_report_mailbox(SharedState *state, int agent_id) {
+    return (ReportMailbox *)((char *)state + state->layout.report_mailboxes_offset) + agent_id;
+}
+
+/* Events the gang drivers sleep on between ticks */
+static inline SimEvent *shared_wake_event(SharedState *state, int slot) {
+    return (SimEvent *)((char *)state + state->layout.wake_events_offset) + slot;
+}
+
+static inline MetricsHeader *shared_metrics(SharedState *state) {
+    return (MetricsHeader *)((char *)state + state->layout.metrics_offset);
+}
+
+static inline GangMetrics *shared_gang_metrics(SharedState *state, int gang_id) {
+    return (GangMetrics *)((char *)state + state->layout.gang_metrics_offset) + gang_id;
+}
+
+static inline unsigned long *shared_agent_reports(SharedState *state) {
+    return (unsigned long *)((char *)state + state->layout.agent_reports_offset);
+}
+
+static inline SimClockShared *shared_clock(SharedState *state) {
+    return (SimClockShared *)((char *)state + state->layout.clock_offset);
+}
+
+static inline MessageChannel *shared_channel(SharedState *state, int channel) {
+    return (MessageChannel *)((char *)state + state->layout.channels_offset) + channel;
+}
+
+static inline ShmRing *channel_ring(SharedState *state, const MessageChannel *channel) {
+    return (ShmRing *)((char *)state + channel->ring_offset);
+}
+
+static inline int gang_mission_capacity(const Gang *gang) {
+    return gang_shared_state(gang)->layout.missions_per_gang;
+}
+
+static inline Mission *gang_missions(Gang *gang) {
+    SharedState *state = gang_shared_state(gang);
+    return (Mission *)((char *)state + state->layout.missions_offset) +
+           (size_t)gang->id * state->layout.missions_per_gang;
+}
+
+static inline int *mission_assigned_members(Gang *gang, const Mission *mission) {
+    SharedState *state = gang_shared_state(gang);
+    size_t slot = (size_t)gang->id * state->layout.missions_per_gang + (mission - gang_missions(gang));
+    return (int *)((char *)state + state->layout.mission_members_offset) +
+           slot * state->layout.mission_member_capacity;
+}
+
+MemberStore gang_members(const Gang *gang);
+
+#endif /* SHARED_STATE_H */
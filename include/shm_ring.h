@@ -0,0 +1,33 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include "common.h"
+
+/*
+ * Bounded lock-free message ring that lives inside the shared segment.
+ * Every slot carries a sequence number telling producers and consumers
+ * whose turn it is (Vyukov's bounded queue), so any number of producers
+ * and consumers may use it without a lock or a syscall. The slots follow
+ * the header directly and nothing is stored as a pointer, so the ring
+ * works at whatever address each process maps the segment.
+ */
+
+typedef struct {
+    unsigned long sequence; /* position + 1 when full, position + capacity when free again */
+    IpcMessage message;
+} RingSlot;
+
+typedef struct {
+    unsigned long mask; /* capacity - 1, capacity is a power of two */
+    /* Producers and consumers each get their own cache line */
+    unsigned long head __attribute__((aligned(64))); /* Next position to push */
+    unsigned long tail __attribute__((aligned(64))); /* Next position to pop */
+    RingSlot slots[] __attribute__((aligned(64)));
+} ShmRing;
+
+size_t shm_ring_size(unsigned int capacity);
+void shm_ring_init(ShmRing *ring, unsigned int capacity);
+bool shm_ring_push(ShmRing *ring, const IpcMessage *message);
+bool shm_ring_pop(ShmRing *ring, IpcMessage *message);
+
+#endif /* SHM_RING_H */
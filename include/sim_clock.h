@@ -0,0 +1,82 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include "common.h"
+
+/* Wall pacing of timed waits outside the actors when the clock is virtual */
+#define SIM_CLOCK_FAST_SCALE 10000.0
+
+/* Sleeps shorter than this many wall microseconds just yield the CPU */
+#define SIM_CLOCK_MIN_SLEEP_US 20
+
+/*
+ * Simulated clock shared by every actor, and all pacing sleeps are
+ * expressed in simulated milliseconds.
+ *
+ * With a time scale, simulated time advances time_scale times faster
+ * than wall time. The clock is initialized once in the parent before
+ * any fork, so every process derives the same simulated time from
+ * CLOCK_MONOTONIC without sharing any state.
+ *
+ * Without one (--fast) the clock is virtual and follows the actors
+ * instead: it stands still while any actor is running and, once every
+ * actor is asleep, jumps to the earliest deadline among them and wakes
+ * whoever it is due for. Handling a tick or a message takes no
+ * simulated time, as it nearly does at a scale of 1, so outcomes are
+ * those of a real-time run however fast the host gets through them.
+ * The clock keeps its state in the shared segment (SimClockShared);
+ * every gang driver, the police and the monitor join it as actors.
+ */
+
+/* One actor of the virtual clock */
+typedef struct {
+    pid_t pid;                /* Process of the actor, 0 while the slot is free */
+    bool live;                /* Joined and not gone yet */
+    bool waiting;             /* Asleep in sim_clock_wait */
+    unsigned int seen;        /* Sequence of the event it sleeps on */
+    size_t event_offset;      /* That event, from the start of the segment */
+    long long deadline_ms;    /* Simulated time it wakes at, LLONG_MAX for never */
+    SimEvent sleep_event;     /* What sim_sleep_ms sleeps on */
+} SimClockActor;
+
+typedef struct {
+    pthread_mutex_t lock;     /* Shared between processes; guards all but now_ms */
+    long long now_ms;         /* Simulated ms since setup, read without the lock */
+    int live;                 /* Actors expected or joined and not gone, plus a start hold */
+    int waiting;              /* Actors asleep in sim_clock_wait */
+    int actor_capacity;
+    bool stopped;             /* The run is over; waits are paced by wall time again */
+    SimClockActor actors[];
+} SimClockShared;
+
+/* Slots of the virtual clock: a gang driver per gang, the police and the monitor */
+#define SIM_CLOCK_ACTORS(gang_capacity) ((gang_capacity) + 2)
+
+void sim_clock_init(float time_scale);
+void sim_clock_resume(time_t sim_origin, double elapsed_sim);
+time_t sim_clock_origin(void);
+double sim_clock_scale(void);
+bool sim_clock_virtual(void);
+time_t sim_time(void);
+long long sim_time_ms(void);
+void sim_sleep_ms(long ms);
+double sim_clock_elapsed_wall(void);
+double sim_clock_elapsed_sim(void);
+
+/* Virtual clock. The parent sets it up once the segment is in place and
+ * announces every actor before starting it; the clock stays put until
+ * sim_clock_start. Every other process attaches to its own mapping. */
+int sim_clock_setup(SharedState *state);
+void sim_clock_attach(SharedState *state);
+void sim_clock_expect(int actors);
+void sim_clock_start(void);
+void sim_clock_reap(pid_t pid);
+/* Async-signal-safe; once the run is over nothing is left to wait for */
+void sim_clock_stop(void);
+/* Called by the actor's own thread */
+void sim_clock_join(void);
+void sim_clock_leave(void);
+bool sim_clock_is_actor(void);
+bool sim_clock_wait(SimEvent *event, unsigned int seen, long timeout_ms);
+
+#endif /* SIM_CLOCK_H */
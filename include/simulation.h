@@ -2,7 +2,10 @@
 #define SIMULATION_H
 
 #include "common.h"
+#include "metrics.h"
+#ifndef HEADLESS_BUILD
 #include <GL/glut.h>
+#endif
 
 /* Visualization element positions and sizes */
 
@@ -34,15 +37,46 @@ typedef struct {
     char **argv;
 } VisualizationThreadArgs;
 
+/* Per-gang outcome in the end-of-run summary */
+typedef struct {
+    int member_count;
+    int successful_missions;
+    int failed_missions;
+} GangOutcome;
+
+/* Final state of a run, written in headless mode */
+typedef struct {
+    SimulationStatus status;
+    int total_thwarted_plans;
+    int total_successful_plans;
+    int total_executed_agents;
+    int agent_count;
+    unsigned long reports_delivered;
+    unsigned long reports_coalesced;
+    unsigned long reports_dropped;
+    double sim_seconds;
+    double wall_seconds;
+    int gang_count;
+    GangOutcome *gangs;  /* gang_count entries, owned by the summary */
+    GangMetrics gang_metrics;  /* Counters of every gang added up (metrics.h) */
+    PoliceMetrics police_metrics;
+} SimulationSummary;
+
 
 int simulation_init(SimConfig *config, const char *config_file);
 int run_simulation(SimConfig *config, int argc, char **argv);
+int run_simulation_with_summary(SimConfig *config, int argc, char **argv, SimulationSummary *summary);
 int create_ipc_resources(int *shared_state_id, int *msg_queue_id, SimConfig *config);
 int spawn_gang_processes(SharedState *shared_state, SimConfig *config, int msg_queue_id, int shared_state_id);
 pid_t spawn_police_process(SimConfig *config, int msg_queue_id, int shared_state_id);
 void *visualization_thread(void *args);
+void simulation_interrupt(void);  /* Async-signal-safe */
 void shutdown_simulation(int shared_state_id, int msg_queue_id);
 void cleanup_ipc_resources(int shared_state_id, int msg_queue_id);
 void *simulation_monitor_thread(void *args);
+void collect_simulation_summary(SharedState *shared_state, SimulationSummary *summary);
+void free_simulation_summary(SimulationSummary *summary);
+void write_simulation_summary(FILE *out, const SimulationSummary *summary);
+int save_simulation_summary(const SimulationSummary *summary, const char *path);
 
 #endif /* SIMULATION_H */
\ No newline at end of file
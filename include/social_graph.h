@@ -0,0 +1,30 @@
+#ifndef SOCIAL_GRAPH_H
+#define SOCIAL_GRAPH_H
+
+#include "common.h"
+
+/*
+ * Who talks to whom inside a gang, as an undirected graph in CSR form:
+ * the neighbors of member i are neighbors[row_offsets[i] .. row_offsets[i+1]).
+ * Only active members have edges. Each one is linked to a peer of its own
+ * rank and to a superior at the next occupied rank above it, and the
+ * members of a live mission are all linked to each other.
+ */
+
+typedef struct {
+    int member_capacity;   /* Rows the arrays can hold */
+    int edge_capacity;     /* Directed edges the arrays can hold */
+    int member_count;      /* Rows of the last build */
+    int edge_count;        /* Directed edges of the last build */
+    int *row_offsets;      /* member_capacity + 1 entries */
+    int *neighbors;        /* edge_capacity entries */
+    int *pairs;            /* Undirected edges collected before the build */
+    int *by_rank;          /* Active members grouped by rank */
+} SocialGraph;
+
+int social_graph_init(SocialGraph *graph, int member_capacity, int mission_capacity,
+                      int mission_member_capacity);
+void social_graph_build(SocialGraph *graph, Gang *gang);
+void social_graph_free(SocialGraph *graph);
+
+#endif /* SOCIAL_GRAPH_H */
@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "common.h"
+
+/*
+ * Binary event trace. State changes are appended as fixed-size records
+ * to a file mapped MAP_SHARED before the gangs and the police are
+ * started, so every process and thread writes into the same mapping:
+ * a writer claims a slot with one atomic add on the header and fills
+ * it in place. A record's type is stored last, so a zero type marks a
+ * slot that was claimed but never completed. The file is created at
+ * full capacity (sparse) and cut down to the records written when the
+ * run ends. tools/simtrace.c reads it back.
+ */
+
+#define TRACE_MAGIC "SIMTRACE"
+#define TRACE_VERSION 1
+#define TRACE_DEFAULT_CAPACITY (1L << 22) /* Records (128 MiB of file) */
+
+typedef enum {
+    TRACE_NONE,               /* Claimed slot never completed */
+    TRACE_MISSION_CREATED,    /* subject mission, arg target, detail members, value required preparation */
+    TRACE_MISSION_SUCCEEDED,  /* subject mission, arg target */
+    TRACE_MISSION_FAILED,     /* subject mission, arg target */
+    TRACE_MISSION_ABANDONED,  /* subject mission, arg target */
+    TRACE_MEMBER_ARRESTED,    /* subject member, arg seconds, detail mission */
+    TRACE_MEMBER_RELEASED,    /* subject member */
+    TRACE_MEMBER_KILLED,      /* subject member, detail mission */
+    TRACE_MEMBER_RECRUITED,   /* subject member */
+    TRACE_MEMBER_PROMOTED,    /* subject member, arg new rank */
+    TRACE_AGENT_REPORT,       /* subject agent, arg target, detail mission, value confidence */
+    TRACE_POLICE_ACTION,      /* arg arrest seconds */
+    TRACE_AGENT_EXECUTED,     /* subject agent, detail member */
+    TRACE_SIMULATION_END,     /* arg final SimulationStatus */
+    TRACE_EVENT_TYPES
+} TraceEventType;
+
+typedef struct {
+    uint64_t sim_ms;   /* Simulated milliseconds since the start of the run */
+    uint16_t type;     /* TraceEventType, written last */
+    int16_t gang_id;   /* -1 for the police and the simulation */
+    int32_t subject;   /* Mission, member or agent ID (see TraceEventType) */
+    int32_t arg;
+    int32_t detail;
+    float value;
+    uint32_t spare;    /* Zero */
+} TraceRecord;
+
+typedef struct {
+    char magic[8];          /* TRACE_MAGIC, without the terminator */
+    uint32_t version;
+    uint32_t record_size;   /* sizeof(TraceRecord) */
+    uint64_t capacity;      /* Records the file has room for */
+    uint64_t claimed;       /* Slots handed out, including those past capacity */
+    int64_t start_time;     /* Wall clock at the start of the run */
+    uint32_t seed;
+    uint32_t gang_count;
+    float time_scale;
+} __attribute__((aligned(64))) TraceHeader;
+
+/* Writing: open before any actor starts, close after they are all gone */
+int trace_open(const char *path, const SimConfig *config);
+void trace_event(TraceEventType type, int gang_id, int subject, int arg, int detail, float value);
+void trace_close(void);
+
+const char *trace_event_name(TraceEventType type);
+bool trace_event_from_name(const char *name, TraceEventType *type);
+
+#endif /* TRACE_H */
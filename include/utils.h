@@ -5,10 +5,10 @@
 #include <stdarg.h>
 
 
-void log_message(const char *format, ...);
 const char* get_target_name(CrimeTarget target);
 float rand_float(void);
 int rand_range(int min, int max);
+void format_semaphore_name(char *buffer, size_t size, int id);
 sem_t* create_named_semaphore(int id, int initial_value);
 int calculate_time_delay(int base_time, float preparation_level);
 void format_timestamp(char *buffer, size_t size);
@@ -18,7 +18,7 @@ void print_help(const char *program_name);
 const char* member_status_to_string(MemberStatus status);
 const char* agent_status_to_string(AgentStatus status);
 const char* simulation_status_to_string(SimulationStatus status);
-void init_random(void);
+void init_random(unsigned int seed);
 void random_sleep(int min_ms, int max_ms);
 void generate_member_name(int gang_id, int member_id, char *buffer, size_t size);
 
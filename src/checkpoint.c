@@ -0,0 +1,404 @@
+#include "../include/checkpoint.h"
+#include "../include/event.h"
+#include "../include/gang.h"
+#include "../include/ipc.h"
+#include "../include/shared_state.h"
+#include "../include/sim_clock.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Checkpoint being written */
+static CheckpointHeader *g_checkpoint;
+static size_t g_checkpoint_size;
+static pid_t g_checkpoint_owner;
+static double g_checkpoint_at;
+static char g_checkpoint_path[256];
+
+/* Checkpoint being restored */
+static const CheckpointHeader *g_restore;
+static size_t g_restore_size;
+
+/* A byte range of the segment */
+typedef struct {
+    size_t offset;
+    size_t size;
+} SegmentRegion;
+
+#define GANG_REGIONS 16
+
+// The slices of the segment one gang owns: its table entry, its missions
+// and its share of every member array
+static int gang_regions(const SharedLayout *layout, int gang_id, SegmentRegion *regions) {
+    size_t members = layout->member_capacity;
+    size_t first = (size_t)gang_id * members;
+    size_t missions = layout->missions_per_gang;
+    size_t first_mission = (size_t)gang_id * missions;
+    size_t mission_members = missions * layout->mission_member_capacity;
+    size_t words = layout->member_bitset_words;
+    size_t first_word = (size_t)gang_id * words;
+    int n = 0;
+
+#define REGION(field, start, count, type) \
+    regions[n++] = (SegmentRegion){ layout->field + (start) * sizeof(type), (count) * sizeof(type) }
+    REGION(gangs_offset, (size_t)gang_id, 1, Gang);
+    REGION(missions_offset, first_mission, missions, Mission);
+    REGION(mission_members_offset, first_mission * layout->mission_member_capacity, mission_members, int);
+    REGION(preparation_offset, first, members, float);
+    REGION(knowledge_offset, first, members, float);
+    REGION(rank_offset, first, members, int);
+    REGION(member_status_offset, first, members, MemberStatus);
+    REGION(assigned_mission_offset, first, members, int);
+    REGION(assigned_slot_offset, first, members, int);
+    REGION(agent_id_offset, first, members, int);
+    REGION(release_time_offset, first, members, time_t);
+    REGION(member_rng_offset, first, members, RngStream);
+    REGION(active_bits_offset, first_word, words, uint64_t);
+    REGION(assigned_bits_offset, first_word, words, uint64_t);
+    REGION(arrested_bits_offset, first_word, words, uint64_t);
+    REGION(unprepared_bits_offset, first_word, words, uint64_t);
+#undef REGION
+
+    return n;
+}
+
+// The police tables follow the segment image in this order
+static size_t police_section_size(const SharedLayout *layout) {
+    return (size_t)layout->agent_capacity * (sizeof(SecretAgent) + sizeof(int)) +
+           (size_t)layout->gang_capacity * sizeof(GangIntelligence);
+}
+
+static size_t page_align(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (size + page - 1) / page * page;
+}
+
+int checkpoint_open(const char *path, const SimConfig *config) {
+    SharedLayout layout;
+    if (shared_layout_compute(&layout, config) != 0) {
+        log_error("Cannot lay out a checkpoint for %d gangs", config->num_gangs);
+        return -1;
+    }
+    size_t segment_offset = page_align(sizeof(CheckpointHeader));
+    size_t police_offset = page_align(segment_offset + layout.total_size);
+    size_t size = police_offset + police_section_size(&layout);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        log_error("Failed to open checkpoint file %s: %s", path, strerror(errno));
+        return -1;
+    }
+    // Only the parts the actors copy in ever get pages
+    if (ftruncate(fd, size) != 0) {
+        log_error("Failed to size checkpoint file %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_error("Failed to map checkpoint file %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    g_checkpoint = (CheckpointHeader *)map;
+    g_checkpoint_size = size;
+    g_checkpoint_owner = getpid();
+    g_checkpoint_at = config->checkpoint_at;
+    safe_strcpy(g_checkpoint_path, path, sizeof(g_checkpoint_path));
+
+    memcpy(g_checkpoint->magic, CHECKPOINT_MAGIC, sizeof(g_checkpoint->magic));
+    g_checkpoint->version = CHECKPOINT_VERSION;
+    g_checkpoint->parts_expected = layout.gang_capacity + 1;
+    g_checkpoint->segment_offset = segment_offset;
+    g_checkpoint->police_offset = police_offset;
+    g_checkpoint->file_size = size;
+    g_checkpoint->master_seed = rng_master_seed();
+    g_checkpoint->sim_origin = sim_clock_origin();
+    g_checkpoint->layout = layout;
+
+    log_message("Checkpointing to %s after %.0f simulated seconds", path, g_checkpoint_at);
+    return 0;
+}
+
+// The outcome counters at the moment each actor saved its part: a gang
+// is the only one adding its missions and executions, the police its
+// thwarted plans and its discoveries, which uncover the agent in its table
+static void sum_saved_counters(SharedState *image) {
+    const SharedLayout *layout = &g_checkpoint->layout;
+    const SecretAgent *agents = (const SecretAgent *)((char *)g_checkpoint + g_checkpoint->police_offset);
+    int successful = 0;
+    int executed = 0;
+
+    for (int i = 0; i < layout->gang_capacity; i++) {
+        const Gang *gang = (const Gang *)((char *)image + layout->gangs_offset) + i;
+        successful += gang->successful_missions;
+        executed += gang->executed_agents;
+    }
+    for (int i = 0; i < g_checkpoint->agent_count; i++) {
+        if (agents[i].status == AGENT_STATUS_UNCOVERED) {
+            executed++;
+        }
+    }
+
+    image->total_successful_plans = successful;
+    image->total_executed_agents = executed;
+    image->total_thwarted_plans = g_checkpoint->thwarted_plans;
+}
+
+long checkpoint_poll(SharedState *state, long idle_ms) {
+    if (!g_checkpoint || g_checkpoint->complete) {
+        return idle_ms;
+    }
+
+    if (!g_checkpoint->requested) {
+        double due = g_checkpoint_at - sim_clock_elapsed_sim();
+        if (due > 0) {
+            long due_ms = (long)(due * 1000.0) + 1;
+            return due_ms < idle_ms ? due_ms : idle_ms;
+        }
+        g_checkpoint->sim_elapsed = sim_clock_elapsed_sim();
+        __atomic_store_n(&g_checkpoint->requested, 1, __ATOMIC_RELEASE);
+        // The gangs tick on their own; the police may be asleep until the next report
+        event_signal(&state->police_event);
+        log_message("Checkpoint requested at %.0f simulated seconds", g_checkpoint->sim_elapsed);
+    }
+
+    if (__atomic_load_n(&g_checkpoint->parts_done, __ATOMIC_ACQUIRE) < g_checkpoint->parts_expected) {
+        return GANG_TICK_MS < idle_ms ? GANG_TICK_MS : idle_ms;
+    }
+
+    // Every actor is in; the outcome counters come from the parts, the rest
+    // of the header as it is now
+    SharedState *image = (SharedState *)((char *)g_checkpoint + g_checkpoint->segment_offset);
+    memcpy(image, state, sizeof(SharedState));
+    sum_saved_counters(image);
+    __atomic_store_n(&g_checkpoint->complete, 1, __ATOMIC_RELEASE);
+    if (msync(g_checkpoint, g_checkpoint_size, MS_ASYNC) != 0) {
+        log_error("Failed to flush checkpoint file %s: %s", g_checkpoint_path, strerror(errno));
+    }
+    log_message("Checkpoint %s written", g_checkpoint_path);
+    return idle_ms;
+}
+
+bool checkpoint_requested(void) {
+    return g_checkpoint && __atomic_load_n(&g_checkpoint->requested, __ATOMIC_ACQUIRE);
+}
+
+// Called by the gang at the end of a tick, holding its own lock
+void checkpoint_save_gang(Gang *gang) {
+    SegmentRegion regions[GANG_REGIONS];
+    const char *segment = (const char *)gang_shared_state(gang);
+    char *image = (char *)g_checkpoint + g_checkpoint->segment_offset;
+    int count = gang_regions(&g_checkpoint->layout, gang->id, regions);
+
+    for (int i = 0; i < count; i++) {
+        memcpy(image + regions[i].offset, segment + regions[i].offset, regions[i].size);
+    }
+    __atomic_add_fetch(&g_checkpoint->parts_done, 1, __ATOMIC_ACQ_REL);
+}
+
+// Called by the police at the end of a tick; the agent statuses come along
+void checkpoint_save_police(const PoliceRuntime *runtime) {
+    const SharedLayout *layout = &g_checkpoint->layout;
+    size_t agents = (size_t)layout->agent_capacity;
+    size_t gangs = (size_t)layout->gang_capacity;
+    char *image = (char *)g_checkpoint + g_checkpoint->segment_offset;
+    char *police = (char *)g_checkpoint + g_checkpoint->police_offset;
+
+    memcpy(image + layout->agent_statuses_offset, shared_agent_statuses(runtime->shared_state),
+           agents * sizeof(AgentStatus));
+    memcpy(police, runtime->agents, agents * sizeof(SecretAgent));
+    police += agents * sizeof(SecretAgent);
+    memcpy(police, runtime->intel, gangs * sizeof(GangIntelligence));
+    police += gangs * sizeof(GangIntelligence);
+    memcpy(police, runtime->intel_agent_ids, agents * sizeof(int));
+
+    g_checkpoint->agent_count = runtime->agent_count;
+    // Only the police thwarts plans, so this is exact
+    g_checkpoint->thwarted_plans = __atomic_load_n(&runtime->shared_state->total_thwarted_plans,
+                                                   __ATOMIC_RELAXED);
+    g_checkpoint->police_rng = runtime->rng;
+    __atomic_add_fetch(&g_checkpoint->parts_done, 1, __ATOMIC_ACQ_REL);
+}
+
+// Only the process that opened the checkpoint removes an unfinished one
+void checkpoint_close(void) {
+    if (!g_checkpoint) {
+        return;
+    }
+
+    bool owner = getpid() == g_checkpoint_owner;
+    bool complete = __atomic_load_n(&g_checkpoint->complete, __ATOMIC_ACQUIRE);
+    munmap(g_checkpoint, g_checkpoint_size);
+    g_checkpoint = NULL;
+
+    if (owner && !complete) {
+        log_error("Simulation ended before checkpoint %s was complete; removing it", g_checkpoint_path);
+        unlink(g_checkpoint_path);
+    }
+}
+
+// A run restored with a master seed other than the checkpoint's draws new streams
+static bool restore_reseeds(void) {
+    return rng_master_seed() != g_restore->master_seed;
+}
+
+// Runs restored from a checkpoint may change anything but the sizes of the segment
+static bool layout_compatible(const SharedLayout *saved, const SharedLayout *current) {
+    return saved->gang_capacity == current->gang_capacity &&
+           saved->member_capacity == current->member_capacity &&
+           saved->agent_capacity == current->agent_capacity &&
+           saved->missions_per_gang == current->missions_per_gang &&
+           saved->mission_member_capacity == current->mission_member_capacity;
+}
+
+// Map a complete checkpoint of this version
+static int map_checkpoint(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        log_error("Cannot open checkpoint %s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CheckpointHeader)) {
+        log_error("%s is not a checkpoint file", path);
+        close(fd);
+        return -1;
+    }
+    // Private and read-only: runs forked after loading share its pages
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_error("Failed to map checkpoint %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    const CheckpointHeader *header = (const CheckpointHeader *)map;
+    if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != CHECKPOINT_VERSION) {
+        log_error("Checkpoint %s is not a checkpoint file of this version", path);
+        munmap(map, st.st_size);
+        return -1;
+    }
+    if (!header->complete || header->file_size != (uint64_t)st.st_size) {
+        log_error("Checkpoint %s is incomplete", path);
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    g_restore = header;
+    g_restore_size = st.st_size;
+    return 0;
+}
+
+// A checkpoint loaded before a fork stays loaded in the child; loading
+// it again there only checks it against the child's configuration
+int checkpoint_load(const char *path, const SimConfig *config) {
+    SharedLayout layout;
+    if (shared_layout_compute(&layout, config) != 0) {
+        log_error("Cannot lay out shared state for %d gangs", config->num_gangs);
+        return -1;
+    }
+    if (!g_restore && map_checkpoint(path) != 0) {
+        return -1;
+    }
+    if (!layout_compatible(&g_restore->layout, &layout)) {
+        log_error("Checkpoint %s was taken with different gang, member, mission or agent limits", path);
+        return -1;
+    }
+
+    sim_clock_resume((time_t)g_restore->sim_origin, g_restore->sim_elapsed);
+
+    // Without a seed of its own the run carries on the checkpoint's streams
+    if (config->seed == 0) {
+        rng_set_master_seed(g_restore->master_seed);
+    }
+
+    log_message("Restoring checkpoint %s taken %.0f simulated seconds into its run%s", path,
+                g_restore->sim_elapsed, restore_reseeds() ? ", with fresh random streams" : "");
+    return 0;
+}
+
+bool checkpoint_restoring(void) {
+    return g_restore != NULL;
+}
+
+// Counters and agent statuses; the caller has just set up a fresh segment
+void checkpoint_restore_state(SharedState *state) {
+    const char *image = (const char *)g_restore + g_restore->segment_offset;
+    const SharedState *saved = (const SharedState *)image;
+
+    state->agent_count = saved->agent_count;
+    state->agent_execution_loss_count = saved->agent_execution_loss_count;
+    state->total_thwarted_plans = saved->total_thwarted_plans;
+    state->total_successful_plans = saved->total_successful_plans;
+    state->total_executed_agents = saved->total_executed_agents;
+    state->reports_delivered = saved->reports_delivered;
+    state->reports_coalesced = saved->reports_coalesced;
+    state->reports_dropped = saved->reports_dropped;
+
+    memcpy(shared_agent_statuses(state), image + g_restore->layout.agent_statuses_offset,
+           (size_t)g_restore->layout.agent_capacity * sizeof(AgentStatus));
+}
+
+// Stands in for gang_init(); returns the member count, -1 on failure
+int checkpoint_restore_gang(SharedState *state, int gang_id) {
+    SegmentRegion regions[GANG_REGIONS];
+    const char *image = (const char *)g_restore + g_restore->segment_offset;
+    int count = gang_regions(&g_restore->layout, gang_id, regions);
+
+    for (int i = 0; i < count; i++) {
+        memcpy((char *)state + regions[i].offset, image + regions[i].offset, regions[i].size);
+    }
+
+    // The saved lock belonged to the old run; nobody has seen this one yet
+    Gang *gang = shared_gang(state, gang_id);
+    gang->process_id = 0;
+    if (init_shared_mutex(&gang->lock) != 0) {
+        return -1;
+    }
+
+    if (restore_reseeds()) {
+        MemberStore ms = gang_members(gang);
+        for (int i = 0; i < gang->member_count; i++) {
+            rng_seed_stream(&ms.rng[i], RNG_STREAM_MEMBER(gang_id, i));
+        }
+        rng_seed_stream(&gang->rng, RNG_STREAM_GANG(gang_id));
+    }
+    return gang->member_count;
+}
+
+// Stands in for init_intelligence() and infiltrate_gangs(); the tables are allocated
+void checkpoint_restore_police(PoliceRuntime *runtime) {
+    const SharedLayout *layout = &g_restore->layout;
+    size_t agents = (size_t)layout->agent_capacity;
+    size_t gangs = (size_t)layout->gang_capacity;
+    size_t agents_per_gang = gangs > 0 ? agents / gangs : 0;
+    const char *police = (const char *)g_restore + g_restore->police_offset;
+
+    memcpy(runtime->agents, police, agents * sizeof(SecretAgent));
+    police += agents * sizeof(SecretAgent);
+    memcpy(runtime->intel, police, gangs * sizeof(GangIntelligence));
+    police += gangs * sizeof(GangIntelligence);
+    memcpy(runtime->intel_agent_ids, police, agents * sizeof(int));
+
+    // The saved pointers pointed into the old run's tables
+    for (size_t i = 0; i < gangs; i++) {
+        runtime->intel[i].agent_ids = runtime->intel_agent_ids + i * agents_per_gang;
+    }
+    runtime->agent_count = g_restore->agent_count;
+    if (!restore_reseeds()) {
+        runtime->rng = g_restore->police_rng;
+    }
+}
+
+void checkpoint_unload(void) {
+    if (g_restore) {
+        munmap((void *)g_restore, g_restore_size);
+        g_restore = NULL;
+    }
+}
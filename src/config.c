@@ -1,4 +1,7 @@
 #include "../include/config.h"
+#include "../include/logger.h"
+#include "../include/trace.h"
+#include "../include/checkpoint.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -48,6 +51,23 @@ void set_default_config(SimConfig *config) {
     config->agent_discovery_threshold = 0.7f;
     config->agent_knowledge_gain = 0.03f;
     config->max_agents_per_gang = 2;
+    config->max_concurrent_missions = DEFAULT_MAX_CONCURRENT_MISSIONS;
+    config->time_scale = 1.0f;
+    config->headless = false;
+    config->summary_file[0] = '\0';
+    config->seed = 0;
+    config->worker_threads = 0;
+    config->execution_mode = EXECUTION_MODE_PROCESS;
+    config->shard_threads = 0;
+    config->message_transport = MESSAGE_TRANSPORT_QUEUE;
+    config->log_level = LOG_LEVEL_VERBOSE;
+    config->trace_file[0] = '\0';
+    config->trace_capacity = TRACE_DEFAULT_CAPACITY;
+    config->checkpoint_file[0] = '\0';
+    config->checkpoint_at = CHECKPOINT_DEFAULT_AT;
+    config->restore_file[0] = '\0';
+    config->initial_raid_gang = -1;
+    config->max_sim_seconds = 0.0f;
 }
 
 
@@ -97,14 +117,166 @@ static char* trim(char *str) {
     key[key_len] = '\0';
     strcpy(value, separator + 1);
     
-    // Trim whitespace
-    trim(key);
-    trim(value);
+    // Trim whitespace; move the text to the start of the buffers, where
+    // the caller reads it
+    char *trimmed = trim(key);
+    memmove(key, trimmed, strlen(trimmed) + 1);
+    trimmed = trim(value);
+    memmove(value, trimmed, strlen(trimmed) + 1);
     
     return 1;
 }
 
 
+// Set one configuration key; returns false if the key is unknown
+bool config_set(SimConfig *config, const char *key, const char *value) {
+    if (strcmp(key, "num_gangs") == 0) {
+        config->num_gangs = atoi(value);
+    } else if (strcmp(key, "min_members_per_gang") == 0) {
+        config->min_members_per_gang = atoi(value);
+    } else if (strcmp(key, "max_members_per_gang") == 0) {
+        config->max_members_per_gang = atoi(value);
+    } else if (strcmp(key, "num_ranks") == 0) {
+        config->num_ranks = atoi(value);
+    } else if (strcmp(key, "mission_members_count") == 0) {
+        config->mission_members_count = atoi(value);
+    } else if (strcmp(key, "agent_infiltration_rate") == 0) {
+        config->agent_infiltration_rate = atof(value);
+    } else if (strcmp(key, "preparation_time_min") == 0) {
+        config->preparation_time_min = atoi(value);
+    } else if (strcmp(key, "preparation_time_max") == 0) {
+        config->preparation_time_max = atoi(value);
+    } else if (strcmp(key, "false_info_probability") == 0) {
+        config->false_info_probability = atof(value);
+    } else if (strcmp(key, "mission_success_rate_base") == 0) {
+        config->mission_success_rate_base = atof(value);
+    } else if (strcmp(key, "mission_kill_probability") == 0) {
+        config->mission_kill_probability = atof(value);
+    } else if (strcmp(key, "agent_suspicion_threshold") == 0) {
+        config->agent_suspicion_threshold = atof(value);
+    } else if (strcmp(key, "police_confirmation_threshold") == 0) {
+        config->police_confirmation_threshold = atof(value);
+    } else if (strcmp(key, "prison_time") == 0) {
+        config->prison_time = atoi(value);
+    } else if (strcmp(key, "police_thwart_win_count") == 0) {
+        config->police_thwart_win_count = atoi(value);
+    } else if (strcmp(key, "gang_success_win_count") == 0) {
+        config->gang_success_win_count = atoi(value);
+    } else if (strcmp(key, "agent_execution_loss_count") == 0) {
+        config->agent_execution_loss_count = atoi(value);
+    } else if (strcmp(key, "info_spread_delay") == 0) {
+        config->info_spread_delay = atoi(value);
+    } 
+    else if (strcmp(key, "member_knowledge_transfer_rate") == 0) {
+        config->member_knowledge_transfer_rate = atof(value);
+    } else if (strcmp(key, "member_knowledge_rank_factor") == 0) {
+        config->member_knowledge_rank_factor = atof(value);
+    } else if (strcmp(key, "member_knowledge_lucky_chance") == 0) {
+        config->member_knowledge_lucky_chance = atof(value);
+    } else if (strcmp(key, "base_preparation_increment") == 0) {
+        config->base_preparation_increment = atof(value);
+    } else if (strcmp(key, "rank_preparation_bonus") == 0) {
+        config->rank_preparation_bonus = atof(value);
+    } else if (strcmp(key, "min_preparation_required_base") == 0) {
+        config->min_preparation_required_base = atof(value);
+    } else if (strcmp(key, "min_preparation_difficulty_factor") == 0) {
+        config->min_preparation_difficulty_factor = atof(value);
+    } else if (strcmp(key, "promotion_base_chance") == 0) {
+        config->promotion_base_chance = atof(value);
+    } else if (strcmp(key, "promotion_rank_factor") == 0) {
+        config->promotion_rank_factor = atof(value);
+    } else if (strcmp(key, "target_difficulty_base") == 0) {
+        config->target_difficulty_base = atof(value);
+    } else if (strcmp(key, "target_difficulty_scaling") == 0) {
+        config->target_difficulty_scaling = atof(value);
+    } else if (strcmp(key, "info_spread_base_value") == 0) {
+        config->info_spread_base_value = atof(value);
+    } else if (strcmp(key, "info_spread_rank_factor") == 0) {
+        config->info_spread_rank_factor = atof(value);
+    } else if (strcmp(key, "preparation_knowledge_factor") == 0) {
+        config->preparation_knowledge_factor = atof(value);
+    } else if (strcmp(key, "preparation_rank_factor") == 0) {
+        config->preparation_rank_factor = atof(value);
+    } else if (strcmp(key, "agent_knowledge_gain") == 0) {
+        config->agent_knowledge_gain = atof(value);
+    } else if (strcmp(key, "agent_report_knowledge_reset") == 0) {
+        config->agent_report_knowledge_reset = atof(value);
+    } else if (strcmp(key, "agent_base_suspicion") == 0) {
+        config->agent_base_suspicion = atof(value);
+    } else if (strcmp(key, "knowledge_anomaly_suspicion") == 0) {
+        config->knowledge_anomaly_suspicion = atof(value);
+    } else if (strcmp(key, "min_agent_report_time") == 0) {
+        config->min_agent_report_time = atoi(value);
+    } else if (strcmp(key, "agent_initial_knowledge_threshold") == 0) {
+        config->agent_initial_knowledge_threshold = atof(value);
+    } else if (strcmp(key, "agent_knowledge_report_threshold") == 0) {
+        config->agent_knowledge_report_threshold = atof(value);
+    } else if (strcmp(key, "agent_discovery_threshold") == 0) {
+        config->agent_discovery_threshold = atof(value);
+    }
+    else if (strcmp(key, "max_agents_per_gang") == 0) {
+        config->max_agents_per_gang = atoi(value);
+    } else if (strcmp(key, "max_concurrent_missions") == 0) {
+        config->max_concurrent_missions = atoi(value);
+    } else if (strcmp(key, "time_scale") == 0) {
+        config->time_scale = atof(value);
+    } else if (strcmp(key, "seed") == 0) {
+        config->seed = (unsigned int)strtoul(value, NULL, 10);
+    } else if (strcmp(key, "headless") == 0) {
+        config->headless = atoi(value) != 0;
+    } else if (strcmp(key, "worker_threads") == 0) {
+        config->worker_threads = atoi(value);
+    } else if (strcmp(key, "execution_mode") == 0) {
+        if (strcmp(value, "inprocess") == 0 || strcmp(value, "in-process") == 0) {
+            config->execution_mode = EXECUTION_MODE_INPROCESS;
+        } else if (strcmp(value, "process") == 0) {
+            config->execution_mode = EXECUTION_MODE_PROCESS;
+        } else {
+            log_message("Unknown execution_mode '%s', using process", value);
+            config->execution_mode = EXECUTION_MODE_PROCESS;
+        }
+    } else if (strcmp(key, "message_transport") == 0) {
+        if (strcmp(value, "rings") == 0) {
+            config->message_transport = MESSAGE_TRANSPORT_RINGS;
+        } else if (strcmp(value, "queue") == 0) {
+            config->message_transport = MESSAGE_TRANSPORT_QUEUE;
+        } else {
+            log_message("Unknown message_transport '%s', using queue", value);
+            config->message_transport = MESSAGE_TRANSPORT_QUEUE;
+        }
+    } else if (strcmp(key, "log_level") == 0) {
+        if (!log_level_from_string(value, &config->log_level)) {
+            log_message("Unknown log_level '%s', using verbose", value);
+            config->log_level = LOG_LEVEL_VERBOSE;
+        }
+    } else if (strcmp(key, "shard_threads") == 0) {
+        config->shard_threads = atoi(value);
+    } else if (strcmp(key, "trace_file") == 0) {
+        strncpy(config->trace_file, value, sizeof(config->trace_file) - 1);
+        config->trace_file[sizeof(config->trace_file) - 1] = '\0';
+    } else if (strcmp(key, "trace_capacity") == 0) {
+        config->trace_capacity = atol(value);
+    } else if (strcmp(key, "checkpoint_file") == 0) {
+        strncpy(config->checkpoint_file, value, sizeof(config->checkpoint_file) - 1);
+        config->checkpoint_file[sizeof(config->checkpoint_file) - 1] = '\0';
+    } else if (strcmp(key, "checkpoint_at") == 0) {
+        config->checkpoint_at = atof(value);
+    } else if (strcmp(key, "restore_file") == 0) {
+        strncpy(config->restore_file, value, sizeof(config->restore_file) - 1);
+        config->restore_file[sizeof(config->restore_file) - 1] = '\0';
+    } else if (strcmp(key, "initial_raid_gang") == 0) {
+        config->initial_raid_gang = atoi(value);
+    } else if (strcmp(key, "max_sim_seconds") == 0) {
+        config->max_sim_seconds = atof(value);
+    } else if (strcmp(key, "summary_file") == 0) {
+        strncpy(config->summary_file, value, sizeof(config->summary_file) - 1);
+        config->summary_file[sizeof(config->summary_file) - 1] = '\0';
+    } else {
+        return false;
+    }
+    return true;
+}
+
 int load_config(const char *filename, SimConfig *config) {
     FILE *file;
     char line[256];
@@ -124,94 +296,7 @@ int load_config(const char *filename, SimConfig *config) {
     // Read and parse each line
     while (fgets(line, sizeof(line), file)) {
         if (parse_config_line(line, key, value, sizeof(key), sizeof(value))) {
-            if (strcmp(key, "num_gangs") == 0) {
-                config->num_gangs = atoi(value);
-            } else if (strcmp(key, "min_members_per_gang") == 0) {
-                config->min_members_per_gang = atoi(value);
-            } else if (strcmp(key, "max_members_per_gang") == 0) {
-                config->max_members_per_gang = atoi(value);
-            } else if (strcmp(key, "num_ranks") == 0) {
-                config->num_ranks = atoi(value);
-            } else if (strcmp(key, "mission_members_count") == 0) {
-                config->mission_members_count = atoi(value);
-            } else if (strcmp(key, "agent_infiltration_rate") == 0) {
-                config->agent_infiltration_rate = atof(value);
-            } else if (strcmp(key, "preparation_time_min") == 0) {
-                config->preparation_time_min = atoi(value);
-            } else if (strcmp(key, "preparation_time_max") == 0) {
-                config->preparation_time_max = atoi(value);
-            } else if (strcmp(key, "false_info_probability") == 0) {
-                config->false_info_probability = atof(value);
-            } else if (strcmp(key, "mission_success_rate_base") == 0) {
-                config->mission_success_rate_base = atof(value);
-            } else if (strcmp(key, "mission_kill_probability") == 0) {
-                config->mission_kill_probability = atof(value);
-            } else if (strcmp(key, "agent_suspicion_threshold") == 0) {
-                config->agent_suspicion_threshold = atof(value);
-            } else if (strcmp(key, "police_confirmation_threshold") == 0) {
-                config->police_confirmation_threshold = atof(value);
-            } else if (strcmp(key, "prison_time") == 0) {
-                config->prison_time = atoi(value);
-            } else if (strcmp(key, "police_thwart_win_count") == 0) {
-                config->police_thwart_win_count = atoi(value);
-            } else if (strcmp(key, "gang_success_win_count") == 0) {
-                config->gang_success_win_count = atoi(value);
-            } else if (strcmp(key, "agent_execution_loss_count") == 0) {
-                config->agent_execution_loss_count = atoi(value);
-            } else if (strcmp(key, "info_spread_delay") == 0) {
-                config->info_spread_delay = atoi(value);
-            } 
-            else if (strcmp(key, "member_knowledge_transfer_rate") == 0) {
-                config->member_knowledge_transfer_rate = atof(value);
-            } else if (strcmp(key, "member_knowledge_rank_factor") == 0) {
-                config->member_knowledge_rank_factor = atof(value);
-            } else if (strcmp(key, "member_knowledge_lucky_chance") == 0) {
-                config->member_knowledge_lucky_chance = atof(value);
-            } else if (strcmp(key, "base_preparation_increment") == 0) {
-                config->base_preparation_increment = atof(value);
-            } else if (strcmp(key, "rank_preparation_bonus") == 0) {
-                config->rank_preparation_bonus = atof(value);
-            } else if (strcmp(key, "min_preparation_required_base") == 0) {
-                config->min_preparation_required_base = atof(value);
-            } else if (strcmp(key, "min_preparation_difficulty_factor") == 0) {
-                config->min_preparation_difficulty_factor = atof(value);
-            } else if (strcmp(key, "promotion_base_chance") == 0) {
-                config->promotion_base_chance = atof(value);
-            } else if (strcmp(key, "promotion_rank_factor") == 0) {
-                config->promotion_rank_factor = atof(value);
-            } else if (strcmp(key, "target_difficulty_base") == 0) {
-                config->target_difficulty_base = atof(value);
-            } else if (strcmp(key, "target_difficulty_scaling") == 0) {
-                config->target_difficulty_scaling = atof(value);
-            } else if (strcmp(key, "info_spread_base_value") == 0) {
-                config->info_spread_base_value = atof(value);
-            } else if (strcmp(key, "info_spread_rank_factor") == 0) {
-                config->info_spread_rank_factor = atof(value);
-            } else if (strcmp(key, "preparation_knowledge_factor") == 0) {
-                config->preparation_knowledge_factor = atof(value);
-            } else if (strcmp(key, "preparation_rank_factor") == 0) {
-                config->preparation_rank_factor = atof(value);
-            } else if (strcmp(key, "agent_knowledge_gain") == 0) {
-                config->agent_knowledge_gain = atof(value);
-            } else if (strcmp(key, "agent_report_knowledge_reset") == 0) {
-                config->agent_report_knowledge_reset = atof(value);
-            } else if (strcmp(key, "agent_base_suspicion") == 0) {
-                config->agent_base_suspicion = atof(value);
-            } else if (strcmp(key, "knowledge_anomaly_suspicion") == 0) {
-                config->knowledge_anomaly_suspicion = atof(value);
-            } else if (strcmp(key, "min_agent_report_time") == 0) {
-                config->min_agent_report_time = atoi(value);
-            } else if (strcmp(key, "agent_initial_knowledge_threshold") == 0) {
-                config->agent_initial_knowledge_threshold = atof(value);
-            } else if (strcmp(key, "agent_knowledge_report_threshold") == 0) {
-                config->agent_knowledge_report_threshold = atof(value);
-            } else if (strcmp(key, "agent_discovery_threshold") == 0) {
-                config->agent_discovery_threshold = atof(value);
-            }
-            else if (strcmp(key, "max_agents_per_gang") == 0) {
-                config->max_agents_per_gang = atoi(value);
-            }
-            // Ignore unknown keys
+            config_set(config, key, value);  // Unknown keys are ignored
         }
     }
     
@@ -220,6 +305,7 @@ int load_config(const char *filename, SimConfig *config) {
 }
 
 void print_config(SimConfig *config) {
+    logger_flush();
     printf("Simulation Configuration:\n");
     printf("------------------------\n");
     printf("Number of gangs: %d\n", config->num_gangs);
@@ -264,6 +350,46 @@ void print_config(SimConfig *config) {
     printf("Agent knowledge report threshold: %.2f\n", config->agent_knowledge_report_threshold);
     printf("Agent discovery threshold: %.2f\n", config->agent_discovery_threshold);
     printf("Maximum Agents Per Gang: %d\n", config->max_agents_per_gang);
+    printf("Maximum concurrent missions per gang: %d\n", config->max_concurrent_missions);
+    if (config->time_scale > 0.0f) {
+        printf("Time scale: %.1fx\n", config->time_scale);
+    } else {
+        printf("Time scale: virtual clock, as fast as the actors go\n");
+    }
+    printf("Headless: %s\n", config->headless ? "yes" : "no");
+    printf("Random seed: %u%s\n", config->seed, config->seed == 0 ? " (from clock)" : "");
+    if (config->execution_mode == EXECUTION_MODE_INPROCESS) {
+        if (config->shard_threads > 0) {
+            printf("Execution mode: in-process, %d shard threads\n", config->shard_threads);
+        } else {
+            printf("Execution mode: in-process, one shard thread per core\n");
+        }
+    } else {
+        printf("Execution mode: process per gang\n");
+        if (config->worker_threads > 0) {
+            printf("Worker threads per gang: %d\n", config->worker_threads);
+        } else {
+            printf("Worker threads per gang: its share of the cores\n");
+        }
+    }
+    printf("Message transport: %s\n",
+           config->message_transport == MESSAGE_TRANSPORT_RINGS ? "shared-memory rings" : "message queue");
+    printf("Log level: %s\n", log_level_to_string(config->log_level));
+    if (config->trace_file[0] != '\0') {
+        printf("Event trace: %s (up to %ld records)\n", config->trace_file, config->trace_capacity);
+    }
+    if (config->restore_file[0] != '\0') {
+        printf("Restored from: %s\n", config->restore_file);
+    }
+    if (config->checkpoint_file[0] != '\0') {
+        printf("Checkpoint: %s at %.0f simulated seconds\n", config->checkpoint_file, config->checkpoint_at);
+    }
+    if (config->initial_raid_gang >= 0) {
+        printf("Initial raid on gang: %d\n", config->initial_raid_gang);
+    }
+    if (config->max_sim_seconds > 0.0f) {
+        printf("Time limit: %.0f simulated seconds\n", config->max_sim_seconds);
+    }
 
     printf("------------------------\n");
 }
@@ -0,0 +1,70 @@
+#include "../include/event.h"
+#include "../include/sim_clock.h"
+
+#include <limits.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+// Not FUTEX_PRIVATE: the events are shared between processes
+static long futex(unsigned int *word, int op, unsigned int value, const struct timespec *timeout) {
+    return syscall(SYS_futex, word, op, value, timeout, NULL, 0);
+}
+
+// Snapshot of the sequence; take it before checking for pending work
+unsigned int event_prepare(SimEvent *event) {
+    return __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE);
+}
+
+// Sleep until the event is signalled after seen, or for timeout_ms simulated
+// milliseconds (forever when negative); returns true if it was signalled
+bool event_wait_ms(SimEvent *event, unsigned int seen, long timeout_ms) {
+    struct timespec timeout;
+
+    // On the virtual clock an actor's deadline is the clock's business
+    if (sim_clock_is_actor()) {
+        return sim_clock_wait(event, seen, timeout_ms);
+    }
+
+    if (__atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE) != seen) {
+        return true;
+    }
+    if (timeout_ms < 0) {
+        return event_wait_wall(event, seen, NULL);
+    }
+
+    double scale = sim_clock_virtual() ? SIM_CLOCK_FAST_SCALE : sim_clock_scale();
+    double wall_us = (double)timeout_ms * 1000.0 / scale;
+    if (wall_us < SIM_CLOCK_MIN_SLEEP_US) {
+        sched_yield();
+        return __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE) != seen;
+    }
+    timeout.tv_sec = (time_t)(wall_us / 1e6);
+    timeout.tv_nsec = (long)((wall_us - (double)timeout.tv_sec * 1e6) * 1000.0);
+    return event_wait_wall(event, seen, &timeout);
+}
+
+// Sleep until the event is signalled after seen or a wall timeout expires
+// (forever when NULL); returns true if it was signalled
+bool event_wait_wall(SimEvent *event, unsigned int seen, const struct timespec *timeout) {
+    if (__atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE) != seen) {
+        return true;
+    }
+
+    // Announce ourselves before the last check, so a signaller either sees
+    // a waiter or we see its new sequence
+    __atomic_add_fetch(&event->waiters, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&event->sequence, __ATOMIC_SEQ_CST) == seen) {
+        futex(&event->sequence, FUTEX_WAIT, seen, timeout);
+    }
+    __atomic_sub_fetch(&event->waiters, 1, __ATOMIC_RELEASE);
+
+    return __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE) != seen;
+}
+
+void event_signal(SimEvent *event) {
+    __atomic_add_fetch(&event->sequence, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&event->waiters, __ATOMIC_SEQ_CST) > 0) {
+        futex(&event->sequence, FUTEX_WAKE, INT_MAX, NULL);
+    }
+}
@@ -1,55 +1,86 @@
 #include "../include/gang.h"
 #include "../include/ipc.h"
+#include "../include/utils.h"
+#include "../include/sim_clock.h"
+#include "../include/member_kernels.h"
+#include "../include/shared_state.h"
+#include "../include/bitset.h"
+#include "../include/trace.h"
+#include "../include/checkpoint.h"
 
-#include <fcntl.h>
 static volatile sig_atomic_t gang_shutdown_requested = 0;
 void gang_signal_handler(int sig) {
     gang_shutdown_requested = 1;
+    // Nobody may be left to move a virtual clock on to our wakeup
+    sim_clock_stop();
 }
+
+static inline GangMetrics *gang_metrics(Gang *gang) {
+    return shared_gang_metrics(gang_shared_state(gang), gang->id);
+}
+
+// Take the gang lock, counting the acquisitions that had to wait for it
+void gang_lock(Gang *gang) {
+    if (pthread_mutex_trylock(&gang->lock) == 0) {
+        return;
+    }
+    uint64_t start = metrics_now_ns();
+    pthread_mutex_lock(&gang->lock);
+    GangMetrics *metrics = gang_metrics(gang);
+    metric_add(&metrics->lock_waits, 1);
+    metric_add(&metrics->lock_wait_ns, metrics_now_ns() - start);
+}
+
 int gang_init(Gang *gang, int id, int member_count, SimConfig *config) {
-    if (!gang || member_count <= 0 || member_count > MAX_MEMBERS) {
+    if (!gang || member_count <= 0) {
         return -1;
     }
 
+    // The gang sits in the shared gang table, so its slot locates the layout
     memset(gang, 0, sizeof(Gang));
     gang->id = id;
+    gang->member_capacity = gang_shared_state(gang)->layout.member_capacity;
+    gang->member_base = id * gang->member_capacity;
+    gang->wake_slot = id;
+    if (member_count > gang->member_capacity) {
+        return -1;
+    }
     gang->member_count = member_count;
     gang->active_mission_count = 0;
     gang->next_mission_id = 0;
     gang->successful_missions = 0;
     gang->failed_missions = 0;
+    gang->executed_agents = 0;
     
     // Initialize missions array
-    for (int i = 0; i < MAX_CONCURRENT_MISSIONS; i++) {
-        gang->missions[i].mission_id = -1;
-        gang->missions[i].in_progress = false;
-        gang->missions[i].disrupted = false;
-        gang->missions[i].assigned_count = 0;
+    Mission *missions = gang_missions(gang);
+    for (int i = 0; i < gang_mission_capacity(gang); i++) {
+        missions[i].mission_id = -1;
+        missions[i].in_progress = false;
+        missions[i].disrupted = false;
+        missions[i].assigned_count = 0;
     }
     
     // Initialize members
+    MemberStore ms = gang_members(gang);
     for (int i = 0; i < member_count; i++) {
-        gang->members[i].id = i;
-        gang->members[i].gang_id = id;
-        gang->members[i].rank = 0; // Start at lowest rank
-        gang->members[i].is_agent = false;
-        gang->members[i].agent_id = -1;
-        gang->members[i].status = MEMBER_STATUS_ACTIVE;
-        gang->members[i].assigned_mission_id = -1; // Not assigned to any mission
-        gang->members[i].preparation_level = 0.0f;
-        gang->members[i].knowledge_level = 0.0f;
-        gang->members[i].release_time = 0;
-    }
-    
-    // Create member semaphore
-    char sem_name[32];
-    snprintf(sem_name, sizeof(sem_name), "/gang_sem_%d", id);
-    gang->member_semaphore = sem_open(sem_name, O_CREAT, 0644, 1);
-    if (gang->member_semaphore == SEM_FAILED) {
-        perror("sem_open failed");
+        ms.rank[i] = 0; // Start at lowest rank
+        ms.agent_id[i] = -1;
+        set_member_status(gang, &ms, i, MEMBER_STATUS_ACTIVE);
+        set_member_mission(gang, &ms, i, -1, -1); // Not assigned to any mission
+        ms.preparation_level[i] = 0.0f;
+        ms.knowledge_level[i] = 0.0f;
+        ms.release_time[i] = 0;
+        rng_seed_stream(&ms.rng[i], RNG_STREAM_MEMBER(id, i));
+    }
+    rng_seed_stream(&gang->rng, RNG_STREAM_GANG(id));
+    
+    // Create the gang lock; it lives in the segment and is shared with the police
+    if (init_shared_mutex(&gang->lock) != 0) {
         return -1;
     }
     
+    update_gang_status(gang_shared_state(gang), gang);
     return 0;
 }
 
@@ -59,133 +90,288 @@ void gang_process_main(int gang_id, SimConfig *config, int msg_queue_id, int sha
     // Attach to shared memory
     SharedState *shared_state = (SharedState *)attach_shared_memory(shared_mem_id);
     if (!shared_state) {
-        log_message("Gang %d: Failed to attach to shared memory", gang_id);
+        log_error("Gang %d: Failed to attach to shared memory", gang_id);
         exit(EXIT_FAILURE);
     }
     
-    // Initialize gang
-    Gang *gang = &shared_state->gangs[gang_id];
-    gang->process_id = getpid();
-    gang->shared_state = shared_state;
-    log_message("Gang %d: Process started (PID: %d)", gang_id, gang->process_id);
+    ipc_attach_state(shared_state);
+    sim_clock_attach(shared_state);
+    sim_clock_join();
+    shared_gang(shared_state, gang_id)->process_id = getpid();
+    log_message("Gang %d: Process started (PID: %d)", gang_id, getpid());
     
-    // Create gang member threads
-    pthread_t member_threads[MAX_MEMBERS];
-    GangMemberArgs *member_args = malloc(sizeof(GangMemberArgs) * gang->member_count);
-    
-    if (!member_args) {
-        log_message("Gang %d: Failed to allocate memory for member thread arguments", gang_id);
+    // Members run as tasks on a small pool instead of one thread each. The
+    // gang processes split the cores between them; a gang left with a
+    // single core runs its members on this thread
+    int num_workers = config->worker_threads;
+    if (num_workers == 0) {
+        num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN) / config->num_gangs;
+        if (num_workers < 2) {
+            num_workers = 0;
+        }
+    }
+    GangRuntime *runtime = calloc(1, sizeof(GangRuntime));
+    if (!runtime || gang_runtime_start(runtime, gang_id, config, msg_queue_id, shared_state, num_workers) != 0) {
+        log_error("Gang %d: Failed to create member worker pool", gang_id);
+        free(runtime);
         detach_shared_memory(shared_state);
         exit(EXIT_FAILURE);
     }
     
-    for (int i = 0; i < gang->member_count; i++) {
-        member_args[i].member_index = i;
-        member_args[i].gang = gang;
-        member_args[i].config = config;
-        member_args[i].msg_queue_id = msg_queue_id;
-        member_args[i].shared_state = shared_state;
-        
-        if (pthread_create(&member_threads[i], NULL, gang_member_thread, &member_args[i]) != 0) {
-            log_message("Gang %d: Failed to create member thread %d", gang_id, i);
-            continue;
+    // Main gang process loop
+    while (!gang_shutdown_requested && gang_tick(runtime)) {
+        // Sleep until the next tick, handling arrest orders as they arrive
+        gang_wait(runtime, GANG_TICK_MS);
+    }
+    
+    // Cleanup and exit
+    sim_clock_leave();
+    gang_runtime_stop(runtime);
+    free(runtime);
+    sim_clock_attach(NULL);
+    detach_shared_memory(shared_state);
+    exit(EXIT_SUCCESS);
+}
+
+static void gang_runtime_free(GangRuntime *runtime) {
+    pool_destroy(runtime->pool);
+    runtime->pool = NULL;
+    free(runtime->next_step_ms);
+    runtime->next_step_ms = NULL;
+    free(runtime->tasks);
+    runtime->tasks = NULL;
+    free(runtime->scratch_mask);
+    runtime->scratch_mask = NULL;
+    free(runtime->scratch_values);
+    runtime->scratch_values = NULL;
+    free(runtime->scratch_flags);
+    runtime->scratch_flags = NULL;
+    social_graph_free(&runtime->graph);
+}
+
+// One scratch slot per member slot, padded to whole kernel lanes
+static void *scratch_alloc(const Gang *gang, size_t element_size) {
+    return aligned_alloc(SHARED_ALIGNMENT, SHARED_ALIGN((size_t)gang->member_capacity * element_size));
+}
+
+int gang_runtime_start(GangRuntime *runtime, int gang_id, SimConfig *config, int msg_queue_id,
+                       SharedState *shared_state, int num_workers) {
+    Gang *gang = shared_gang(shared_state, gang_id);
+    
+    memset(runtime, 0, sizeof(GangRuntime));
+    runtime->gang = gang;
+    runtime->config = config;
+    runtime->msg_queue_id = msg_queue_id;
+    runtime->shared_state = shared_state;
+    
+    runtime->next_step_ms = malloc(sizeof(long long) * gang->member_capacity);
+    runtime->tasks = malloc(sizeof(MemberTask) * gang->member_capacity);
+    runtime->scratch_mask = scratch_alloc(gang, sizeof(float));
+    runtime->scratch_values = scratch_alloc(gang, sizeof(float));
+    runtime->scratch_flags = scratch_alloc(gang, sizeof(unsigned char));
+    if (!runtime->next_step_ms || !runtime->tasks || !runtime->scratch_mask ||
+        !runtime->scratch_values || !runtime->scratch_flags ||
+        social_graph_init(&runtime->graph, gang->member_capacity, gang_mission_capacity(gang),
+                          shared_state->layout.mission_member_capacity) != 0) {
+        gang_runtime_free(runtime);
+        return -1;
+    }
+    
+    // Without workers the member steps run on the caller's thread
+    if (num_workers > 0) {
+        if (num_workers > gang->member_count) {
+            num_workers = gang->member_count;
         }
-        
-        gang->members[i].thread_id = member_threads[i];
+        runtime->pool = pool_create(num_workers);
+        if (!runtime->pool) {
+            gang_runtime_free(runtime);
+            return -1;
+        }
+        log_message("Gang %d: Running %d members on %d worker threads", gang_id,
+                    gang->member_count, pool_worker_count(runtime->pool));
     }
     
-    // Main gang process loop
-    IpcMessage message;
-    bool running = true;
+    long long now_ms = sim_time_ms();
+    for (int i = 0; i < gang->member_count; i++) {
+        runtime->tasks[i].member_index = i;
+        runtime->tasks[i].runtime = runtime;
+        runtime->next_step_ms[i] = now_ms;
+    }
     
     // Start with one initial mission
+    rng_bind_thread(&gang->rng);
     create_new_mission(gang, config);
+    return 0;
+}
+
+// Apply every pending arrest order; the caller holds the gang lock
+static void process_police_orders(GangRuntime *runtime) {
+    Gang *gang = runtime->gang;
+    IpcMessage message;
     
-    while (running && !gang_shutdown_requested) {
-        // Check for messages from police (using gang-specific message type)
-        if (receive_message(msg_queue_id, &message, MSG_TYPE_POLICE_ORDER(gang_id), true) == 0) {
-            log_message("Gang %d: Received arrest order for %d days", gang_id, message.data.police_order.arrest_duration);
-            process_arrest(gang, message.data.police_order.arrest_duration);
-        }
-        
-        // Check simulation status
-        if (shared_state->status != SIM_STATUS_RUNNING || gang_shutdown_requested) {
-            running = false;
-            log_message("Gang %d: Detected shutdown request", gang_id);
-            break;
-        }
-        
-        // Update shared state
-        pthread_mutex_lock(&shared_state->status_mutex);
-        memcpy(&shared_state->gangs[gang_id], gang, sizeof(Gang));
-        pthread_mutex_unlock(&shared_state->status_mutex);
-        
-        // Check simulation status
-        if (shared_state->status != SIM_STATUS_RUNNING) {
-            running = false;
-            continue;
-        }
-        
-        // Main gang logic - handle multiple concurrent missions
-        // Check and execute ready missions
-        check_and_execute_ready_missions(gang, config, msg_queue_id);
+    while (receive_message(runtime->msg_queue_id, &message, MSG_TYPE_POLICE_ORDER(gang->id), true) == 0) {
+        log_message("Gang %d: Received arrest order for %d days", gang->id, message.data.police_order.arrest_duration);
+        process_arrest(gang, message.data.police_order.arrest_duration);
+    }
+}
+
+void gang_handle_orders(GangRuntime *runtime) {
+    gang_lock(runtime->gang);
+    process_police_orders(runtime);
+    pthread_mutex_unlock(&runtime->gang->lock);
+}
+
+// Sleep ms simulated milliseconds, waking early only to handle arrest orders
+void gang_wait(GangRuntime *runtime, long ms) {
+    SharedState *shared_state = runtime->shared_state;
+    SimEvent *event = shared_wake_event(shared_state, runtime->gang->wake_slot);
+    long long deadline = sim_time_ms() + ms;
+    
+    for (;;) {
+        unsigned int seen = event_prepare(event);
+        gang_handle_orders(runtime);
         
-        // Try to create new missions if we have available members and mission slots
-        int available_members = get_available_members_count(gang);
-        if (available_members >= config->mission_members_count && 
-            gang->active_mission_count < MAX_CONCURRENT_MISSIONS) {
-            create_new_mission(gang, config);
+        long long remaining = deadline - sim_time_ms();
+        if (remaining <= 0 || get_simulation_status(shared_state) != SIM_STATUS_RUNNING) {
+            return;
         }
-        
-        // Replace any dead members
-        recruit_new_members(gang, config);
-        
-        // Promote members occasionally
-        if (rand_float() < config->promotion_base_chance) {
-            promote_members(gang, config);
+        if (!event_wait_ms(event, seen, remaining)) {
+            return;
         }
-        
-        // Sleep to avoid consuming too much CPU
-        usleep(100000); // 100ms
     }
+}
+
+// One pass of the gang main loop; returns false once the gang should stop
+bool gang_tick(GangRuntime *runtime) {
+    Gang *gang = runtime->gang;
+    SimConfig *config = runtime->config;
+    SharedState *shared_state = runtime->shared_state;
+    int gang_id = gang->id;
+    int msg_queue_id = runtime->msg_queue_id;
     
-    // Cleanup and exit
-    log_message("Gang %d: Shutting down", gang_id);
+    // Several gangs may share this thread
+    rng_bind_thread(&gang->rng);
     
-    // Cancel all member threads
-    for (int i = 0; i < gang->member_count; i++) {
-        if (gang->members[i].thread_id) {
-            pthread_cancel(gang->members[i].thread_id);
-        }
+    // Other actors only take this lock to change our members (infiltration)
+    gang_lock(gang);
+    metric_add(&gang_metrics(gang)->ticks, 1);
+    
+    // Check for messages from police (using gang-specific message type)
+    process_police_orders(runtime);
+    
+    // Check simulation status
+    if (get_simulation_status(shared_state) != SIM_STATUS_RUNNING) {
+        pthread_mutex_unlock(&gang->lock);
+        log_message("Gang %d: Detected shutdown request", gang_id);
+        return false;
     }
     
-    // Join all threads
-    for (int i = 0; i < gang->member_count; i++) {
-        if (gang->members[i].thread_id) {
-            pthread_join(gang->members[i].thread_id, NULL);
-        }
+    // Run the members whose next step is due
+    schedule_member_steps(runtime);
+    
+    // Members talk to their neighbors in the social graph
+    diffuse_knowledge(runtime);
+    
+    // Main gang logic - handle multiple concurrent missions
+    // Advance preparation and knowledge of every member on a mission
+    update_mission_members(runtime);
+    
+    // Check and execute ready missions
+    check_and_execute_ready_missions(gang, config, msg_queue_id);
+    
+    // Try to create a new mission; it checks for members and slots itself
+    create_new_mission(gang, config);
+    
+    // Replace any dead members
+    recruit_new_members(gang, config);
+    
+    // Promote members occasionally
+    if (rand_float() < config->promotion_base_chance) {
+        promote_members(runtime);
     }
     
-    gang_cleanup(gang);
-    free(member_args);  // Don't forget to free allocated memory
-    detach_shared_memory(shared_state);
-    exit(EXIT_SUCCESS);
+    // Let the monitor and the visualization see this tick's progress
+    update_gang_status(shared_state, gang);
+    
+    // Copy the gang into the checkpoint while its lock keeps the members still
+    if (!runtime->checkpointed && checkpoint_requested()) {
+        checkpoint_save_gang(gang);
+        runtime->checkpointed = true;
+    }
+    pthread_mutex_unlock(&gang->lock);
+    
+    return true;
 }
 
-int get_available_members_count(Gang *gang) {
-    int count = 0;
-    for (int i = 0; i < gang->member_count; i++) {
-        if (gang->members[i].status == MEMBER_STATUS_ACTIVE && 
-            gang->members[i].assigned_mission_id == -1) {
-            count++;
-        }
+void gang_runtime_stop(GangRuntime *runtime) {
+    log_message("Gang %d: Shutting down", runtime->gang->id);
+    
+    // Member steps only run inside schedule_member_steps, so none is in flight
+    gang_runtime_free(runtime);
+    
+    gang_cleanup(runtime->gang);
+}
+
+
+// Take a member out of its mission's count of unprepared members
+static void drop_unprepared(Gang *gang, MemberStore *ms, int member_index) {
+    if (!bitset_test(ms->unprepared_bits, member_index)) {
+        return;
+    }
+    bitset_clear(ms->unprepared_bits, member_index);
+    Mission *mission = member_mission(gang, ms, member_index);
+    if (mission) {
+        mission->unprepared_count--;
+    }
+}
+
+// Every status change goes through here so the bitsets match the arrays;
+// a member who is no longer active no longer holds up its mission
+void set_member_status(Gang *gang, MemberStore *ms, int member_index, MemberStatus status) {
+    if (status != MEMBER_STATUS_ACTIVE) {
+        drop_unprepared(gang, ms, member_index);
+    }
+    ms->status[member_index] = status;
+    bitset_assign(ms->active_bits, member_index, status == MEMBER_STATUS_ACTIVE);
+    bitset_assign(ms->arrested_bits, member_index, status == MEMBER_STATUS_ARRESTED);
+}
+
+// A member's mission is a slot in the gang's table plus the mission ID,
+// which no later mission in that slot will share. An active member below
+// the mission's required preparation is counted in its unprepared_count
+void set_member_mission(Gang *gang, MemberStore *ms, int member_index, int slot, int mission_id) {
+    drop_unprepared(gang, ms, member_index);
+    ms->assigned_mission_id[member_index] = mission_id;
+    ms->assigned_mission_slot[member_index] = slot;
+    bitset_assign(ms->assigned_bits, member_index, mission_id != -1);
+    
+    Mission *mission = member_mission(gang, ms, member_index);
+    if (mission && ms->status[member_index] == MEMBER_STATUS_ACTIVE &&
+        ms->preparation_level[member_index] < mission->required_preparation_level) {
+        bitset_set(ms->unprepared_bits, member_index);
+        mission->unprepared_count++;
     }
-    return count;
+}
+
+// The mission a member is on, or NULL if none or its slot has moved on
+Mission *member_mission(Gang *gang, const MemberStore *ms, int member_index) {
+    int slot = ms->assigned_mission_slot[member_index];
+    if (slot < 0) {
+        return NULL;
+    }
+    Mission *mission = &gang_missions(gang)[slot];
+    return mission->mission_id == ms->assigned_mission_id[member_index] ? mission : NULL;
+}
+
+// Active members not on a mission
+int get_available_members_count(Gang *gang) {
+    MemberStore ms = gang_members(gang);
+    return bitset_count_and_not(ms.active_bits, ms.assigned_bits, gang->member_count);
 }
 
 int create_new_mission(Gang *gang, SimConfig *config) {
     // Check if we can create a new mission
-    if (gang->active_mission_count >= MAX_CONCURRENT_MISSIONS) {
+    if (gang->active_mission_count >= gang_mission_capacity(gang)) {
         return -1; // No slots available
     }
     
@@ -196,9 +382,10 @@ int create_new_mission(Gang *gang, SimConfig *config) {
     }
     
     // Find an empty mission slot
+    Mission *missions = gang_missions(gang);
     int mission_slot = -1;
-    for (int i = 0; i < MAX_CONCURRENT_MISSIONS; i++) {
-        if (gang->missions[i].mission_id == -1) {
+    for (int i = 0; i < gang_mission_capacity(gang); i++) {
+        if (missions[i].mission_id == -1) {
             mission_slot = i;
             break;
         }
@@ -209,9 +396,9 @@ int create_new_mission(Gang *gang, SimConfig *config) {
     }
     
     // Initialize the new mission
-    Mission *mission = &gang->missions[mission_slot];
+    Mission *mission = &missions[mission_slot];
     mission->mission_id = gang->next_mission_id++;
-    mission->target = rand() % TARGET_COUNT;
+    mission->target = rand_range(0, TARGET_COUNT - 1);
     mission->preparation_time = rand_range(config->preparation_time_min, config->preparation_time_max);
     
     // Set required preparation level (scaled based on target difficulty)
@@ -223,31 +410,27 @@ int create_new_mission(Gang *gang, SimConfig *config) {
     mission->in_progress = true;
     mission->disrupted = false;
     mission->assigned_count = 0;
-    mission->start_time = time(NULL);
+    mission->unprepared_count = 0;
+    mission->start_time = sim_time();
     
     // Assign members to this mission
     assign_members_to_mission(gang, mission, config);
     
     gang->active_mission_count++;
+    metric_add(&gang_metrics(gang)->missions_created, 1);
     
     log_message("Gang %d: Created new mission %d targeting %s with %d members", 
                 gang->id, mission->mission_id, get_target_name(mission->target), mission->assigned_count);
+    trace_event(TRACE_MISSION_CREATED, gang->id, mission->mission_id, mission->target,
+                mission->assigned_count, mission->required_preparation_level);
     
     return mission->mission_id;
 }
 
 void assign_members_to_mission(Gang *gang, Mission *mission, SimConfig *config) {
-    // Get list of available members
-    int available_members[MAX_MEMBERS];
-    int available_count = 0;
-    
-    for (int i = 0; i < gang->member_count; i++) {
-        if (gang->members[i].status == MEMBER_STATUS_ACTIVE && 
-            gang->members[i].assigned_mission_id == -1) {
-            available_members[available_count] = i;
-            available_count++;
-        }
-    }
+    MemberStore ms = gang_members(gang);
+    int *assigned = mission_assigned_members(gang, mission);
+    int available_count = get_available_members_count(gang);
     
     // Determine how many members to assign
     int members_to_assign = config->mission_members_count;
@@ -255,48 +438,102 @@ void assign_members_to_mission(Gang *gang, Mission *mission, SimConfig *config)
         members_to_assign = available_count;
     }
     
-    // Randomly select and assign members
+    // Draw members without replacement: pick the random_index-th member
+    // still available; assigning it clears it from the available bits, so
+    // each draw costs one pass over the words and nothing is shifted
     mission->assigned_count = 0;
     for (int i = 0; i < members_to_assign; i++) {
-        int random_index = rand() % available_count;
-        int selected_member = available_members[random_index];
+        int random_index = rand_range(0, available_count - 1);
+        int selected_member = bitset_select_and_not(ms.active_bits, ms.assigned_bits,
+                                                    gang->member_count, random_index);
         
-        // Assign member to mission
-        gang->members[selected_member].assigned_mission_id = mission->mission_id;
-        gang->members[selected_member].preparation_level = 0.0f;
-        gang->members[selected_member].knowledge_level = 0.0f;
+        // Assign member to mission, starting from scratch
+        ms.preparation_level[selected_member] = 0.0f;
+        ms.knowledge_level[selected_member] = 0.0f;
+        set_member_mission(gang, &ms, selected_member, (int)(mission - gang_missions(gang)), mission->mission_id);
         
-        mission->assigned_members[mission->assigned_count] = selected_member;
+        assigned[mission->assigned_count] = selected_member;
         mission->assigned_count++;
-        
-        // Remove selected member from available list
-        for (int j = random_index; j < available_count - 1; j++) {
-            available_members[j] = available_members[j + 1];
-        }
         available_count--;
     }
 }
 
-void check_and_execute_ready_missions(Gang *gang, SimConfig *config, int msg_queue_id) {
-    for (int i = 0; i < MAX_CONCURRENT_MISSIONS; i++) {
-        Mission *mission = &gang->missions[i];
-        
+void update_mission_members(GangRuntime *runtime) {
+    Gang *gang = runtime->gang;
+    SimConfig *config = runtime->config;
+    MemberStore ms = gang_members(gang);
+    Mission *missions = gang_missions(gang);
+    float *work_mask = runtime->scratch_mask;
+    bool any_work = false;
+    
+    memset(work_mask, 0, sizeof(float) * gang->member_capacity);
+    
+    // Select the active members of every live mission
+    for (int i = 0; i < gang_mission_capacity(gang); i++) {
+        Mission *mission = &missions[i];
         if (mission->mission_id == -1 || !mission->in_progress || mission->disrupted) {
             continue;
         }
-        
-        // Check if all assigned members are prepared
-        bool all_prepared = true;
+        int *assigned = mission_assigned_members(gang, mission);
         for (int j = 0; j < mission->assigned_count; j++) {
-            int member_idx = mission->assigned_members[j];
-            if (gang->members[member_idx].status == MEMBER_STATUS_ACTIVE &&
-                gang->members[member_idx].preparation_level < mission->required_preparation_level) {
-                all_prepared = false;
-                break;
+            int member_idx = assigned[j];
+            if (ms.status[member_idx] == MEMBER_STATUS_ACTIVE &&
+                ms.assigned_mission_id[member_idx] == mission->mission_id) {
+                work_mask[member_idx] = 1.0f;
+                any_work = true;
+            }
+        }
+    }
+    
+    if (!any_work) {
+        return;
+    }
+    
+    // Members used to work once per member step; scale to one gang tick
+    float tick_scale = (2.0f * GANG_TICK_MS) / (MEMBER_STEP_MIN_MS + MEMBER_STEP_MAX_MS);
+    MissionProgressParams params = {
+        .prep_base = config->base_preparation_increment * tick_scale,
+        .prep_rank = config->rank_preparation_bonus * tick_scale,
+        .info_base = config->info_spread_base_value * tick_scale,
+        .info_rank = config->info_spread_rank_factor * tick_scale,
+        .inv_ranks = 1.0f / config->num_ranks
+    };
+    
+    member_mission_progress_kernel(ms.preparation_level, ms.knowledge_level, ms.rank,
+                                   work_mask, gang->member_count, &params);
+    
+    // Preparation only grows on a mission, so only the members still
+    // counted as unprepared can cross their mission's threshold
+    for (int w = 0; w < BITSET_WORDS(gang->member_count); w++) {
+        uint64_t word = ms.unprepared_bits[w] & bitset_word_limit(w, gang->member_count);
+        for (; word; word &= word - 1) {
+            int member_idx = w * BITSET_WORD_BITS + __builtin_ctzll(word);
+            Mission *mission = member_mission(gang, &ms, member_idx);
+            if (mission && ms.preparation_level[member_idx] >= mission->required_preparation_level) {
+                drop_unprepared(gang, &ms, member_idx);
             }
         }
+    }
+}
+
+void check_and_execute_ready_missions(Gang *gang, SimConfig *config, int msg_queue_id) {
+    Mission *missions = gang_missions(gang);
+    
+    for (int i = 0; i < gang_mission_capacity(gang); i++) {
+        Mission *mission = &missions[i];
+        
+        if (mission->mission_id == -1 || !mission->in_progress) {
+            continue;
+        }
+        
+        // A mission broken up by arrests is dropped so its slot can be reused
+        if (mission->disrupted) {
+            abandon_mission(gang, mission);
+            continue;
+        }
         
-        if (all_prepared) {
+        // Ready once no active member is still below the required level
+        if (mission->unprepared_count == 0) {
             // Execute the mission
             bool success = execute_mission(gang, mission, config, msg_queue_id);
             complete_mission(gang, mission, success, config, msg_queue_id);
@@ -308,14 +545,17 @@ bool execute_mission(Gang *gang, Mission *mission, SimConfig *config, int msg_qu
     log_message("Gang %d: Executing mission %d for target: %s", 
                 gang->id, mission->mission_id, get_target_name(mission->target));
     
+    MemberStore ms = gang_members(gang);
+    int *assigned = mission_assigned_members(gang, mission);
+    
     // Calculate success probability based on assigned members' preparation
     float avg_preparation = 0.0f;
     int active_assigned = 0;
     
     for (int i = 0; i < mission->assigned_count; i++) {
-        int member_idx = mission->assigned_members[i];
-        if (gang->members[member_idx].status == MEMBER_STATUS_ACTIVE) {
-            avg_preparation += gang->members[member_idx].preparation_level;
+        int member_idx = assigned[i];
+        if (ms.status[member_idx] == MEMBER_STATUS_ACTIVE) {
+            avg_preparation += ms.preparation_level[member_idx];
             active_assigned++;
         }
     }
@@ -332,18 +572,18 @@ bool execute_mission(Gang *gang, Mission *mission, SimConfig *config, int msg_qu
     
     // Handle casualties for assigned members only
     for (int i = 0; i < mission->assigned_count; i++) {
-        int member_idx = mission->assigned_members[i];
-        if (gang->members[member_idx].status == MEMBER_STATUS_ACTIVE) {
+        int member_idx = assigned[i];
+        if (ms.status[member_idx] == MEMBER_STATUS_ACTIVE) {
             if (rand_float() < config->mission_kill_probability) {
-                gang->members[member_idx].status = MEMBER_STATUS_DEAD;
-                gang->members[member_idx].assigned_mission_id = -1;
-                log_message("Gang %d, Member %d: Died during mission %d", 
+                set_member_status(gang, &ms, member_idx, MEMBER_STATUS_DEAD);
+                set_member_mission(gang, &ms, member_idx, -1, -1);
+                log_verbose("Gang %d, Member %d: Died during mission %d", 
                            gang->id, member_idx, mission->mission_id);
+                trace_event(TRACE_MEMBER_KILLED, gang->id, member_idx, 0, mission->mission_id, 0.0f);
+                metric_add(&gang_metrics(gang)->members_killed, 1);
                 
-                if (gang->members[member_idx].is_agent) {
-                    sem_wait(gang->member_semaphore);
-                    update_agent_status(gang->shared_state, gang->members[member_idx].agent_id, AGENT_STATUS_DEAD);
-                    sem_post(gang->member_semaphore);
+                if (ms.agent_id[member_idx] >= 0) {
+                    update_agent_status(gang_shared_state(gang), ms.agent_id[member_idx], AGENT_STATUS_DEAD);
                 }
             }
         }
@@ -357,26 +597,31 @@ void complete_mission(Gang *gang, Mission *mission, bool success, SimConfig *con
         gang->successful_missions++;
         log_message("Gang %d: Mission %d successful! Total successful: %d", 
                    gang->id, mission->mission_id, gang->successful_missions);
+        trace_event(TRACE_MISSION_SUCCEEDED, gang->id, mission->mission_id, mission->target, 0, 0.0f);
+        metric_add(&gang_metrics(gang)->missions_succeeded, 1);
         
-        // Update shared state statistics
-        pthread_mutex_lock(&gang->shared_state->status_mutex);
-        gang->shared_state->total_successful_plans++;
-        pthread_mutex_unlock(&gang->shared_state->status_mutex);
+        // Update shared state statistics; the police checks the win conditions
+        __atomic_add_fetch(&gang_shared_state(gang)->total_successful_plans, 1, __ATOMIC_RELAXED);
+        notify_police(gang_shared_state(gang));
     } else {
         gang->failed_missions++;
         log_message("Gang %d: Mission %d failed! Total failures: %d", 
                    gang->id, mission->mission_id, gang->failed_missions);
+        trace_event(TRACE_MISSION_FAILED, gang->id, mission->mission_id, mission->target, 0, 0.0f);
+        metric_add(&gang_metrics(gang)->missions_failed, 1);
         
         // Investigate for agents on failed missions
         investigate_mission_for_agents(gang, mission, config, msg_queue_id);
     }
     
     // Free up assigned members
+    MemberStore ms = gang_members(gang);
+    int *assigned = mission_assigned_members(gang, mission);
     for (int i = 0; i < mission->assigned_count; i++) {
-        int member_idx = mission->assigned_members[i];
-        if (gang->members[member_idx].status == MEMBER_STATUS_ACTIVE) {
-            gang->members[member_idx].assigned_mission_id = -1;
-            gang->members[member_idx].preparation_level = 0.0f;
+        int member_idx = assigned[i];
+        if (ms.status[member_idx] == MEMBER_STATUS_ACTIVE) {
+            set_member_mission(gang, &ms, member_idx, -1, -1);
+            ms.preparation_level[member_idx] = 0.0f;
         }
     }
     
@@ -387,289 +632,305 @@ void complete_mission(Gang *gang, Mission *mission, bool success, SimConfig *con
     gang->active_mission_count--;
 }
 
+void abandon_mission(Gang *gang, Mission *mission) {
+    MemberStore ms = gang_members(gang);
+    int *assigned = mission_assigned_members(gang, mission);
+    
+    log_message("Gang %d: Mission %d abandoned after arrests", gang->id, mission->mission_id);
+    trace_event(TRACE_MISSION_ABANDONED, gang->id, mission->mission_id, mission->target, 0, 0.0f);
+    metric_add(&gang_metrics(gang)->missions_abandoned, 1);
+    
+    // Free any assigned members that escaped the arrest
+    for (int i = 0; i < mission->assigned_count; i++) {
+        int member_idx = assigned[i];
+        if (ms.assigned_mission_id[member_idx] == mission->mission_id) {
+            set_member_mission(gang, &ms, member_idx, -1, -1);
+            ms.preparation_level[member_idx] = 0.0f;
+        }
+    }
+    
+    mission->mission_id = -1;
+    mission->in_progress = false;
+    mission->disrupted = false;
+    mission->assigned_count = 0;
+    gang->active_mission_count--;
+}
+
 void investigate_mission_for_agents(Gang *gang, Mission *mission, SimConfig *config, int msg_queue_id) {
     log_message("Gang %d: Starting investigation for mission %d", gang->id, mission->mission_id);
     
     // Only investigate members who were assigned to this specific mission
+    MemberStore ms = gang_members(gang);
+    int *assigned = mission_assigned_members(gang, mission);
     for (int i = 0; i < mission->assigned_count; i++) {
-        int member_idx = mission->assigned_members[i];
-        GangMember *member = &gang->members[member_idx];
+        int member_idx = assigned[i];
         
-        if (member->status != MEMBER_STATUS_ACTIVE) {
+        if (ms.status[member_idx] != MEMBER_STATUS_ACTIVE) {
             continue;
         }
         
+        bool is_agent = ms.agent_id[member_idx] >= 0;
         float suspicion = 0.0f;
         
-        if (member->is_agent) {
+        if (is_agent) {
             suspicion += config->agent_base_suspicion;
             
             // Knowledge anomalies increase suspicion
-            if (member->knowledge_level < 0.5f * member->rank / (float)config->num_ranks) {
+            if (ms.knowledge_level[member_idx] < 0.5f * ms.rank[member_idx] / (float)config->num_ranks) {
                 suspicion += config->knowledge_anomaly_suspicion;
             }
         }
         
         suspicion += rand_float();
         
-        if (suspicion > config->agent_discovery_threshold && member->is_agent) {
+        if (suspicion > config->agent_discovery_threshold && is_agent) {
             log_message("Gang %d: Secret agent %d discovered in mission %d!", 
-                       gang->id, member->agent_id, mission->mission_id);
-            execute_agent(gang, member_idx, msg_queue_id, gang->shared_state);
+                       gang->id, ms.agent_id[member_idx], mission->mission_id);
+            execute_agent(gang, member_idx, msg_queue_id, gang_shared_state(gang));
         }
     }
 }
 
-void* gang_member_thread(void *arg) {
-    GangMemberArgs *args = (GangMemberArgs *)arg;
-    Gang *gang = args->gang;
-    int member_index = args->member_index;
-    SimConfig *config = args->config;
-    int msg_queue_id = args->msg_queue_id;
-    SharedState *shared_state = args->shared_state;
-    GangMember *member = &gang->members[member_index];
-    
-    log_message("Gang %d, Member %d: Thread started", gang->id, member_index);
-    
-    while (1) {
-        // Skip processing if member is arrested or dead
-        if (member->status != MEMBER_STATUS_ACTIVE) {
-            // If arrested, check if it's time to release
-            if (member->status == MEMBER_STATUS_ARRESTED && time(NULL) >= member->release_time) {
-                member->status = MEMBER_STATUS_ACTIVE;
-                member->preparation_level = 0.0f;
-                member->assigned_mission_id = -1; // Clear mission assignment
-                log_message("Gang %d, Member %d: Released from prison", gang->id, member_index);
-            } else {
-                // Sleep and continue
-                usleep(500000); // 500ms
-                continue;
-            }
+// Submit a step for every member that is due and wait for the batch
+void schedule_member_steps(GangRuntime *runtime) {
+    long long now_ms = sim_time_ms();
+    int submitted = 0;
+    
+    for (int i = 0; i < runtime->gang->member_count; i++) {
+        if (runtime->next_step_ms[i] > now_ms) {
+            continue;
         }
-        
-        // Check if simulation is still running
-        if (shared_state->status != SIM_STATUS_RUNNING) {
-            break;
+        if (runtime->pool) {
+            pool_submit(runtime->pool, gang_member_step, &runtime->tasks[i]);
+        } else {
+            gang_member_step(&runtime->tasks[i]);
         }
+        submitted++;
+    }
+    metric_add(&gang_metrics(runtime->gang)->member_steps, submitted);
+    
+    if (runtime->pool) {
+        if (submitted > 0) {
+            pool_wait(runtime->pool);
+        }
+    } else {
+        // Inline steps rebound this thread to the members' streams
+        rng_bind_thread(&runtime->gang->rng);
+    }
+}
+
+// One unit of a member's own activity; schedules the member's next step
+void gang_member_step(void *arg) {
+    MemberTask *task = (MemberTask *)arg;
+    GangRuntime *runtime = task->runtime;
+    Gang *gang = runtime->gang;
+    int member_index = task->member_index;
+    SimConfig *config = runtime->config;
+    MemberStore ms = gang_members(gang);
+    
+    rng_bind_thread(&ms.rng[member_index]);
+    
+    // Skip processing if member is arrested or dead
+    if (ms.status[member_index] != MEMBER_STATUS_ACTIVE) {
+        // If arrested, check if it's time to release
+        if (ms.status[member_index] == MEMBER_STATUS_ARRESTED && sim_time() >= ms.release_time[member_index]) {
+            set_member_status(gang, &ms, member_index, MEMBER_STATUS_ACTIVE);
+            ms.preparation_level[member_index] = 0.0f;
+            set_member_mission(gang, &ms, member_index, -1, -1); // Clear mission assignment
+            log_verbose("Gang %d, Member %d: Released from prison", gang->id, member_index);
+            trace_event(TRACE_MEMBER_RELEASED, gang->id, member_index, 0, 0, 0.0f);
+        } else if (ms.status[member_index] == MEMBER_STATUS_ARRESTED) {
+            // Nothing to do until the sentence is over
+            runtime->next_step_ms[member_index] = (long long)ms.release_time[member_index] * 1000;
+            return;
+        } else {
+            // Dead members are replaced by the gang loop; look again then
+            runtime->next_step_ms[member_index] = sim_time_ms() + GANG_TICK_MS;
+            return;
+        }
+    }
+    
+    // Preparation and knowledge are advanced in bulk by the gang loop;
+    // the member step only handles what the member does on its own
+    if (ms.assigned_mission_id[member_index] != -1 && ms.agent_id[member_index] >= 0) {
+        // The mission this member is assigned to
+        Mission *assigned_mission = member_mission(gang, &ms, member_index);
         
-        // Main member activities - only if assigned to a mission
-        if (member->assigned_mission_id != -1) {
-            // Find the mission this member is assigned to
-            Mission *assigned_mission = NULL;
-            for (int i = 0; i < MAX_CONCURRENT_MISSIONS; i++) {
-                if (gang->missions[i].mission_id == member->assigned_mission_id) {
-                    assigned_mission = &gang->missions[i];
-                    break;
-                }
-            }
+        // Secret agent activities (reporting to police)
+        if (assigned_mission && assigned_mission->in_progress && !assigned_mission->disrupted) {
+            float suspicion_threshold = config->agent_suspicion_threshold;
             
-            if (assigned_mission && assigned_mission->in_progress && !assigned_mission->disrupted) {
-                //  preparation level
-                float prep_increment = config->base_preparation_increment + 
-                    (config->rank_preparation_bonus * member->rank / (float)config->num_ranks);
-
-                member->preparation_level += prep_increment;
-                if (member->preparation_level > 1.0f) {
-                    member->preparation_level = 1.0f;
-                }
-                
-                // Gain knowledge about the mission
-                member->knowledge_level += config->info_spread_base_value + 
-                    config->info_spread_rank_factor * (member->rank / (float)config->num_ranks);
-                if (member->knowledge_level > 1.0f) {
-                    member->knowledge_level = 1.0f;
-                }
+            // Pool workers step members concurrently: only the first one
+            // to see knowledge records the time
+            if (ms.knowledge_level[member_index] > config->agent_initial_knowledge_threshold) {
+                time_t unset = 0;
+                __atomic_compare_exchange_n(&runtime->first_knowledge_time, &unset, sim_time(), false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            }
+            time_t first_knowledge_time = __atomic_load_n(&runtime->first_knowledge_time, __ATOMIC_RELAXED);
+                           
+            // Require at least some time to pass before reporting
+            time_t min_time_before_report = config->min_agent_report_time;
+            // Report to police when confidence is high enough AND enough time has passed
+            if (ms.knowledge_level[member_index] > suspicion_threshold && 
+                sim_time() - first_knowledge_time >= min_time_before_report) {
+                send_agent_report(runtime->msg_queue_id, ms.agent_id[member_index], gang->id, 
+                                 assigned_mission->target, ms.knowledge_level[member_index], 
+                                 sim_time() + assigned_mission->preparation_time);
+                notify_police(gang_shared_state(gang));
+                log_verbose("Gang %d, Agent %d: Reporting mission %d to police with confidence %.2f", 
+                           gang->id, ms.agent_id[member_index], assigned_mission->mission_id,
+                           ms.knowledge_level[member_index]);
+                trace_event(TRACE_AGENT_REPORT, gang->id, ms.agent_id[member_index], assigned_mission->target,
+                            assigned_mission->mission_id, ms.knowledge_level[member_index]);
+                metric_add(&gang_metrics(gang)->reports_sent, 1);
+                metric_add(&shared_agent_reports(gang_shared_state(gang))[ms.agent_id[member_index]], 1);
                 
-                // Secret agent activities (reporting to police)
-                if (member->is_agent) {
-                    float suspicion_threshold = config->agent_suspicion_threshold;
-                    static time_t first_knowledge_time = 0;
-                    
-                    if (member->knowledge_level > config->agent_initial_knowledge_threshold && 
-                        first_knowledge_time == 0) {
-                        first_knowledge_time = time(NULL);
-                    }
-                                   
-                    // Require at least some time to pass before reporting
-                    time_t min_time_before_report = config->min_agent_report_time;
-                    // Report to police when confidence is high enough AND enough time has passed
-                    if (member->knowledge_level > suspicion_threshold && 
-                        time(NULL) - first_knowledge_time >= min_time_before_report) {
-                        send_agent_report(msg_queue_id, member->agent_id, gang->id, 
-                                         assigned_mission->target, member->knowledge_level, 
-                                         time(NULL) + assigned_mission->preparation_time);
-                        log_message("Gang %d, Agent %d: Reporting mission %d to police with confidence %.2f", 
-                                   gang->id, member->agent_id, assigned_mission->mission_id, member->knowledge_level);
-                        
-                        // Reset knowledge level to avoid constant reporting
-                        member->knowledge_level *= config->agent_report_knowledge_reset;
-                    }
-                }
+                // Reset knowledge level to avoid constant reporting
+                ms.knowledge_level[member_index] *= config->agent_report_knowledge_reset;
             }
         }
-        
-        // Interact with other members to exchange information (regardless of mission assignment)
-        int target_index = rand() % gang->member_count;
-        if (target_index != member_index && gang->members[target_index].status == MEMBER_STATUS_ACTIVE) {
-            member_interaction(gang, member_index, target_index, config);
-        }
-        
-        // Random sleep to simulate varied activities
-        usleep(rand_range(100000, 300000)); // 100-300ms
     }
     
-    log_message("Gang %d, Member %d: Thread exiting", gang->id, member_index);
-    return NULL;
+    // Random delay to simulate varied activities
+    runtime->next_step_ms[member_index] = sim_time_ms() + rand_range(MEMBER_STEP_MIN_MS, MEMBER_STEP_MAX_MS);
 }
 
 void process_arrest(Gang *gang, int duration) {
-    time_t release_time = time(NULL) + duration;
-    
-    // Arrest only members assigned to missions that were thwarted
-    for (int i = 0; i < gang->member_count; i++) {
-        if (gang->members[i].status == MEMBER_STATUS_ACTIVE && 
-            gang->members[i].assigned_mission_id != -1) {
+    time_t release_time = sim_time() + duration;
+    MemberStore ms = gang_members(gang);
+    GangMetrics *metrics = gang_metrics(gang);
+    
+    // Arrest only members assigned to missions that were thwarted: the
+    // active members with their assigned bit set
+    for (int w = 0; w < BITSET_WORDS(gang->member_count); w++) {
+        uint64_t word = ms.active_bits[w] & ms.assigned_bits[w] & bitset_word_limit(w, gang->member_count);
+        for (; word; word &= word - 1) {
+            int i = w * BITSET_WORD_BITS + __builtin_ctzll(word);
             
-            // Find the mission and mark it as disrupted
-            for (int j = 0; j < MAX_CONCURRENT_MISSIONS; j++) {
-                if (gang->missions[j].mission_id == gang->members[i].assigned_mission_id) {
-                    gang->missions[j].disrupted = true;
-                    break;
-                }
+            // Mark the mission as disrupted
+            Mission *mission = member_mission(gang, &ms, i);
+            if (mission && !mission->disrupted) {
+                mission->disrupted = true;
+                metric_add(&metrics->missions_disrupted, 1);
             }
+            trace_event(TRACE_MEMBER_ARRESTED, gang->id, i, duration, ms.assigned_mission_id[i], 0.0f);
+            metric_add(&metrics->arrests, 1);
             
-            gang->members[i].status = MEMBER_STATUS_ARRESTED;
-            gang->members[i].release_time = release_time;
-            gang->members[i].preparation_level = 0.0f;
-            gang->members[i].assigned_mission_id = -1; // Clear mission assignment
-            log_message("Gang %d, Member %d: Arrested for %d seconds", gang->id, i, duration);
+            set_member_status(gang, &ms, i, MEMBER_STATUS_ARRESTED);
+            ms.release_time[i] = release_time;
+            ms.preparation_level[i] = 0.0f;
+            set_member_mission(gang, &ms, i, -1, -1); // Clear mission assignment
+            log_verbose("Gang %d, Member %d: Arrested for %d seconds", gang->id, i, duration);
         }
     }
 }
 
 void recruit_new_members(Gang *gang, SimConfig *config) {
-    for (int i = 0; i < gang->member_count; i++) {
-        if (gang->members[i].status == MEMBER_STATUS_DEAD || 
-            gang->members[i].status == MEMBER_STATUS_EXECUTED) {
+    MemberStore ms = gang_members(gang);
+    
+    // Dead and executed members are the ones neither active nor arrested
+    for (int w = 0; w < BITSET_WORDS(gang->member_count); w++) {
+        uint64_t word = ~(ms.active_bits[w] | ms.arrested_bits[w]) & bitset_word_limit(w, gang->member_count);
+        for (; word; word &= word - 1) {
+            int i = w * BITSET_WORD_BITS + __builtin_ctzll(word);
             
             // Recruit new member to replace
-            gang->members[i].status = MEMBER_STATUS_ACTIVE;
-            gang->members[i].rank = 0; // Start at lowest rank
-            gang->members[i].is_agent = false; // New recruits aren't agents
-            gang->members[i].agent_id = -1;
-            gang->members[i].assigned_mission_id = -1; // Not assigned to any mission
-            gang->members[i].preparation_level = 0.0f;
-            gang->members[i].knowledge_level = 0.0f;
+            set_member_status(gang, &ms, i, MEMBER_STATUS_ACTIVE);
+            ms.rank[i] = 0; // Start at lowest rank
+            ms.agent_id[i] = -1; // New recruits aren't agents
+            set_member_mission(gang, &ms, i, -1, -1); // Not assigned to any mission
+            ms.preparation_level[i] = 0.0f;
+            ms.knowledge_level[i] = 0.0f;
             
-            log_message("Gang %d: Recruited new member to replace %d", gang->id, i);
+            log_verbose("Gang %d: Recruited new member to replace %d", gang->id, i);
+            trace_event(TRACE_MEMBER_RECRUITED, gang->id, i, 0, 0, 0.0f);
+            metric_add(&gang_metrics(gang)->members_recruited, 1);
         }
     }
 }
 
-void promote_members(Gang *gang, SimConfig *config) {
+void promote_members(GangRuntime *runtime) {
+    Gang *gang = runtime->gang;
+    SimConfig *config = runtime->config;
+    MemberStore ms = gang_members(gang);
+    float *eligible = runtime->scratch_mask;
+    float *draws = runtime->scratch_values;
+    unsigned char *promoted = runtime->scratch_flags;
+    
+    // The kernels run over whole lanes, so the padding must be zero
+    memset(eligible, 0, sizeof(float) * gang->member_capacity);
+    memset(draws, 0, sizeof(float) * gang->member_capacity);
+    
     for (int i = 0; i < gang->member_count; i++) {
-        if (gang->members[i].status == MEMBER_STATUS_ACTIVE && 
-            gang->members[i].rank < config->num_ranks - 1) {
-            
-            // Chance of promotion increases with lower rank
-            float promotion_chance = config->promotion_base_chance * 
-                (1.0f - (gang->members[i].rank / (float)config->num_ranks));            
-            if (rand_float() < promotion_chance) {
-                gang->members[i].rank++;
-                log_message("Gang %d, Member %d: Promoted to rank %d", 
-                           gang->id, i, gang->members[i].rank);
-            }
+        eligible[i] = (ms.status[i] == MEMBER_STATUS_ACTIVE &&
+                       ms.rank[i] < config->num_ranks - 1) ? 1.0f : 0.0f;
+        draws[i] = rand_float();
+    }
+    
+    // Chance of promotion increases with lower rank
+    int promotions = member_promotion_kernel(ms.rank, eligible, draws, gang->member_count,
+                                             config->promotion_base_chance,
+                                             1.0f / config->num_ranks, promoted);
+    
+    for (int i = 0; promotions > 0 && i < gang->member_count; i++) {
+        if (promoted[i]) {
+            log_verbose("Gang %d, Member %d: Promoted to rank %d", 
+                       gang->id, i, ms.rank[i]);
+            trace_event(TRACE_MEMBER_PROMOTED, gang->id, i, ms.rank[i], 0, 0.0f);
         }
     }
 }
 
 void execute_agent(Gang *gang, int member_index, int msg_queue_id, SharedState *shared_state) {
-    GangMember *member = &gang->members[member_index];
+    MemberStore ms = gang_members(gang);
+    int agent_id = ms.agent_id[member_index];
     
-    if (!member->is_agent) {
+    if (agent_id < 0) {
         return; // Not an agent
     }
     
-    log_message("Gang %d: Executing agent %d (member %d)", gang->id, member->agent_id, member_index);
+    log_message("Gang %d: Executing agent %d (member %d)", gang->id, agent_id, member_index);
+    trace_event(TRACE_AGENT_EXECUTED, gang->id, agent_id, 0, member_index, 0.0f);
     
-    sem_wait(gang->member_semaphore);
-    shared_state->agent_statuses[member->agent_id] = AGENT_STATUS_UNCOVERED;
-    shared_state->total_executed_agents++;
-    sem_post(gang->member_semaphore);
-    update_agent_status(shared_state, member->agent_id, AGENT_STATUS_UNCOVERED);
+    update_agent_status(shared_state, agent_id, AGENT_STATUS_UNCOVERED);
+    gang->executed_agents++;
+    __atomic_add_fetch(&shared_state->total_executed_agents, 1, __ATOMIC_RELAXED);
+    notify_police(shared_state);
     // Mark member as executed
-    member->status = MEMBER_STATUS_EXECUTED;
-    member->is_agent = false;
-    member->agent_id = -1;
+    set_member_status(gang, &ms, member_index, MEMBER_STATUS_EXECUTED);
+    ms.agent_id[member_index] = -1;
 }
 
-void member_interaction(Gang *gang, int member_index, int target_index, SimConfig *config) {
-    GangMember *member = &gang->members[member_index];
-    GangMember *target = &gang->members[target_index];
-    
-    // Only interact with active members
-    if (target->status != MEMBER_STATUS_ACTIVE) {
+// Spread knowledge over the gang's social graph, one exchange per member
+// per member step's worth of simulated time
+void diffuse_knowledge(GangRuntime *runtime) {
+    Gang *gang = runtime->gang;
+    SimConfig *config = runtime->config;
+    MemberStore ms = gang_members(gang);
+    float *gain = runtime->scratch_values;
+    
+    // Arrests, releases, promotions and new missions all reshape the graph
+    social_graph_build(&runtime->graph, gang);
+    if (runtime->graph.edge_count == 0) {
         return;
     }
     
-    // Knowledge flow is based on rank difference
-    // Higher ranks give information to lower ranks
-    if (member->rank >= target->rank) {
-        // Knowledge flows from higher rank to lower rank
-        float knowledge_transfer = config->member_knowledge_transfer_rate + 
-            config->member_knowledge_rank_factor * (member->knowledge_level - target->knowledge_level);
-        if (knowledge_transfer > 0) {
-            target->knowledge_level += knowledge_transfer;
-            if (target->knowledge_level > 1.0f) {
-                target->knowledge_level = 1.0f;
-            }
-        }
-    } else {
-        // Lower ranks can sometimes get information from higher ranks if lucky
-        if (rand_float() < config->member_knowledge_lucky_chance) {
-            float knowledge_transfer = config->member_knowledge_transfer_rate * 
-                (target->knowledge_level - member->knowledge_level);
-            if (knowledge_transfer > 0) {
-                member->knowledge_level += knowledge_transfer;
-                if (member->knowledge_level > 1.0f) {
-                    member->knowledge_level = 1.0f;
-                }
-            }
-        }
-    }
-    
-    // Agents gain extra knowledge through interactions
-    if (member->is_agent) {
-        member->knowledge_level += config->agent_knowledge_gain;
-        if (member->knowledge_level > 1.0f) {
-            member->knowledge_level = 1.0f;
-        }
-    }
-}
-
-void update_preparation_levels(Gang *gang, SimConfig *config) {
-    for (int i = 0; i < gang->member_count; i++) {
-        if (gang->members[i].status == MEMBER_STATUS_ACTIVE) {
-            // Preparation increases faster for members with higher rank and knowledge
-            float prep_increment = config->base_preparation_increment + 
-                                config->preparation_rank_factor * gang->members[i].rank / (float)config->num_ranks;
-            prep_increment *= (config->preparation_knowledge_factor + 
-                            config->preparation_knowledge_factor * gang->members[i].knowledge_level);
-
-            gang->members[i].preparation_level += prep_increment;
-            if (gang->members[i].preparation_level > 1.0f) {
-                gang->members[i].preparation_level = 1.0f;
-            }
-        }
-    }
+    // The exchanges a member used to start, and the ones it was picked for,
+    // in expectation: a lucky pull happens with member_knowledge_lucky_chance
+    DiffusionParams params = {
+        .transfer_base = config->member_knowledge_transfer_rate,
+        .transfer_gap = config->member_knowledge_rank_factor,
+        .pull_rate = config->member_knowledge_lucky_chance * config->member_knowledge_transfer_rate,
+        .agent_gain = config->agent_knowledge_gain,
+        .step = (2.0f * GANG_TICK_MS) / (MEMBER_STEP_MIN_MS + MEMBER_STEP_MAX_MS)
+    };
+    member_diffusion_kernel(ms.knowledge_level, gain, ms.rank, ms.agent_id,
+                            runtime->graph.row_offsets, runtime->graph.neighbors,
+                            gang->member_count, &params);
 }
 
 void gang_cleanup(Gang *gang) {
-    if (gang->member_semaphore != SEM_FAILED) {
-        sem_close(gang->member_semaphore);
-        
-        char sem_name[32];
-        snprintf(sem_name, sizeof(sem_name), "/gang_sem_%d", gang->id);
-        sem_unlink(sem_name);
-    }
+    // The gang lock stays valid for the police until the segment goes away
+    (void)gang;
 }
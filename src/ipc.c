@@ -1,13 +1,23 @@
 #include "../include/common.h"
 #include "../include/ipc.h"
+#include "../include/local_queue.h"
+#include "../include/shared_state.h"
+#include "../include/seqlock.h"
+#include "../include/sim_clock.h"
 #include <errno.h>
+#include <sched.h>
+
+/* This process's mapping of the shared state (channels, report mailboxes) */
+static SharedState *g_ipc_state = NULL;
+
+/* Where the police's scan of the report mailboxes stands; -1 when idle */
+static int g_mailbox_cursor = -1;
 
 int init_message_queue(void) {
     int msg_queue_id;
-    key_t key = MSG_KEY_BASE;
     
-    /* Create the message queue */
-    msg_queue_id = msgget(key, IPC_CREAT | 0666);
+    /* Create a private message queue so concurrent simulations never share one */
+    msg_queue_id = msgget(IPC_PRIVATE, IPC_CREAT | 0666);
     if (msg_queue_id == -1) {
         perror("msgget");
         return -1;
@@ -17,12 +27,42 @@ int init_message_queue(void) {
     return msg_queue_id;
 }
 
+int init_local_message_queue(void) {
+    int msg_queue_id = local_queue_create();
+    if (msg_queue_id == -1) {
+        return -1;
+    }
+    
+    log_message("In-memory message queue created with ID: %d", msg_queue_id);
+    return msg_queue_id;
+}
+
+// Every process names the mapping it reaches the channels and mailboxes through
+void ipc_attach_state(SharedState *state) {
+    g_ipc_state = state;
+    g_mailbox_cursor = -1;
+}
+
+int remove_message_queue(int msg_queue_id) {
+    if (msg_queue_id == MESSAGE_CHANNELS_ID) {
+        return 0;  // The channels go with the shared state (remove_message_channels)
+    }
+    if (local_queue_is_local(msg_queue_id)) {
+        return local_queue_remove(msg_queue_id);
+    }
+    
+    if (msgctl(msg_queue_id, IPC_RMID, NULL) == -1) {
+        perror("msgctl");
+        return -1;
+    }
+    return 0;
+}
+
 int create_shared_memory(size_t size) {
     int shm_id;
-    key_t key = SHM_KEY_BASE;
     
-    /* Create the shared memory segment */
-    shm_id = shmget(key, size, IPC_CREAT | 0666);
+    /* Create a private segment; children inherit the ID through fork */
+    shm_id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0666);
     if (shm_id == -1) {
         perror("shmget");
         return -1;
@@ -66,7 +106,275 @@ int remove_shared_memory(int shm_id) {
     return 0;
 }
 
+/* The channel a message type travels on, or -1 */
+static int channel_for_type(SharedState *state, long msg_type) {
+    if (msg_type == MSG_TYPE_AGENT_REPORT) {
+        return CHANNEL_REPORTS;
+    }
+    if (msg_type == MSG_TYPE_SIMULATION_STATUS) {
+        return CHANNEL_STATUS;
+    }
+    long gang_id = msg_type - MSG_TYPE_POLICE_ORDER_BASE;
+    if (gang_id >= 0 && gang_id < state->layout.gang_capacity) {
+        return CHANNEL_GANG_ORDERS((int)gang_id);
+    }
+    return -1;
+}
+
+/* Payload bytes of one message, as msgsnd counts them */
+#define MESSAGE_PAYLOAD_SIZE (sizeof(IpcMessage) - sizeof(long))
+
+// Kernel queues get their own byte limit so one busy channel can't
+// starve the others; raising it past msgmnb needs privileges, so the
+// capacity actually granted is whatever the kernel accepted
+static int open_channel_queue(MessageChannel *channel) {
+    struct msqid_ds info;
+    
+    channel->queue_id = msgget(IPC_PRIVATE, IPC_CREAT | 0666);
+    if (channel->queue_id == -1) {
+        perror("msgget");
+        return -1;
+    }
+    if (msgctl(channel->queue_id, IPC_STAT, &info) == 0) {
+        msglen_t wanted = channel->capacity * MESSAGE_PAYLOAD_SIZE;
+        msglen_t granted = info.msg_qbytes;
+        info.msg_qbytes = wanted;
+        if (msgctl(channel->queue_id, IPC_SET, &info) == 0) {
+            granted = wanted;
+        }
+        channel->capacity = granted / MESSAGE_PAYLOAD_SIZE;
+    }
+    return 0;
+}
+
+static int init_message_channels(SharedState *state) {
+    SharedLayout *layout = &state->layout;
+    
+    // Mark every channel closed first, so a cleanup racing with us never
+    // removes a queue we don't own
+    for (int i = 0; i < layout->channel_count; i++) {
+        MessageChannel *channel = shared_channel(state, i);
+        memset(channel, 0, sizeof(MessageChannel));
+        channel->queue_id = -1;
+    }
+    
+    for (int i = 0; i < layout->channel_count; i++) {
+        MessageChannel *channel = shared_channel(state, i);
+        if (i == CHANNEL_REPORTS) {
+            channel->capacity = layout->report_channel_capacity;
+        } else if (i == CHANNEL_STATUS) {
+            channel->capacity = layout->status_channel_capacity;
+        } else {
+            channel->capacity = layout->order_channel_capacity;
+        }
+        
+        if (layout->message_transport == MESSAGE_TRANSPORT_RINGS) {
+            if (i == CHANNEL_REPORTS) {
+                channel->ring_offset = layout->report_ring_offset;
+            } else if (i == CHANNEL_STATUS) {
+                channel->ring_offset = layout->status_ring_offset;
+            } else {
+                channel->ring_offset = layout->order_rings_offset +
+                                       (size_t)(i - CHANNEL_GANG_ORDERS(0)) * layout->order_ring_stride;
+            }
+            shm_ring_init(channel_ring(state, channel), channel->capacity);
+        } else if (open_channel_queue(channel) != 0) {
+            log_error("Failed to create message channel %d of %d", i, layout->channel_count);
+            remove_message_channels(state);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void remove_message_channels(SharedState *state) {
+    for (int i = 0; i < state->layout.channel_count; i++) {
+        MessageChannel *channel = shared_channel(state, i);
+        if (channel->queue_id != -1) {
+            msgctl(channel->queue_id, IPC_RMID, NULL);
+            channel->queue_id = -1;
+        }
+    }
+}
+
+void log_channel_stats(SharedState *state) {
+    unsigned long sent = 0, received = 0, rejected = 0;
+    int busiest = -1;
+    double busiest_fill = -1.0;
+    
+    for (int i = 0; i < state->layout.channel_count; i++) {
+        MessageChannel *channel = shared_channel(state, i);
+        double fill = channel->capacity ? (double)channel->peak_depth / channel->capacity : 0.0;
+        sent += channel->sent;
+        received += channel->received;
+        rejected += channel->rejected;
+        if (fill > busiest_fill) {
+            busiest_fill = fill;
+            busiest = i;
+        }
+    }
+    if (busiest < 0) {
+        return;
+    }
+    
+    MessageChannel *channel = shared_channel(state, busiest);
+    log_message("Channels: %lu sent, %lu received, %lu rejected as full; busiest is channel %d "
+                "(peak %lu of %u)", sent, received, rejected, busiest,
+                channel->peak_depth, channel->capacity);
+}
+
+static void channel_account_send(MessageChannel *channel) {
+    unsigned long sent = __atomic_add_fetch(&channel->sent, 1, __ATOMIC_RELAXED);
+    unsigned long depth = sent - __atomic_load_n(&channel->received, __ATOMIC_RELAXED);
+    unsigned long peak = __atomic_load_n(&channel->peak_depth, __ATOMIC_RELAXED);
+    
+    while (depth > peak && depth <= channel->capacity &&
+           !__atomic_compare_exchange_n(&channel->peak_depth, &peak, depth, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static int channel_send(const IpcMessage *message) {
+    int index = g_ipc_state ? channel_for_type(g_ipc_state, message->mtype) : -1;
+    if (index < 0) {
+        log_message("No message channel for message type %ld", message->mtype);
+        return -1;
+    }
+    
+    MessageChannel *channel = shared_channel(g_ipc_state, index);
+    bool accepted;
+    if (channel->queue_id == -1) {
+        accepted = shm_ring_push(channel_ring(g_ipc_state, channel), message);
+    } else if (msgsnd(channel->queue_id, message, MESSAGE_PAYLOAD_SIZE, IPC_NOWAIT) == 0) {
+        accepted = true;
+    } else if (errno == EAGAIN) {
+        accepted = false;
+    } else {
+        perror("msgsnd");
+        return -1;
+    }
+    
+    if (!accepted) {
+        // A full channel only holds back its own senders; refuse and count it
+        if (__atomic_fetch_add(&channel->rejected, 1, __ATOMIC_RELAXED) == 0) {
+            log_message("Message channel %d is full (%u messages)", index, channel->capacity);
+        }
+        errno = EAGAIN;
+        return -1;
+    }
+    channel_account_send(channel);
+    return 0;
+}
+
+static bool channel_try_receive(int index, IpcMessage *message) {
+    MessageChannel *channel = shared_channel(g_ipc_state, index);
+    bool received;
+    
+    if (channel->queue_id == -1) {
+        received = shm_ring_pop(channel_ring(g_ipc_state, channel), message);
+    } else {
+        received = msgrcv(channel->queue_id, message, MESSAGE_PAYLOAD_SIZE, 0, IPC_NOWAIT) != -1;
+    }
+    if (received) {
+        __atomic_add_fetch(&channel->received, 1, __ATOMIC_RELAXED);
+    }
+    return received;
+}
+
+static bool report_parked(const ReportMailbox *box) {
+    return __atomic_load_n(&box->sequence, __ATOMIC_ACQUIRE) !=
+           __atomic_load_n(&box->delivered, __ATOMIC_ACQUIRE);
+}
+
+// Only the agent's own gang writes its mailbox
+static void park_report(SharedState *state, const AgentReport *report) {
+    ReportMailbox *box = shared_report_mailbox(state, report->agent_id);
+    bool replacing = report_parked(box);
+    
+    seqlock_write_begin(&box->sequence);
+    box->report = *report;
+    seqlock_write_end(&box->sequence);
+    
+    if (replacing) {
+        __atomic_add_fetch(&state->reports_coalesced, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&state->report_mailboxes_dirty, 1, __ATOMIC_RELEASE);
+}
+
+// Take the next parked report, sweeping the mailboxes whenever one was
+// written since the last sweep; the police is the only taker
+static bool take_parked_report(SharedState *state, IpcMessage *message) {
+    if (g_mailbox_cursor < 0) {
+        if (!__atomic_exchange_n(&state->report_mailboxes_dirty, 0, __ATOMIC_ACQ_REL)) {
+            return false;
+        }
+        g_mailbox_cursor = 0;
+    }
+    
+    for (; g_mailbox_cursor < state->layout.agent_capacity; g_mailbox_cursor++) {
+        ReportMailbox *box = shared_report_mailbox(state, g_mailbox_cursor);
+        unsigned int start;
+        
+        if (!report_parked(box)) {
+            continue;
+        }
+        do {
+            start = seqlock_read_begin(&box->sequence);
+            message->data.agent_report = box->report;
+        } while (seqlock_read_retry(&box->sequence, start));
+        __atomic_store_n(&box->delivered, start, __ATOMIC_RELEASE);
+        
+        message->mtype = MSG_TYPE_AGENT_REPORT;
+        g_mailbox_cursor++;
+        return true;
+    }
+    
+    g_mailbox_cursor = -1;
+    return false;
+}
+
+// Type 0 takes from any channel, status first so shutdowns are seen early;
+// parked reports come after the ones still in the channel
+static bool channel_try_receive_type(IpcMessage *message, long msg_type) {
+    if (msg_type != 0) {
+        int index = channel_for_type(g_ipc_state, msg_type);
+        if (index >= 0 && channel_try_receive(index, message)) {
+            return true;
+        }
+        return msg_type == MSG_TYPE_AGENT_REPORT && take_parked_report(g_ipc_state, message);
+    }
+    if (channel_try_receive(CHANNEL_STATUS, message)) {
+        return true;
+    }
+    for (int i = 0; i < g_ipc_state->layout.channel_count; i++) {
+        if (i != CHANNEL_STATUS && channel_try_receive(i, message)) {
+            return true;
+        }
+    }
+    return take_parked_report(g_ipc_state, message);
+}
+
+static int channel_receive(IpcMessage *message, long msg_type, bool no_wait) {
+    if (!g_ipc_state) {
+        return -1;
+    }
+    while (!channel_try_receive_type(message, msg_type)) {
+        if (no_wait) {
+            return -1;
+        }
+        sched_yield();
+    }
+    return 0;
+}
+
 int send_message(int msg_queue_id, IpcMessage *message) {
+    if (msg_queue_id == MESSAGE_CHANNELS_ID) {
+        return channel_send(message);
+    }
+    if (local_queue_is_local(msg_queue_id)) {
+        return local_queue_send(msg_queue_id, message);
+    }
+    
     /* Send the message */
     if (msgsnd(msg_queue_id, message, sizeof(IpcMessage) - sizeof(long), 0) == -1) {
         perror("msgsnd");
@@ -76,7 +384,7 @@ int send_message(int msg_queue_id, IpcMessage *message) {
     return 0;
 }
 
-int receive_message(int msg_queue_id, IpcMessage *message, long msg_type, bool no_wait) {
+static int receive_from_queue(int msg_queue_id, IpcMessage *message, long msg_type, bool no_wait) {
     int flags = no_wait ? IPC_NOWAIT : 0;
     ssize_t result;
     
@@ -96,6 +404,23 @@ int receive_message(int msg_queue_id, IpcMessage *message, long msg_type, bool n
     return 0;
 }
 
+int receive_message(int msg_queue_id, IpcMessage *message, long msg_type, bool no_wait) {
+    int result;
+    
+    if (msg_queue_id == MESSAGE_CHANNELS_ID) {
+        result = channel_receive(message, msg_type, no_wait);
+    } else if (local_queue_is_local(msg_queue_id)) {
+        result = local_queue_receive(msg_queue_id, message, msg_type, no_wait);
+    } else {
+        result = receive_from_queue(msg_queue_id, message, msg_type, no_wait);
+    }
+    
+    if (result == 0 && message->mtype == MSG_TYPE_AGENT_REPORT && g_ipc_state) {
+        __atomic_add_fetch(&g_ipc_state->reports_delivered, 1, __ATOMIC_RELAXED);
+    }
+    return result;
+}
+
 int send_agent_report(int msg_queue_id, int agent_id, int gang_id, 
                      CrimeTarget target, float confidence, time_t time) {
     IpcMessage message;
@@ -107,9 +432,34 @@ int send_agent_report(int msg_queue_id, int agent_id, int gang_id,
     message.data.agent_report.suspected_target = target;
     message.data.agent_report.confidence_level = confidence;
     message.data.agent_report.estimated_execution_time = time;
+    message.data.agent_report.sent_ns = metrics_now_ns();
     
-    /* Send the message */
-    return send_message(msg_queue_id, &message);
+    /* Without channels there is nowhere to park a report */
+    if (msg_queue_id != MESSAGE_CHANNELS_ID || !g_ipc_state ||
+        agent_id < 0 || agent_id >= g_ipc_state->layout.agent_capacity) {
+        if (send_message(msg_queue_id, &message) == 0) {
+            return 0;
+        }
+        if (g_ipc_state) {
+            __atomic_add_fetch(&g_ipc_state->reports_dropped, 1, __ATOMIC_RELAXED);
+        }
+        return -1;
+    }
+    
+    /* Never block the reporting member: while the channel is full, or an
+     * older report of this agent is still parked, the report goes to the
+     * agent's mailbox and replaces whatever was waiting there */
+    if (!report_parked(shared_report_mailbox(g_ipc_state, agent_id))) {
+        if (send_message(msg_queue_id, &message) == 0) {
+            return 0;
+        }
+        if (errno != EAGAIN) {
+            __atomic_add_fetch(&g_ipc_state->reports_dropped, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+    }
+    park_report(g_ipc_state, &message.data.agent_report);
+    return 0;
 }
 
 int send_police_order(int msg_queue_id, int gang_id, int duration) {
@@ -174,58 +524,124 @@ int cleanup_shared_mutex(pthread_mutex_t *mutex) {
     return 0;
 }
 
-int init_shared_state(SharedState *state) {
-    /* Initialize the shared state structure */
+int init_shared_state(SharedState *state, const SimConfig *config) {
+    /* Initialize the header; the arrays behind it start out zeroed in a
+     * fresh segment, and leaving them alone keeps untouched pages free */
     memset(state, 0, sizeof(SharedState));
-    
-    /* Initialize the mutex */
-    if (init_shared_mutex(&state->status_mutex) != 0) {
+    if (shared_layout_compute(&state->layout, config) != 0) {
+        log_error("Cannot lay out shared state for %d gangs", config->num_gangs);
         return -1;
     }
     
     /* Set initial status */
     state->status = SIM_STATUS_RUNNING;
     state->agent_execution_loss_count = 0;
-    return 0;
+    
+    /* Describe the run to simstat; the magic goes last, once the rest is set */
+    MetricsHeader *metrics = shared_metrics(state);
+    metrics->version = METRICS_VERSION;
+    metrics->owner_pid = getpid();
+    metrics->clock_ns = metrics_now_ns();
+    metrics->clock_sim = sim_clock_elapsed_sim();
+    metrics->time_scale = sim_clock_scale();
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(metrics->magic, METRICS_MAGIC, sizeof(metrics->magic));
+    
+    ipc_attach_state(state);
+    return init_message_channels(state);
 }
 
 int update_gang_status(SharedState *state, Gang *gang) {
-    /* Lock the mutex */
-    if (pthread_mutex_lock(&state->status_mutex) != 0) {
-        perror("pthread_mutex_lock");
-        return -1;
-    }
+    Gang *shared = shared_gang(state, gang->id);
+    Mission *missions = gang_missions(gang);
+    GangSnapshot snapshot;
     
-    /* Update the gang information */
-    memcpy(&state->gangs[gang->id], gang, sizeof(Gang));
-    
-    /* Unlock the mutex */
-    if (pthread_mutex_unlock(&state->status_mutex) != 0) {
-        perror("pthread_mutex_unlock");
-        return -1;
+    /* Build the snapshot first so the odd window covers a single copy */
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.member_count = gang->member_count;
+    snapshot.active_mission_count = gang->active_mission_count;
+    snapshot.successful_missions = gang->successful_missions;
+    snapshot.failed_missions = gang->failed_missions;
+    for (int i = 0; i < gang_mission_capacity(gang); i++) {
+        if (missions[i].mission_id != -1 && missions[i].in_progress) {
+            snapshot.has_mission = true;
+            snapshot.mission_target = missions[i].target;
+            snapshot.mission_required_preparation = missions[i].required_preparation_level;
+            snapshot.mission_assigned_count = missions[i].assigned_count;
+            break;
+        }
     }
     
+    /* Only the gang's own thread publishes, so no lock is needed */
+    seqlock_write_begin(&shared->snapshot_sequence);
+    shared->snapshot = snapshot;
+    seqlock_write_end(&shared->snapshot_sequence);
+    
     return 0;
 }
 
-int update_agent_status(SharedState *state, int agent_id, AgentStatus status) {
-    /* Lock the mutex */
-    if (pthread_mutex_lock(&state->status_mutex) != 0) {
-        perror("pthread_mutex_lock");
-        return -1;
-    }
+int read_gang_status(SharedState *state, int gang_id, GangSnapshot *snapshot) {
+    Gang *shared = shared_gang(state, gang_id);
+    unsigned int start;
     
-    /* Update the agent status */
-    if (agent_id >= 0 && agent_id < MAX_AGENTS) {
-        state->agent_statuses[agent_id] = status;
-    }
+    /* Retry until a copy was taken without the gang publishing over it */
+    do {
+        start = seqlock_read_begin(&shared->snapshot_sequence);
+        *snapshot = shared->snapshot;
+    } while (seqlock_read_retry(&shared->snapshot_sequence, start));
     
-    /* Unlock the mutex */
-    if (pthread_mutex_unlock(&state->status_mutex) != 0) {
-        perror("pthread_mutex_unlock");
+    return 0;
+}
+
+int update_agent_status(SharedState *state, int agent_id, AgentStatus status) {
+    if (agent_id < 0 || agent_id >= state->layout.agent_capacity) {
         return -1;
     }
     
+    /* Each status is a single word with one writer at a time */
+    __atomic_store_n(&shared_agent_statuses(state)[agent_id], status, __ATOMIC_RELEASE);
     return 0;
 }
 
+AgentStatus read_agent_status(SharedState *state, int agent_id) {
+    return __atomic_load_n(&shared_agent_statuses(state)[agent_id], __ATOMIC_ACQUIRE);
+}
+
+/* Everyone sleeping on an event has to notice a change of status */
+static void wake_all_actors(SharedState *state) {
+    // The run is over, so the virtual clock has nothing left to pace
+    sim_clock_stop();
+    event_signal(&state->status_event);
+    event_signal(&state->police_event);
+    for (int i = 0; i < state->layout.gang_capacity; i++) {
+        event_signal(shared_wake_event(state, i));
+    }
+}
+
+void notify_police(SharedState *state) {
+    event_signal(&state->police_event);
+}
+
+void notify_gang(SharedState *state, int gang_id) {
+    event_signal(shared_wake_event(state, shared_gang(state, gang_id)->wake_slot));
+}
+
+SimulationStatus get_simulation_status(SharedState *state) {
+    return __atomic_load_n(&state->status, __ATOMIC_ACQUIRE);
+}
+
+void set_simulation_status(SharedState *state, SimulationStatus status) {
+    __atomic_store_n(&state->status, status, __ATOMIC_RELEASE);
+    wake_all_actors(state);
+}
+
+bool end_simulation(SharedState *state, SimulationStatus status) {
+    /* Only the first actor to end a running simulation decides its outcome */
+    SimulationStatus running = SIM_STATUS_RUNNING;
+    if (!__atomic_compare_exchange_n(&state->status, &running, status, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    wake_all_actors(state);
+    return true;
+}
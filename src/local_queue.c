@@ -0,0 +1,201 @@
+#include "../include/local_queue.h"
+
+#define LANE_INITIAL_CAPACITY 16
+
+typedef struct {
+    unsigned long seq;   /* Arrival order across all lanes */
+    IpcMessage message;
+} QueuedMessage;
+
+/* FIFO of the messages of one mtype */
+typedef struct {
+    QueuedMessage *slots;
+    int capacity;
+    int head;
+    int count;
+} MessageLane;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    MessageLane *lanes;  /* Indexed by mtype */
+    long lane_count;
+    unsigned long next_seq;
+    int pending;
+} LocalQueue;
+
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static LocalQueue *g_queues[LOCAL_QUEUE_MAX];
+
+static int queue_index(int queue_id) {
+    return LOCAL_QUEUE_ID_FIRST - queue_id;
+}
+
+static LocalQueue *lookup_queue(int queue_id) {
+    int index = queue_index(queue_id);
+    if (index < 0 || index >= LOCAL_QUEUE_MAX) {
+        return NULL;
+    }
+    return g_queues[index];
+}
+
+static int lane_push(MessageLane *lane, const QueuedMessage *entry) {
+    if (lane->count == lane->capacity) {
+        int new_capacity = lane->capacity ? lane->capacity * 2 : LANE_INITIAL_CAPACITY;
+        QueuedMessage *grown = malloc(sizeof(QueuedMessage) * new_capacity);
+        if (!grown) {
+            return -1;
+        }
+        for (int i = 0; i < lane->count; i++) {
+            grown[i] = lane->slots[(lane->head + i) % lane->capacity];
+        }
+        free(lane->slots);
+        lane->slots = grown;
+        lane->capacity = new_capacity;
+        lane->head = 0;
+    }
+    lane->slots[(lane->head + lane->count) % lane->capacity] = *entry;
+    lane->count++;
+    return 0;
+}
+
+static void lane_pop(MessageLane *lane, IpcMessage *message) {
+    *message = lane->slots[lane->head].message;
+    lane->head = (lane->head + 1) % lane->capacity;
+    lane->count--;
+}
+
+// Lane holding the message a receive for msg_type should return, or NULL
+static MessageLane *find_lane(LocalQueue *queue, long msg_type) {
+    if (msg_type > 0) {
+        if (msg_type < queue->lane_count && queue->lanes[msg_type].count > 0) {
+            return &queue->lanes[msg_type];
+        }
+        return NULL;
+    }
+
+    // Any type: the oldest message overall
+    MessageLane *oldest = NULL;
+    for (long i = 0; i < queue->lane_count && queue->pending > 0; i++) {
+        MessageLane *lane = &queue->lanes[i];
+        if (lane->count > 0 &&
+            (!oldest || lane->slots[lane->head].seq < oldest->slots[oldest->head].seq)) {
+            oldest = lane;
+        }
+    }
+    return oldest;
+}
+
+int local_queue_create(void) {
+    LocalQueue *queue = calloc(1, sizeof(LocalQueue));
+    if (!queue) {
+        perror("calloc");
+        return -1;
+    }
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+
+    pthread_mutex_lock(&g_registry_lock);
+    for (int i = 0; i < LOCAL_QUEUE_MAX; i++) {
+        if (!g_queues[i]) {
+            g_queues[i] = queue;
+            pthread_mutex_unlock(&g_registry_lock);
+            return LOCAL_QUEUE_ID_FIRST - i;
+        }
+    }
+    pthread_mutex_unlock(&g_registry_lock);
+
+    log_message("No free local message queue (max %d)", LOCAL_QUEUE_MAX);
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    free(queue);
+    return -1;
+}
+
+bool local_queue_is_local(int queue_id) {
+    return queue_id <= LOCAL_QUEUE_ID_FIRST && queue_id > LOCAL_QUEUE_ID_FIRST - LOCAL_QUEUE_MAX;
+}
+
+int local_queue_send(int queue_id, const IpcMessage *message) {
+    LocalQueue *queue = lookup_queue(queue_id);
+    if (!queue || message->mtype <= 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+
+    // Grow the lane table to cover this mtype
+    if (message->mtype >= queue->lane_count) {
+        long new_count = queue->lane_count ? queue->lane_count : 8;
+        while (new_count <= message->mtype) {
+            new_count *= 2;
+        }
+        MessageLane *grown = realloc(queue->lanes, sizeof(MessageLane) * new_count);
+        if (!grown) {
+            pthread_mutex_unlock(&queue->lock);
+            perror("realloc");
+            return -1;
+        }
+        memset(grown + queue->lane_count, 0, sizeof(MessageLane) * (new_count - queue->lane_count));
+        queue->lanes = grown;
+        queue->lane_count = new_count;
+    }
+
+    QueuedMessage entry = { queue->next_seq++, *message };
+    if (lane_push(&queue->lanes[message->mtype], &entry) != 0) {
+        pthread_mutex_unlock(&queue->lock);
+        perror("malloc");
+        return -1;
+    }
+    queue->pending++;
+
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+int local_queue_receive(int queue_id, IpcMessage *message, long msg_type, bool no_wait) {
+    LocalQueue *queue = lookup_queue(queue_id);
+    if (!queue) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    MessageLane *lane = find_lane(queue, msg_type);
+    while (!lane && !no_wait) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+        lane = find_lane(queue, msg_type);
+    }
+
+    if (!lane) {
+        pthread_mutex_unlock(&queue->lock);
+        return -1;
+    }
+
+    lane_pop(lane, message);
+    queue->pending--;
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+int local_queue_remove(int queue_id) {
+    pthread_mutex_lock(&g_registry_lock);
+    LocalQueue *queue = lookup_queue(queue_id);
+    if (queue) {
+        g_queues[queue_index(queue_id)] = NULL;
+    }
+    pthread_mutex_unlock(&g_registry_lock);
+
+    if (!queue) {
+        return -1;
+    }
+
+    for (long i = 0; i < queue->lane_count; i++) {
+        free(queue->lanes[i].slots);
+    }
+    free(queue->lanes);
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    free(queue);
+    return 0;
+}
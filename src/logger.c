@@ -0,0 +1,393 @@
+#include "../include/logger.h"
+#include "../include/event.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Lines the writer takes per pass before it looks at its wakeup event again */
+#define LOG_PASS_LINES 4096
+#define LOG_BATCH_BYTES 65536
+
+enum {
+    WRITER_NONE,    /* Not started in this process yet */
+    WRITER_RUNNING,
+    WRITER_STOPPED  /* Gone for good (exiting, or it could not start); log directly */
+};
+
+/* One formatted line waiting for the writer */
+typedef struct {
+    long long time_ns;  /* Wall time it was logged; orders lines across threads */
+    char text[LOG_LINE_MAX];
+} LogEntry;
+
+/* Ring of one thread: the owner is its only producer, the writer its only consumer */
+typedef struct LogRing {
+    unsigned long head __attribute__((aligned(64))); /* Next line the owner fills */
+    unsigned long tail __attribute__((aligned(64))); /* Next line the writer takes */
+    unsigned long written;  /* Lines taken and out of the process */
+    struct LogRing *next;   /* Rings are never freed, only handed to new threads */
+    int owned;              /* A live thread logs into it */
+    LogEntry entries[LOG_RING_ENTRIES];
+} LogRing;
+
+static int g_log_level = LOG_LEVEL_VERBOSE;
+static LogRing *g_rings;
+static SimEvent g_writer_event;
+static pthread_t g_writer;
+static int g_writer_state = WRITER_NONE;
+static int g_writer_stop;
+static pthread_mutex_t g_start_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_output_lock = PTHREAD_MUTEX_INITIALIZER; /* Keeps fork() out of a write */
+static pthread_once_t g_setup_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_ring_key;
+
+static __thread LogRing *t_ring;
+static __thread bool t_logging;  /* Set while filling a line, to catch a line logged from within one */
+
+static const char *log_level_names[] = {
+    "error",
+    "info",
+    "verbose"
+};
+
+// The old synchronous path: for reentrant lines, and once the writer is gone
+static void write_line_now(const char *text) {
+    char timestamp[32];
+    format_timestamp(timestamp, sizeof(timestamp));
+    printf("[%s] %s\n", timestamp, text);
+    fflush(stdout);
+}
+
+// Only the writer formats timestamps, and only once per second
+static const char *cached_timestamp(time_t second) {
+    static time_t cached_second = -1;
+    static char text[32];
+    if (second != cached_second) {
+        struct tm tm_info;
+        localtime_r(&second, &tm_info);
+        strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &tm_info);
+        cached_second = second;
+    }
+    return text;
+}
+
+// Write out up to LOG_PASS_LINES lines, oldest first; returns how many
+static int write_pending_lines(void) {
+    static char batch[LOG_BATCH_BYTES];
+    size_t used = 0;
+    int lines = 0;
+
+    pthread_mutex_lock(&g_output_lock);
+    while (lines < LOG_PASS_LINES) {
+        // The ring whose next line is the oldest
+        LogRing *oldest = NULL;
+        for (LogRing *ring = __atomic_load_n(&g_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+            unsigned long tail = ring->tail;
+            if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+            if (!oldest || ring->entries[tail % LOG_RING_ENTRIES].time_ns <
+                           oldest->entries[oldest->tail % LOG_RING_ENTRIES].time_ns) {
+                oldest = ring;
+            }
+        }
+        if (!oldest) {
+            break;
+        }
+
+        if (LOG_BATCH_BYTES - used < LOG_LINE_MAX + 32) {
+            fwrite(batch, 1, used, stdout);
+            used = 0;
+        }
+        LogEntry *entry = &oldest->entries[oldest->tail % LOG_RING_ENTRIES];
+        used += snprintf(batch + used, LOG_BATCH_BYTES - used, "[%s] %s\n",
+                         cached_timestamp((time_t)(entry->time_ns / 1000000000LL)), entry->text);
+        __atomic_store_n(&oldest->tail, oldest->tail + 1, __ATOMIC_SEQ_CST);
+        lines++;
+    }
+
+    if (lines > 0) {
+        fwrite(batch, 1, used, stdout);
+        fflush(stdout);
+        for (LogRing *ring = __atomic_load_n(&g_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+            __atomic_store_n(&ring->written, ring->tail, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&g_output_lock);
+    return lines;
+}
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        unsigned int seen = event_prepare(&g_writer_event);
+        bool stopping = __atomic_load_n(&g_writer_stop, __ATOMIC_ACQUIRE);
+        if (write_pending_lines() > 0) {
+            continue;
+        }
+        if (stopping) {
+            return NULL;
+        }
+        event_wait_ms(&g_writer_event, seen, -1);
+    }
+}
+
+// Write out whatever is left when the process exits
+static void logger_shutdown(void) {
+    pthread_mutex_lock(&g_start_lock);
+    if (__atomic_load_n(&g_writer_state, __ATOMIC_ACQUIRE) == WRITER_RUNNING) {
+        __atomic_store_n(&g_writer_stop, 1, __ATOMIC_RELEASE);
+        event_signal(&g_writer_event);
+        pthread_join(g_writer, NULL);
+    }
+    __atomic_store_n(&g_writer_state, WRITER_STOPPED, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_start_lock);
+}
+
+static void release_ring(void *ring) {
+    __atomic_store_n(&((LogRing *)ring)->owned, 0, __ATOMIC_RELEASE);
+}
+
+// Lines still in the rings are the parent's to write; the child starts
+// its own writer when it first logs. Holding the output lock keeps the
+// child from inheriting stdout locked by the parent's writer.
+static void before_fork(void) {
+    logger_flush();
+    pthread_mutex_lock(&g_start_lock);
+    pthread_mutex_lock(&g_output_lock);
+}
+
+static void after_fork_parent(void) {
+    pthread_mutex_unlock(&g_output_lock);
+    pthread_mutex_unlock(&g_start_lock);
+}
+
+static void after_fork_child(void) {
+    for (LogRing *ring = g_rings; ring; ring = ring->next) {
+        ring->tail = ring->head;
+        ring->written = ring->head;
+        if (ring != t_ring) {
+            ring->owned = 0;
+        }
+    }
+    g_writer_event.waiters = 0;
+    g_writer_stop = 0;
+    if (g_writer_state == WRITER_RUNNING) {
+        g_writer_state = WRITER_NONE;
+    }
+    pthread_mutex_unlock(&g_output_lock);
+    pthread_mutex_unlock(&g_start_lock);
+}
+
+static void logger_setup(void) {
+    pthread_key_create(&g_ring_key, release_ring);
+    pthread_atfork(before_fork, after_fork_parent, after_fork_child);
+    atexit(logger_shutdown);
+}
+
+static bool writer_running(void) {
+    int state = __atomic_load_n(&g_writer_state, __ATOMIC_ACQUIRE);
+    if (state != WRITER_NONE) {
+        return state == WRITER_RUNNING;
+    }
+
+    pthread_once(&g_setup_once, logger_setup);
+    pthread_mutex_lock(&g_start_lock);
+    if (g_writer_state == WRITER_NONE) {
+        // Signals belong to the simulation's threads, never to the writer
+        sigset_t all, previous;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &previous);
+        int started = pthread_create(&g_writer, NULL, writer_main, NULL) == 0;
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+        __atomic_store_n(&g_writer_state, started ? WRITER_RUNNING : WRITER_STOPPED, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_start_lock);
+    return g_writer_state == WRITER_RUNNING;
+}
+
+// The calling thread's ring: its own, one a finished thread left behind, or a new one
+static LogRing *thread_ring(void) {
+    if (t_ring) {
+        return t_ring;
+    }
+
+    for (LogRing *ring = __atomic_load_n(&g_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&ring->owned, &expected, 1, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            t_ring = ring;
+            break;
+        }
+    }
+    if (!t_ring) {
+        LogRing *ring = calloc(1, sizeof(LogRing));
+        if (!ring) {
+            return NULL;
+        }
+        ring->owned = 1;
+        ring->next = __atomic_load_n(&g_rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&g_rings, &ring->next, ring, false,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+        t_ring = ring;
+    }
+    pthread_setspecific(g_ring_key, t_ring);
+    return t_ring;
+}
+
+static void log_line(LogLevel level, const char *format, va_list args) {
+    if ((int)level > g_log_level) {
+        return;
+    }
+
+    LogRing *ring = NULL;
+    if (!t_logging && writer_running()) {
+        ring = thread_ring();
+    }
+    if (!ring) {
+        char text[LOG_LINE_MAX];
+        vsnprintf(text, sizeof(text), format, args);
+        write_line_now(text);
+        return;
+    }
+
+    t_logging = true;
+    unsigned long head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_ENTRIES) {
+        // Full: wait for the writer rather than lose the line
+        event_signal(&g_writer_event);
+        while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_ENTRIES) {
+            sched_yield();
+        }
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    LogEntry *entry = &ring->entries[head % LOG_RING_ENTRIES];
+    entry->time_ns = (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+    vsnprintf(entry->text, sizeof(entry->text), format, args);
+
+    // Only a ring going from empty to not empty needs to wake the writer;
+    // otherwise it has yet to drain this ring and will see the line
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+    bool was_empty = __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) == head;
+    t_logging = false;
+    if (was_empty) {
+        event_signal(&g_writer_event);
+    }
+}
+
+void log_message(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    log_line(LOG_LEVEL_INFO, format, args);
+    va_end(args);
+}
+
+void log_error(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    log_line(LOG_LEVEL_ERROR, format, args);
+    va_end(args);
+}
+
+#ifndef LOG_STRIP_VERBOSE
+void log_verbose(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    log_line(LOG_LEVEL_VERBOSE, format, args);
+    va_end(args);
+}
+#endif
+
+void log_signal_safe(int sig, const char *text) {
+    char line[LOG_LINE_MAX + 32];
+    char digits[12];
+    size_t used = 0;
+    int n = 0;
+
+    if (LOG_LEVEL_INFO > g_log_level) {
+        return;
+    }
+
+    // Only async-signal-safe calls from here on: no stdio, no allocation
+    unsigned int value = sig < 0 ? 0 : (unsigned int)sig;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0 && n < (int)sizeof(digits));
+
+    const char *prefix = "[signal ";
+    while (*prefix) {
+        line[used++] = *prefix++;
+    }
+    while (n > 0) {
+        line[used++] = digits[--n];
+    }
+    line[used++] = ']';
+    line[used++] = ' ';
+    while (*text && used < sizeof(line) - 1) {
+        line[used++] = *text++;
+    }
+    line[used++] = '\n';
+
+    // The handler's caller may be looking at errno
+    int saved_errno = errno;
+    ssize_t written;
+    size_t offset = 0;
+    while (offset < used) {
+        written = write(STDOUT_FILENO, line + offset, used - offset);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            break;
+        }
+        offset += (size_t)written;
+    }
+    errno = saved_errno;
+}
+
+void logger_set_level(LogLevel level) {
+    g_log_level = level;
+}
+
+void logger_flush(void) {
+    if (__atomic_load_n(&g_writer_state, __ATOMIC_ACQUIRE) == WRITER_RUNNING) {
+        for (LogRing *ring = __atomic_load_n(&g_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+            unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            if ((long)(__atomic_load_n(&ring->written, __ATOMIC_ACQUIRE) - head) >= 0) {
+                continue;
+            }
+            event_signal(&g_writer_event);
+            while ((long)(__atomic_load_n(&ring->written, __ATOMIC_ACQUIRE) - head) < 0) {
+                sched_yield();
+            }
+        }
+    }
+    fflush(stdout);
+}
+
+bool log_level_from_string(const char *name, LogLevel *level) {
+    for (int i = LOG_LEVEL_ERROR; i <= LOG_LEVEL_VERBOSE; i++) {
+        if (strcmp(name, log_level_names[i]) == 0) {
+            *level = (LogLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *log_level_to_string(LogLevel level) {
+    if (level >= LOG_LEVEL_ERROR && level <= LOG_LEVEL_VERBOSE) {
+        return log_level_names[level];
+    }
+    return "unknown";
+}
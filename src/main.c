@@ -1,33 +1,34 @@
 #include "../include/main.h"
 #include "../include/ipc.h"
+#ifndef HEADLESS_BUILD
 #include "../include/visualization.h"
+#endif
+#include "../include/sim_clock.h"
 
 
 static volatile sig_atomic_t g_shutdown_in_progress = 0;
-/* Global variables for signal handling */
-static int g_shared_state_id = -1;
-static int g_msg_queue_id = -1;
 
 int main(int argc, char *argv[]) {
     SimConfig config;
     char config_file[256] = "config.txt";
+    RunOptions options;
     int result;
 
-    /* Initialize random number generator */
-    srand(time(NULL));
-    
     /* Parse command line arguments */
-    if (parse_arguments(argc, argv, config_file, sizeof(config_file)) != 0) {
+    if (parse_arguments(argc, argv, config_file, sizeof(config_file), &options) != 0) {
         print_help(argv[0]);
         return 1;
     }
     
     /* Initialize environment */
-    if (initialize_environment(&config, config_file) != 0) {
-        log_message("Failed to initialize environment");
+    if (initialize_environment(&config, config_file, &options) != 0) {
+        log_error("Failed to initialize environment");
         return 1;
     }
     
+    /* Start the simulated clock before any process is forked */
+    sim_clock_init(config.time_scale);
+    
     /* Register signal handlers */
     register_signal_handlers();
     
@@ -40,33 +41,147 @@ int main(int argc, char *argv[]) {
     return result;
 }
 
-int parse_arguments(int argc, char *argv[], char *config_file, size_t config_file_size) {
-    // Check if exactly one argument is provided (the config file)
-    if (argc != 2) {
-        return 1;  // Show help if no config file provided
+int parse_arguments(int argc, char *argv[], char *config_file, size_t config_file_size, RunOptions *options) {
+    bool have_config_file = false;
+    
+    memset(options, 0, sizeof(RunOptions));
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--time-scale") == 0) {
+            if (i + 1 >= argc) {
+                return 1;
+            }
+            options->time_scale_set = true;
+            options->time_scale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            options->time_scale_set = true;
+            options->time_scale = 0.0f;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            if (i + 1 >= argc) {
+                return 1;
+            }
+            options->seed_set = true;
+            options->seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--in-process") == 0) {
+            options->in_process = true;
+        } else if (strcmp(argv[i], "--shards") == 0) {
+            if (i + 1 >= argc || atoi(argv[i + 1]) <= 0) {
+                return 1;
+            }
+            options->in_process = true;
+            options->shard_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rings") == 0) {
+            options->rings = true;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            if (i + 1 >= argc) {
+                return 1;
+            }
+            options->trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint") == 0) {
+            if (i + 1 >= argc) {
+                return 1;
+            }
+            options->checkpoint_file = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint-at") == 0) {
+            if (i + 1 >= argc) {
+                return 1;
+            }
+            options->checkpoint_at_set = true;
+            options->checkpoint_at = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--restore") == 0) {
+            if (i + 1 >= argc) {
+                return 1;
+            }
+            options->restore_file = argv[++i];
+        } else if (strcmp(argv[i], "--log-level") == 0) {
+            if (i + 1 >= argc || !log_level_from_string(argv[i + 1], &options->log_level)) {
+                return 1;
+            }
+            options->log_level_set = true;
+            i++;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            options->headless = true;
+        } else if (strcmp(argv[i], "--summary") == 0) {
+            if (i + 1 >= argc) {
+                return 1;
+            }
+            options->headless = true;
+            options->summary_file = argv[++i];
+        } else if (argv[i][0] == '-' || have_config_file) {
+            return 1;  // Unknown option or more than one config file
+        } else {
+            safe_strcpy(config_file, argv[i], config_file_size);
+            have_config_file = true;
+        }
     }
     
-    // Use the provided argument as config file
-    safe_strcpy(config_file, argv[1], config_file_size);
-    return 0;
+    // The config file is mandatory
+    return have_config_file ? 0 : 1;
+}
+
+void apply_run_options(SimConfig *config, const RunOptions *options) {
+    if (options->time_scale_set) {
+        config->time_scale = options->time_scale;
+    }
+    if (options->seed_set) {
+        config->seed = options->seed;
+    }
+    if (options->headless) {
+        config->headless = true;
+    }
+    if (options->in_process) {
+        config->execution_mode = EXECUTION_MODE_INPROCESS;
+    }
+    if (options->rings) {
+        config->message_transport = MESSAGE_TRANSPORT_RINGS;
+    }
+    if (options->trace_file) {
+        safe_strcpy(config->trace_file, options->trace_file, sizeof(config->trace_file));
+    }
+    if (options->checkpoint_file) {
+        safe_strcpy(config->checkpoint_file, options->checkpoint_file, sizeof(config->checkpoint_file));
+    }
+    if (options->checkpoint_at_set) {
+        config->checkpoint_at = options->checkpoint_at;
+    }
+    if (options->restore_file) {
+        safe_strcpy(config->restore_file, options->restore_file, sizeof(config->restore_file));
+    }
+    if (options->log_level_set) {
+        config->log_level = options->log_level;
+    }
+    if (options->shard_threads > 0) {
+        config->shard_threads = options->shard_threads;
+    }
+    if (options->summary_file) {
+        safe_strcpy(config->summary_file, options->summary_file, sizeof(config->summary_file));
+    }
+#ifdef HEADLESS_BUILD
+    /* This binary has no visualization at all */
+    config->headless = true;
+#endif
 }
 
-int initialize_environment(SimConfig *config, const char *config_file) {
+int initialize_environment(SimConfig *config, const char *config_file, const RunOptions *options) {
     /* Initialize logging */
     log_message("Initializing environment");
     
-    /* Initialize random number generator */
-    init_random();
-    
     /* Read configuration */
     if (load_config(config_file, config) != 0) {
-        log_message("Failed to load configuration from %s", config_file);
+        log_error("Failed to load configuration from %s", config_file);
         return -1;
     }
     
+    /* Command line options override the file */
+    apply_run_options(config, options);
+    logger_set_level(config->log_level);
+    
+    /* Initialize random number generator */
+    init_random(config->seed);
+    
     /* Validate configuration */
     if (!validate_config(config)) {
-        log_message("Invalid configuration");
+        log_error("Invalid configuration");
         return -1;
     }
     
@@ -78,6 +193,7 @@ int initialize_environment(SimConfig *config, const char *config_file) {
 
 
 void display_welcome(SimConfig *config) {
+    logger_flush();
     printf("\n=================================================\n");
     printf("   Secret Agent Simulation System\n");
     printf("=================================================\n");
@@ -90,7 +206,8 @@ void display_welcome(SimConfig *config) {
     log_message("Simulation starting with %d gangs", config->num_gangs);
 }
 
-/* Signal handler for graceful termination */
+/* Signal handler for graceful termination: only async-signal-safe calls;
+ * run_simulation notices the interrupt, stops the actors and cleans up */
 void signal_handler(int sig) {
     // Prevent multiple calls to signal handler
     if (g_shutdown_in_progress) {
@@ -98,48 +215,11 @@ void signal_handler(int sig) {
     }
     
     g_shutdown_in_progress = 1;
-    log_message("Received signal %d, shutting down...", sig);
-    
-    /* First shutdown visualization to prevent X11 errors */
-    shutdown_visualization();
-    
-    /* Tell all child processes to terminate */
-    if (g_msg_queue_id != -1) {
-        IpcMessage msg;
-        msg.mtype = MSG_TYPE_SIMULATION_STATUS;
-        msg.data.status = SIM_STATUS_SHUTDOWN;
-        
-        /* Try to send message but don't block if queue is full */
-        msgsnd(g_msg_queue_id, &msg, sizeof(msg.data), IPC_NOWAIT);
-    }
-    
-    /* Update shared state status */
-    if (g_shared_state_id != -1) {
-        SharedState *state = (SharedState *)attach_shared_memory(g_shared_state_id);
-        if (state) {
-            pthread_mutex_lock(&state->status_mutex);
-            state->status = SIM_STATUS_SHUTDOWN;
-            pthread_mutex_unlock(&state->status_mutex);
-            
-            /* Send termination signals */
-            for (int i = 0; i < state->gang_count; i++) {
-                pid_t gang_pid = state->gangs[i].process_id;
-                if (gang_pid > 0) {
-                    kill(gang_pid, SIGTERM);
-                }
-            }
-            
-            detach_shared_memory(state);
-        }
-    }
-    
-    /* Wait a bit for children to react */
-    usleep(500000);  // 500ms
-    
-    /* Cleanup resources */
-    cleanup_ipc_resources(g_shared_state_id, g_msg_queue_id);
+    log_signal_safe(sig, "Received signal, shutting down...");
     
-    exit(0);
+    /* Wake the actors on a virtual clock, which stops with us */
+    sim_clock_stop();
+    simulation_interrupt();
 }
 void register_signal_handlers(void) {
     /* Register for SIGINT (Ctrl+C) */
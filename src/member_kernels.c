@@ -0,0 +1,136 @@
+#include "../include/member_kernels.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static inline float clamp_unit(float value) {
+    return value > 1.0f ? 1.0f : value;
+}
+
+void member_mission_progress_kernel(float *prep, float *knowledge, const int *rank,
+                                    const float *mask, int count, const MissionProgressParams *params) {
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 inv_ranks = _mm_set1_ps(params->inv_ranks);
+    const __m128 prep_base = _mm_set1_ps(params->prep_base);
+    const __m128 prep_rank = _mm_set1_ps(params->prep_rank);
+    const __m128 info_base = _mm_set1_ps(params->info_base);
+    const __m128 info_rank = _mm_set1_ps(params->info_rank);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 rank_f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_load_si128((const __m128i *)(rank + i))), inv_ranks);
+        __m128 m = _mm_load_ps(mask + i);
+
+        __m128 dp = _mm_mul_ps(m, _mm_add_ps(prep_base, _mm_mul_ps(prep_rank, rank_f)));
+        _mm_store_ps(prep + i, _mm_min_ps(one, _mm_add_ps(_mm_load_ps(prep + i), dp)));
+
+        __m128 dk = _mm_mul_ps(m, _mm_add_ps(info_base, _mm_mul_ps(info_rank, rank_f)));
+        _mm_store_ps(knowledge + i, _mm_min_ps(one, _mm_add_ps(_mm_load_ps(knowledge + i), dk)));
+    }
+#endif
+
+    for (; i < count; i++) {
+        if (mask[i] == 0.0f) {
+            continue;
+        }
+        float rank_f = rank[i] * params->inv_ranks;
+        prep[i] = clamp_unit(prep[i] + params->prep_base + params->prep_rank * rank_f);
+        knowledge[i] = clamp_unit(knowledge[i] + params->info_base + params->info_rank * rank_f);
+    }
+}
+
+// Promote each eligible member whose draw falls under its promotion chance.
+// Returns the number of promotions; promoted[i] is set for each one.
+int member_promotion_kernel(int *rank, const float *mask, const float *draws, int count,
+                            float base_chance, float inv_ranks, unsigned char *promoted) {
+    int promotions = 0;
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 base = _mm_set1_ps(base_chance);
+    const __m128 inv = _mm_set1_ps(inv_ranks);
+    const __m128i int_one = _mm_set1_epi32(1);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i r = _mm_load_si128((const __m128i *)(rank + i));
+        // Chance of promotion is higher at lower ranks
+        __m128 chance = _mm_mul_ps(base, _mm_sub_ps(one, _mm_mul_ps(_mm_cvtepi32_ps(r), inv)));
+        __m128 hit = _mm_and_ps(_mm_cmplt_ps(_mm_load_ps(draws + i), chance),
+                                _mm_cmpneq_ps(_mm_load_ps(mask + i), _mm_setzero_ps()));
+        __m128i hit_i = _mm_castps_si128(hit);
+        _mm_store_si128((__m128i *)(rank + i), _mm_add_epi32(r, _mm_and_si128(hit_i, int_one)));
+
+        int bits = _mm_movemask_ps(hit);
+        for (int lane = 0; lane < 4; lane++) {
+            promoted[i + lane] = (bits >> lane) & 1;
+        }
+        promotions += __builtin_popcount(bits);
+    }
+#endif
+
+    for (; i < count; i++) {
+        float chance = base_chance * (1.0f - rank[i] * inv_ranks);
+        promoted[i] = mask[i] != 0.0f && draws[i] < chance;
+        if (promoted[i]) {
+            rank[i]++;
+            promotions++;
+        }
+    }
+
+    return promotions;
+}
+
+// Every member exchanges with the average of its neighbors at once: the
+// gains are gathered from the knowledge before the call, then applied in
+// bulk, so the result does not depend on the order of the members
+void member_diffusion_kernel(float *knowledge, float *gain, const int *rank, const int *agent_id,
+                             const int *row_offsets, const int *neighbors, int count,
+                             const DiffusionParams *params) {
+    for (int v = 0; v < count; v++) {
+        int first = row_offsets[v];
+        int degree = row_offsets[v + 1] - first;
+        float total = 0.0f;
+
+        if (degree == 0) {
+            gain[v] = 0.0f;
+            continue;
+        }
+        for (int e = first; e < first + degree; e++) {
+            int u = neighbors[e];
+            if (rank[u] < rank[v]) {
+                continue;  // Knowledge only flows down the ranks or between peers
+            }
+            float gap = knowledge[u] - knowledge[v];
+            float pushed = params->transfer_base + params->transfer_gap * gap;
+            if (pushed > 0.0f) {
+                total += pushed;
+            }
+            if (rank[u] > rank[v] && gap > 0.0f) {
+                total += params->pull_rate * gap;
+            }
+        }
+        gain[v] = params->step * total / degree;
+        if (agent_id[v] >= 0) {
+            gain[v] += params->step * params->agent_gain;
+        }
+    }
+
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 k = _mm_add_ps(_mm_load_ps(knowledge + i), _mm_load_ps(gain + i));
+        _mm_store_ps(knowledge + i, _mm_min_ps(one, k));
+    }
+#endif
+
+    for (; i < count; i++) {
+        knowledge[i] = clamp_unit(knowledge[i] + gain[i]);
+    }
+}
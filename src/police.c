@@ -1,10 +1,17 @@
 #include "../include/police.h"
+#include "../include/gang.h"
 #include "../include/ipc.h"
 #include "../include/utils.h"
+#include "../include/sim_clock.h"
+#include "../include/shared_state.h"
+#include "../include/trace.h"
+#include "../include/checkpoint.h"
 static volatile sig_atomic_t police_shutdown_requested = 0;
 void police_signal_handler(int sig)
 {
     police_shutdown_requested = 1;
+    // Nobody may be left to move a virtual clock on to our wakeup
+    sim_clock_stop();
 }
 
 void police_process_main(SimConfig *config, int msg_queue_id, int shared_mem_id)
@@ -14,96 +21,206 @@ void police_process_main(SimConfig *config, int msg_queue_id, int shared_mem_id)
     SharedState *shared_state = (SharedState *)attach_shared_memory(shared_mem_id);
     if (!shared_state)
     {
-        log_message("Police: Failed to attach to shared memory");
+        log_error("Police: Failed to attach to shared memory");
         exit(EXIT_FAILURE);
     }
+    ipc_attach_state(shared_state);
+    sim_clock_attach(shared_state);
+    sim_clock_join();
 
-    SecretAgent agents[MAX_AGENTS];
-    GangIntelligence intel[MAX_GANGS];
-    int agent_count = 0;
-    IpcMessage message;
-    bool simulation_running = true;
+    PoliceRuntime *runtime = calloc(1, sizeof(PoliceRuntime));
+    if (!runtime)
+    {
+        log_error("Police: Failed to allocate police state");
+        detach_shared_memory(shared_state);
+        exit(EXIT_FAILURE);
+    }
 
-    memset(agents, 0, sizeof(agents));
-    init_intelligence(intel, shared_state->gang_count);
+    if (police_runtime_start(runtime, config, msg_queue_id, shared_state) != 0)
+    {
+        log_error("Police: Failed to allocate police state");
+        free(runtime);
+        detach_shared_memory(shared_state);
+        exit(EXIT_FAILURE);
+    }
 
-    log_message("Police: Process started");
+    // Main police loop
+    while (!police_shutdown_requested && police_tick(runtime))
+    {
+        // Sleep until a report or a status change arrives
+        police_wait(runtime);
+    }
 
-    // Attempt to infiltrate gangs with secret agents
-    int infiltrated = infiltrate_gangs(shared_state, agents, intel, config, &agent_count);
-    log_message("Police: Infiltrated %d agents into gangs", infiltrated);
+    if (police_shutdown_requested)
+    {
+        log_message("Police: Received direct termination signal");
+    }
 
-    // Main police loop
-    while (simulation_running && !police_shutdown_requested)
+    sim_clock_leave();
+    police_runtime_stop(runtime);
+    free(runtime);
+    sim_clock_attach(NULL);
+    detach_shared_memory(shared_state);
+}
+
+int police_runtime_start(PoliceRuntime *runtime, SimConfig *config, int msg_queue_id, SharedState *shared_state)
+{
+    int gang_count = shared_state->gang_count;
+    int agent_capacity = shared_state->layout.agent_capacity;
+    int agents_per_gang = gang_count > 0 ? agent_capacity / gang_count : 0;
+
+    memset(runtime, 0, sizeof(PoliceRuntime));
+    runtime->config = config;
+    runtime->msg_queue_id = msg_queue_id;
+    runtime->shared_state = shared_state;
+
+    // Agent tables follow the capacities the shared state was laid out with
+    runtime->agents = calloc(agent_capacity, sizeof(SecretAgent));
+    runtime->intel = calloc(gang_count, sizeof(GangIntelligence));
+    runtime->intel_agent_ids = calloc(agent_capacity, sizeof(int));
+    if ((agent_capacity > 0 && (!runtime->agents || !runtime->intel_agent_ids)) ||
+        (gang_count > 0 && !runtime->intel))
     {
-        if (police_shutdown_requested)
-        {
-            log_message("Police: Received direct termination signal");
-            simulation_running = false;
-            break;
-        }
-        // Check for messages from agents
-        if (!police_shutdown_requested && 
-            receive_message(msg_queue_id, &message, MSG_TYPE_AGENT_REPORT, true) == 0) {
-            
-            // Only process if we're not shutting down
-            if (!police_shutdown_requested) {
-                if (process_agent_report(&message.data.agent_report, agents, intel, 
-                                        config, agent_count)) {
-                    // Take action against the gang if confidence is high enough
-                    take_police_action(message.data.agent_report.gang_id, 
-                                     msg_queue_id, shared_state, config);
-                }
-            }
-        }
+        police_runtime_stop(runtime);
+        return -1;
+    }
 
-        // Check for simulation status updates
-        if (receive_message(msg_queue_id, &message, MSG_TYPE_SIMULATION_STATUS, true) == 0)
-        {
-            if (message.data.status != SIM_STATUS_RUNNING)
-            {
-                log_message("Police: Received shutdown signal, status=%d", message.data.status);
-                simulation_running = false;
+    rng_seed_stream(&runtime->rng, RNG_STREAM_POLICE);
+    rng_bind_thread(&runtime->rng);
+
+    // A restored police finds its agents where the checkpoint left them
+    if (checkpoint_restoring())
+    {
+        checkpoint_restore_police(runtime);
+        log_message("Police: Process started with %d agents from the checkpoint", runtime->agent_count);
+    }
+    else
+    {
+        init_intelligence(runtime->intel, runtime->intel_agent_ids, gang_count, agents_per_gang);
+
+        log_message("Police: Process started");
+
+        // Attempt to infiltrate gangs with secret agents
+        int infiltrated = infiltrate_gangs(shared_state, runtime->agents, runtime->intel, config,
+                                           &runtime->agent_count);
+        log_message("Police: Infiltrated %d agents into gangs", infiltrated);
+    }
+
+    // A what-if run may open with a raid the intelligence has not called for
+    if (config->initial_raid_gang >= 0 && config->initial_raid_gang < gang_count)
+    {
+        take_police_action(config->initial_raid_gang, msg_queue_id, shared_state, config);
+    }
+    return 0;
+}
+
+// One pass of the police main loop; returns false once the police should stop
+bool police_tick(PoliceRuntime *runtime)
+{
+    SharedState *shared_state = runtime->shared_state;
+    SimConfig *config = runtime->config;
+    int msg_queue_id = runtime->msg_queue_id;
+    IpcMessage message;
+    bool simulation_running = true;
+
+    rng_bind_thread(&runtime->rng);
+    PoliceMetrics *metrics = &shared_metrics(shared_state)->police;
+    metric_add(&metrics->ticks, 1);
+
+    // Anything signalled from here on wakes the next police_wait
+    runtime->seen_events = event_prepare(&shared_state->police_event);
+
+    // Drain the messages from agents
+    while (!police_shutdown_requested && 
+           receive_message(msg_queue_id, &message, MSG_TYPE_AGENT_REPORT, true) == 0) {
+        
+        // Only process if we're not shutting down
+        if (!police_shutdown_requested) {
+            metric_add(&metrics->reports_processed, 1);
+            if (process_agent_report(&message.data.agent_report, runtime->agents, runtime->intel, 
+                                    config, runtime->agent_count)) {
+                // Take action against the gang if confidence is high enough
+                take_police_action(message.data.agent_report.gang_id, 
+                                 msg_queue_id, shared_state, config);
+                metrics_record_latency(metrics, metrics_now_ns() - message.data.agent_report.sent_ns);
             }
         }
+    }
 
-        // Add a safety check for external termination
-        if (shared_state->status != SIM_STATUS_RUNNING)
+    // Check for simulation status updates
+    if (receive_message(msg_queue_id, &message, MSG_TYPE_SIMULATION_STATUS, true) == 0)
+    {
+        if (message.data.status != SIM_STATUS_RUNNING)
         {
-            log_message("Police: Detected simulation status change to %d", shared_state->status);
+            log_message("Police: Received shutdown signal, status=%d", message.data.status);
             simulation_running = false;
         }
+    }
 
-        // Periodically review intelligence
-        review_intelligence(intel, agents, shared_state, shared_state->gang_count, agent_count);
+    // Add a safety check for external termination
+    SimulationStatus status = get_simulation_status(shared_state);
+    if (status != SIM_STATUS_RUNNING)
+    {
+        log_message("Police: Detected simulation status change to %d", status);
+        simulation_running = false;
+    }
 
-        // Check if ending conditions are met
-        if (check_end_conditions(shared_state, config))
-        {
-            simulation_running = false;
-        }
+    // Periodically review intelligence
+    time_t now = sim_time();
+    if (now - runtime->last_review >= POLICE_REVIEW_INTERVAL)
+    {
+        runtime->last_review = now;
+        review_intelligence(runtime->intel, shared_state, shared_state->gang_count, now);
+    }
+
+    // Copy the police tables into the checkpoint between two reports
+    if (!runtime->checkpointed && checkpoint_requested())
+    {
+        checkpoint_save_police(runtime);
+        runtime->checkpointed = true;
+    }
 
-        // Sleep a bit to avoid using 100% CPU
-        usleep(100000); // 100ms
+    // Check if ending conditions are met
+    if (check_end_conditions(shared_state, config))
+    {
+        simulation_running = false;
     }
 
+    return simulation_running;
+}
+
+// Sleep until the next report, status change or intelligence review
+void police_wait(PoliceRuntime *runtime)
+{
+    event_wait_ms(&runtime->shared_state->police_event, runtime->seen_events, POLICE_IDLE_MS);
+}
+
+void police_runtime_stop(PoliceRuntime *runtime)
+{
     log_message("Police: Process shutting down");
-    police_cleanup(intel);
-    detach_shared_memory(shared_state);
+    police_cleanup(runtime->intel);
+    free(runtime->agents);
+    free(runtime->intel);
+    free(runtime->intel_agent_ids);
+    runtime->agents = NULL;
+    runtime->intel = NULL;
+    runtime->intel_agent_ids = NULL;
 }
 
-void init_intelligence(GangIntelligence *intel, int gang_count)
+void init_intelligence(GangIntelligence *intel, int *agent_ids, int gang_count, int agents_per_gang)
 {
     for (int i = 0; i < gang_count; i++)
     {
         intel[i].gang_id = i;
         intel[i].under_surveillance = false;
-        intel[i].suspected_target = rand() % TARGET_COUNT;
+        intel[i].suspected_target = rand_range(0, TARGET_COUNT - 1);
         intel[i].suspicion_level = 0.0;
         intel[i].estimated_execution_time = 0;
         intel[i].confirmed_reports = 0;
         intel[i].agent_count = 0;
-        memset(intel[i].agent_ids, -1, sizeof(intel[i].agent_ids));
+        intel[i].agent_ids = agent_ids + (size_t)i * agents_per_gang;
+        intel[i].first_report_time = 0;
+        memset(intel[i].agent_ids, -1, sizeof(int) * agents_per_gang);
     }
 }
 
@@ -113,21 +230,23 @@ int infiltrate_gangs(SharedState *shared_state, SecretAgent *agents, GangIntelli
     int infiltrated = 0;
     int current_agent_id = 0;
 
-    pthread_mutex_lock(&shared_state->status_mutex);
-
     // Try to infiltrate each gang based on success rate
     for (int gang_id = 0; gang_id < shared_state->gang_count; gang_id++)
     {
-        Gang *gang = &shared_state->gangs[gang_id];
+        Gang *gang = shared_gang(shared_state, gang_id);
+        MemberStore members = gang_members(gang);
         int gang_agent_count = 0;
 
+        // The gang may already be running; only its own lock is needed
+        gang_lock(gang);
+
         // Attempt to place agents based on infiltration rate
         for (int member_id = 0; member_id < gang->member_count; member_id++)
         {
             if (rand_float() < config->agent_infiltration_rate)
             {
                 // Make sure we haven't hit the global agent limit
-                if (*agent_count >= MAX_AGENTS)
+                if (*agent_count >= shared_state->layout.agent_capacity)
                 {
                     break;
                 }
@@ -141,21 +260,20 @@ int infiltrate_gangs(SharedState *shared_state, SecretAgent *agents, GangIntelli
                 }
 
                 // Check if this member is already infiltrated
-                if (gang->members[member_id].is_agent)
+                if (members.agent_id[member_id] >= 0)
                 {
                     continue;
                 }
 
                 // Infiltrate this member
-                gang->members[member_id].is_agent = true;
-                gang->members[member_id].agent_id = current_agent_id;
+                members.agent_id[member_id] = current_agent_id;
 
                 // Add to agent tracking
                 agents[current_agent_id].id = current_agent_id;
                 agents[current_agent_id].gang_id = gang_id;
                 agents[current_agent_id].member_id = member_id;
                 agents[current_agent_id].status = AGENT_STATUS_ACTIVE;
-                agents[current_agent_id].last_report_time = time(NULL);
+                agents[current_agent_id].last_report_time = sim_time();
                 agents[current_agent_id].last_reported_target = TARGET_COUNT; // Invalid target means no report yet
                 agents[current_agent_id].confidence_level = 0.0;
 
@@ -164,7 +282,7 @@ int infiltrate_gangs(SharedState *shared_state, SecretAgent *agents, GangIntelli
                 intel[gang_id].agent_count++;
 
                 // Update global agent status
-                shared_state->agent_statuses[current_agent_id] = AGENT_STATUS_ACTIVE;
+                update_agent_status(shared_state, current_agent_id, AGENT_STATUS_ACTIVE);
 
                 current_agent_id++;
                 (*agent_count)++;
@@ -172,23 +290,23 @@ int infiltrate_gangs(SharedState *shared_state, SecretAgent *agents, GangIntelli
                 gang_agent_count++;
             }
         }
+
+        pthread_mutex_unlock(&gang->lock);
     }
 
     // Update the global agent count
-    shared_state->agent_count = *agent_count;
+    __atomic_store_n(&shared_state->agent_count, *agent_count, __ATOMIC_RELEASE);
     if (*agent_count > 0 && *agent_count < config->agent_execution_loss_count) {
         // Update local config copy
         config->agent_execution_loss_count = *agent_count;
         
         // Update shared state's config copy
-        shared_state->agent_execution_loss_count = *agent_count;
+        __atomic_store_n(&shared_state->agent_execution_loss_count, *agent_count, __ATOMIC_RELEASE);
         
         log_message("Police: Adjusting agent_execution_loss_count to %d to match actual agent count", 
                   *agent_count);
     }
 
-    pthread_mutex_unlock(&shared_state->status_mutex);
-
     return infiltrated;
 }
 
@@ -206,13 +324,13 @@ bool process_agent_report(AgentReport *report, SecretAgent *agents, GangIntellig
         // During shutdown, we'll just silently ignore
         if (!police_shutdown_requested)
         {
-            log_message("Police: Invalid agent ID in report: %d", agent_id);
+            log_error("Police: Invalid agent ID in report: %d", agent_id);
         }
         return false;
     }
 
     // Update agent data
-    agents[agent_id].last_report_time = time(NULL);
+    agents[agent_id].last_report_time = sim_time();
     agents[agent_id].last_reported_target = report->suspected_target;
     agents[agent_id].confidence_level = report->confidence_level;
 
@@ -239,10 +357,9 @@ bool process_agent_report(AgentReport *report, SecretAgent *agents, GangIntellig
     }
 
     // Store when we first received a report for this gang
-    static time_t first_report_times[MAX_GANGS];
     if (gang_intel->confirmed_reports == 1)
     {
-        first_report_times[gang_id] = time(NULL);
+        gang_intel->first_report_time = sim_time();
     }
 
     // Decide if we should act based on suspicion level, confirmation threshold, and delay
@@ -250,7 +367,7 @@ bool process_agent_report(AgentReport *report, SecretAgent *agents, GangIntellig
 
     if (gang_intel->suspicion_level > config->police_confirmation_threshold &&
         gang_intel->confirmed_reports >= gang_intel->agent_count &&
-        time(NULL) - first_report_times[gang_id] >= min_investigation_time)
+        sim_time() - gang_intel->first_report_time >= min_investigation_time)
     {
         should_act = true;
         log_message("Police: Sufficient evidence to act against gang %d", gang_id);
@@ -264,14 +381,15 @@ bool process_agent_report(AgentReport *report, SecretAgent *agents, GangIntellig
 void take_police_action(int gang_id, int msg_queue_id, SharedState *shared_state, SimConfig *config)
 {
     log_message("Police: Taking action against gang %d", gang_id);
+    trace_event(TRACE_POLICE_ACTION, gang_id, -1, config->prison_time, 0, 0.0f);
 
-    // Send arrest order to the gang
+    // Send arrest order to the gang and wake it up for it
     send_police_order(msg_queue_id, gang_id, config->prison_time);
+    notify_gang(shared_state, gang_id);
 
     // Update statistics
-    pthread_mutex_lock(&shared_state->status_mutex);
-    shared_state->total_thwarted_plans++;
-    pthread_mutex_unlock(&shared_state->status_mutex);
+    __atomic_add_fetch(&shared_state->total_thwarted_plans, 1, __ATOMIC_RELAXED);
+    metric_add(&shared_metrics(shared_state)->police.actions, 1);
 }
 
 void handle_agent_discovery(int agent_id, SecretAgent *agents, GangIntelligence *intel,
@@ -288,12 +406,11 @@ void handle_agent_discovery(int agent_id, SecretAgent *agents, GangIntelligence
 
     // Update agent status
     agents[agent_id].status = AGENT_STATUS_UNCOVERED;
+    metric_add(&shared_metrics(shared_state)->police.agents_discovered, 1);
 
     // Update shared state
-    pthread_mutex_lock(&shared_state->status_mutex);
-    shared_state->agent_statuses[agent_id] = AGENT_STATUS_UNCOVERED;
-    shared_state->total_executed_agents++;
-    pthread_mutex_unlock(&shared_state->status_mutex);
+    update_agent_status(shared_state, agent_id, AGENT_STATUS_UNCOVERED);
+    __atomic_add_fetch(&shared_state->total_executed_agents, 1, __ATOMIC_RELAXED);
 
     // Remove from intelligence array
     GangIntelligence *gang_intel = &intel[gang_id];
@@ -314,53 +431,52 @@ void handle_agent_discovery(int agent_id, SecretAgent *agents, GangIntelligence
 
 bool check_end_conditions(SharedState *shared_state, SimConfig *config)
 {
-    pthread_mutex_lock(&shared_state->status_mutex);
-
-    bool should_end = false;
-    SimulationStatus status = shared_state->status;
+    // Counters are bumped by the actors without a lock; a stale read only
+    // delays the end by one tick
+    int thwarted = __atomic_load_n(&shared_state->total_thwarted_plans, __ATOMIC_RELAXED);
+    int successful = __atomic_load_n(&shared_state->total_successful_plans, __ATOMIC_RELAXED);
+    int executed = __atomic_load_n(&shared_state->total_executed_agents, __ATOMIC_RELAXED);
     
     // Get the adjusted agent_execution_loss_count from shared memory
-    int adjusted_agent_loss_count = shared_state->agent_execution_loss_count > 0 ? 
-                                   shared_state->agent_execution_loss_count : 
-                                   config->agent_execution_loss_count;
+    int adjusted_agent_loss_count = __atomic_load_n(&shared_state->agent_execution_loss_count, __ATOMIC_ACQUIRE);
+    if (adjusted_agent_loss_count <= 0)
+    {
+        adjusted_agent_loss_count = config->agent_execution_loss_count;
+    }
 
     // Police win condition
-    if (shared_state->total_thwarted_plans >= config->police_thwart_win_count &&
-        status == SIM_STATUS_RUNNING)
+    if (thwarted >= config->police_thwart_win_count &&
+        end_simulation(shared_state, SIM_STATUS_POLICE_WIN))
     {
-        shared_state->status = SIM_STATUS_POLICE_WIN;
-        should_end = true;
-        log_message("Police: Win condition met - %d plans thwarted", shared_state->total_thwarted_plans);
+        log_message("Police: Win condition met - %d plans thwarted", thwarted);
+        return true;
     }
 
     // Gangs win condition
-    if (shared_state->total_successful_plans >= config->gang_success_win_count &&
-        status == SIM_STATUS_RUNNING)
+    if (successful >= config->gang_success_win_count &&
+        end_simulation(shared_state, SIM_STATUS_GANGS_WIN))
     {
-        shared_state->status = SIM_STATUS_GANGS_WIN;
-        should_end = true;
-        log_message("Police: Loss condition met - gangs successful %d times",
-                    shared_state->total_successful_plans);
+        log_message("Police: Loss condition met - gangs successful %d times", successful);
+        return true;
     }
 
     // Agents lost condition - USE THE ADJUSTED VALUE
-    if (shared_state->total_executed_agents >= adjusted_agent_loss_count &&
-        status == SIM_STATUS_RUNNING)
+    if (executed >= adjusted_agent_loss_count &&
+        end_simulation(shared_state, SIM_STATUS_AGENTS_LOST))
     {
-        shared_state->status = SIM_STATUS_AGENTS_LOST;
-        should_end = true;
         log_message("Police: Loss condition met - %d agents executed out of %d limit",
-                    shared_state->total_executed_agents, adjusted_agent_loss_count);
+                    executed, adjusted_agent_loss_count);
+        return true;
     }
 
-    // If status changed, send update
-    if (should_end)
+    // Runs measured over a fixed span end on time
+    if (config->max_sim_seconds > 0.0f && sim_clock_elapsed_sim() >= config->max_sim_seconds &&
+        end_simulation(shared_state, SIM_STATUS_TIME_LIMIT))
     {
-        pthread_mutex_unlock(&shared_state->status_mutex);
+        log_message("Police: Time limit of %.0f simulated seconds reached", config->max_sim_seconds);
         return true;
     }
 
-    pthread_mutex_unlock(&shared_state->status_mutex);
     return false;
 }
 
@@ -379,20 +495,10 @@ float analyze_gang_patterns(GangIntelligence *intel, SharedState *shared_state,
     return suspicion;
 }
 
-void review_intelligence(GangIntelligence *intel, SecretAgent *agents,
-                         SharedState *shared_state, int gang_count, int agent_count)
+// Review every gang under surveillance as of now; the police tick
+// decides how often
+void review_intelligence(GangIntelligence *intel, SharedState *shared_state, int gang_count, time_t now)
 {
-    static time_t last_review = 0;
-    time_t now = time(NULL);
-
-    // Only review every 5 seconds
-    if (now - last_review < 5)
-    {
-        return;
-    }
-
-    last_review = now;
-
     for (int gang_id = 0; gang_id < gang_count; gang_id++)
     {
         if (intel[gang_id].under_surveillance)
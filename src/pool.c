@@ -0,0 +1,283 @@
+#include "../include/pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define POOL_DEQUE_INITIAL_CAPACITY 64
+
+typedef struct {
+    pool_task_fn fn;
+    void *arg;
+} PoolTask;
+
+/* Growable ring buffer; the owner works at the tail, thieves at the head */
+typedef struct {
+    pthread_mutex_t lock;
+    PoolTask *tasks;
+    int capacity;
+    int head;
+    int count;
+} PoolDeque;
+
+typedef struct {
+    WorkPool *pool;
+    int index;
+    pthread_t thread;
+} PoolWorker;
+
+/* The counters are atomic, so submitting, taking and finishing a task
+ * only touch a deque lock; the pool lock and its conditions are only
+ * there for threads parking until there is something for them to do */
+struct WorkPool {
+    int num_workers;
+    int started_workers;
+    PoolWorker *workers;
+    PoolDeque *deques;
+    int next_deque;         /* Round-robin target for external submits */
+    int queued;             /* Tasks sitting in some deque */
+    int outstanding;        /* Tasks submitted but not finished */
+    int shutting_down;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    pthread_cond_t all_done;
+    int idle_workers;       /* Parked on work_available */
+    int waiters;            /* Parked on all_done */
+};
+
+static __thread WorkPool *t_pool = NULL;
+static __thread int t_worker_index = -1;
+
+static int deque_push(PoolDeque *deque, PoolTask task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        int new_capacity = deque->capacity * 2;
+        PoolTask *grown = malloc(sizeof(PoolTask) * new_capacity);
+        if (!grown) {
+            pthread_mutex_unlock(&deque->lock);
+            return -1;
+        }
+        for (int i = 0; i < deque->count; i++) {
+            grown[i] = deque->tasks[(deque->head + i) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = grown;
+        deque->capacity = new_capacity;
+        deque->head = 0;
+    }
+    deque->tasks[(deque->head + deque->count) % deque->capacity] = task;
+    deque->count++;
+    pthread_mutex_unlock(&deque->lock);
+    return 0;
+}
+
+static int deque_pop_tail(PoolDeque *deque, PoolTask *task) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        deque->count--;
+        *task = deque->tasks[(deque->head + deque->count) % deque->capacity];
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int deque_steal_head(PoolDeque *deque, PoolTask *task) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        *task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->count--;
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int take_task(WorkPool *pool, int self, PoolTask *task) {
+    if (deque_pop_tail(&pool->deques[self], task)) {
+        return 1;
+    }
+    for (int i = 1; i < pool->num_workers; i++) {
+        if (deque_steal_head(&pool->deques[(self + i) % pool->num_workers], task)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Wake whoever is parked on cond, if anyone announced itself in parked
+static void wake_parked(WorkPool *pool, int *parked, pthread_cond_t *cond) {
+    if (__atomic_load_n(parked, __ATOMIC_SEQ_CST) == 0) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void *pool_worker_main(void *arg) {
+    PoolWorker *worker = (PoolWorker *)arg;
+    WorkPool *pool = worker->pool;
+    PoolTask task;
+
+    t_pool = pool;
+    t_worker_index = worker->index;
+
+    while (1) {
+        if (take_task(pool, worker->index, &task)) {
+            __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+            task.fn(task.arg);
+            if (__atomic_sub_fetch(&pool->outstanding, 1, __ATOMIC_SEQ_CST) == 0) {
+                wake_parked(pool, &pool->waiters, &pool->all_done);
+            }
+            continue;
+        }
+
+        // Nothing to take: park until a submit or shutdown. Announce
+        // ourselves before the last check, so a submitter either sees an
+        // idle worker or we see its task
+        pthread_mutex_lock(&pool->lock);
+        __atomic_add_fetch(&pool->idle_workers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 &&
+               !__atomic_load_n(&pool->shutting_down, __ATOMIC_SEQ_CST)) {
+            pthread_cond_wait(&pool->work_available, &pool->lock);
+        }
+        __atomic_sub_fetch(&pool->idle_workers, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&pool->lock);
+
+        if (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 &&
+            __atomic_load_n(&pool->shutting_down, __ATOMIC_SEQ_CST)) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+WorkPool *pool_create(int num_workers) {
+    if (num_workers <= 0) {
+        num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (num_workers <= 0) {
+            num_workers = 1;
+        }
+    }
+
+    WorkPool *pool = calloc(1, sizeof(WorkPool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->num_workers = num_workers;
+    pool->workers = calloc(num_workers, sizeof(PoolWorker));
+    pool->deques = calloc(num_workers, sizeof(PoolDeque));
+    if (!pool->workers || !pool->deques) {
+        free(pool->workers);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_available, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+
+    for (int i = 0; i < num_workers; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+        pool->deques[i].capacity = POOL_DEQUE_INITIAL_CAPACITY;
+        pool->deques[i].tasks = malloc(sizeof(PoolTask) * POOL_DEQUE_INITIAL_CAPACITY);
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        if (!pool->deques[i].tasks ||
+            pthread_create(&pool->workers[i].thread, NULL, pool_worker_main, &pool->workers[i]) != 0) {
+            // Shut down whatever was started
+            pool_destroy(pool);
+            return NULL;
+        }
+        pool->started_workers++;
+    }
+
+    return pool;
+}
+
+int pool_submit(WorkPool *pool, pool_task_fn fn, void *arg) {
+    PoolTask task = { fn, arg };
+    int target;
+
+    // External submits come from the one thread driving the pool
+    if (t_pool == pool) {
+        target = t_worker_index;
+    } else {
+        target = pool->next_deque;
+        pool->next_deque = (pool->next_deque + 1) % pool->num_workers;
+    }
+
+    // Count the task before it can be taken, so neither counter ever runs
+    // behind the deques
+    __atomic_add_fetch(&pool->outstanding, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+    if (deque_push(&pool->deques[target], task) != 0) {
+        __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+        __atomic_sub_fetch(&pool->outstanding, 1, __ATOMIC_SEQ_CST);
+        // Out of memory: run it here rather than lose it
+        fn(arg);
+        return -1;
+    }
+
+    // A busy worker finds the task by itself
+    if (__atomic_load_n(&pool->idle_workers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->work_available);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return 0;
+}
+
+void pool_wait(WorkPool *pool) {
+    if (__atomic_load_n(&pool->outstanding, __ATOMIC_SEQ_CST) == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    __atomic_add_fetch(&pool->waiters, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&pool->outstanding, __ATOMIC_SEQ_CST) > 0) {
+        pthread_cond_wait(&pool->all_done, &pool->lock);
+    }
+    __atomic_sub_fetch(&pool->waiters, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int pool_worker_count(const WorkPool *pool) {
+    return pool->num_workers;
+}
+
+void pool_destroy(WorkPool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    __atomic_store_n(&pool->shutting_down, 1, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->started_workers; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_available);
+    pthread_cond_destroy(&pool->all_done);
+    free(pool->deques);
+    free(pool->workers);
+    free(pool);
+}
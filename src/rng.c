@@ -0,0 +1,108 @@
+#include "../include/rng.h"
+#include <string.h>
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+#define PHILOX_ROUNDS 10
+
+static uint64_t g_master_seed = 0;
+static uint64_t g_fallback_streams = 0;
+
+static __thread RngStream *t_bound_stream = NULL;
+static __thread RngStream t_fallback_stream;
+static __thread int t_fallback_ready = 0;
+
+// SplitMix64 finalizer, used to spread the master seed into a key
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static void philox_block(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        uint32_t hi0 = (uint32_t)(p0 >> 32), lo0 = (uint32_t)p0;
+        uint32_t hi1 = (uint32_t)(p1 >> 32), lo1 = (uint32_t)p1;
+
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+void rng_set_master_seed(uint64_t seed) {
+    g_master_seed = seed;
+}
+
+uint64_t rng_master_seed(void) {
+    return g_master_seed;
+}
+
+void rng_seed_stream(RngStream *rng, uint64_t stream_id) {
+    uint64_t key = splitmix64(g_master_seed);
+
+    memset(rng, 0, sizeof(RngStream));
+    rng->key[0] = (uint32_t)key;
+    rng->key[1] = (uint32_t)(key >> 32);
+    // Low half of the counter is the block number, high half the stream
+    rng->counter[2] = (uint32_t)stream_id;
+    rng->counter[3] = (uint32_t)(stream_id >> 32);
+    rng->index = 4;
+}
+
+uint32_t rng_next_u32(RngStream *rng) {
+    if (rng->index >= 4) {
+        philox_block(rng->counter, rng->key, rng->block);
+        if (++rng->counter[0] == 0) {
+            rng->counter[1]++;
+        }
+        rng->index = 0;
+    }
+    return rng->block[rng->index++];
+}
+
+// Uniform float in [0, 1)
+float rng_float(RngStream *rng) {
+    return (rng_next_u32(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Uniform integer in [min, max]
+int rng_range(RngStream *rng, int min, int max) {
+    uint32_t span = (uint32_t)(max - min) + 1;
+    return min + (int)(((uint64_t)rng_next_u32(rng) * span) >> 32);
+}
+
+void rng_bind_thread(RngStream *rng) {
+    t_bound_stream = rng;
+}
+
+RngStream *rng_thread_stream(void) {
+    if (t_bound_stream) {
+        return t_bound_stream;
+    }
+
+    // Threads that never bound a stream still get a private one
+    if (!t_fallback_ready) {
+        uint64_t id = __atomic_fetch_add(&g_fallback_streams, 1, __ATOMIC_RELAXED);
+        rng_seed_stream(&t_fallback_stream, RNG_STREAM_FALLBACK_BASE + id);
+        t_fallback_ready = 1;
+    }
+    return &t_fallback_stream;
+}
@@ -0,0 +1,200 @@
+#include "../include/shard.h"
+#include "../include/utils.h"
+#include "../include/ipc.h"
+#include "../include/sim_clock.h"
+#include "../include/shared_state.h"
+#include "../include/checkpoint.h"
+
+// Sleep until the next tick, handling arrest orders for the shard's gangs
+static void shard_wait(GangShard *shard, const bool *running, long ms) {
+    SharedState *shared_state = shard->gangs[0]->shared_state;
+    SimEvent *event = shared_wake_event(shared_state, shard->index);
+    long long deadline = sim_time_ms() + ms;
+    
+    for (;;) {
+        unsigned int seen = event_prepare(event);
+        for (int i = 0; i < shard->gang_count; i++) {
+            if (running[i]) {
+                gang_handle_orders(shard->gangs[i]);
+            }
+        }
+        
+        long long remaining = deadline - sim_time_ms();
+        if (remaining <= 0 || get_simulation_status(shared_state) != SIM_STATUS_RUNNING) {
+            return;
+        }
+        if (!event_wait_ms(event, seen, remaining)) {
+            return;
+        }
+    }
+}
+
+static void *shard_thread_main(void *arg) {
+    GangShard *shard = (GangShard *)arg;
+    bool *running = calloc(shard->gang_count, sizeof(bool));
+    int active = shard->gang_count;
+
+    sim_clock_join();
+    if (!running) {
+        log_error("Shard %d: Failed to allocate gang state", shard->index);
+        sim_clock_leave();
+        return NULL;
+    }
+    for (int i = 0; i < shard->gang_count; i++) {
+        running[i] = true;
+    }
+
+    while (active > 0) {
+        for (int i = 0; i < shard->gang_count; i++) {
+            if (running[i] && !gang_tick(shard->gangs[i])) {
+                running[i] = false;
+                active--;
+            }
+        }
+
+        // One tick covers every gang of the shard
+        if (active > 0) {
+            shard_wait(shard, running, GANG_TICK_MS);
+        }
+    }
+
+    sim_clock_leave();
+    free(running);
+    return NULL;
+}
+
+static void *police_thread_main(void *arg) {
+    PoliceRuntime *police = (PoliceRuntime *)arg;
+
+    sim_clock_join();
+    while (police_tick(police)) {
+        police_wait(police);
+    }
+    sim_clock_leave();
+    return NULL;
+}
+
+int run_inprocess_simulation(SharedState *shared_state, SimConfig *config, int msg_queue_id) {
+    int gang_count = config->num_gangs;
+    int shard_count = config->shard_threads > 0 ? config->shard_threads
+                                                : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (shard_count <= 0) {
+        shard_count = 1;
+    }
+    if (shard_count > gang_count) {
+        shard_count = gang_count;
+    }
+
+    GangRuntime *runtimes = calloc(gang_count, sizeof(GangRuntime));
+    GangRuntime **shard_gangs = calloc(gang_count, sizeof(GangRuntime *));
+    GangShard *shards = calloc(shard_count, sizeof(GangShard));
+    PoliceRuntime *police = calloc(1, sizeof(PoliceRuntime));
+    pthread_t police_thread;
+    int started_gangs = 0, started_shards = 0;
+    int result = -1;
+
+    if (!runtimes || !shard_gangs || !shards || !police) {
+        log_error("Failed to allocate in-process simulation state");
+        goto out;
+    }
+
+    // Draw the gang sizes from the main stream, as the process mode does;
+    // a restored gang brings its members
+    for (int i = 0; i < gang_count; i++) {
+        int member_count;
+        if (checkpoint_restoring()) {
+            member_count = checkpoint_restore_gang(shared_state, i);
+        } else {
+            member_count = rand_range(config->min_members_per_gang, config->max_members_per_gang);
+            if (gang_init(shared_gang(shared_state, i), i, member_count, config) != 0) {
+                member_count = -1;
+            }
+        }
+        if (member_count < 0) {
+            log_error("Failed to initialize gang %d", i);
+            goto out;
+        }
+        log_message("Created gang %d with %d members", i, member_count);
+    }
+
+    // Starting the actors binds this thread to their streams; restore it after
+    RngStream *main_rng = rng_thread_stream();
+
+    // Member steps run inline on the owning shard
+    for (int i = 0; i < gang_count; i++) {
+        if (gang_runtime_start(&runtimes[i], i, config, msg_queue_id, shared_state, 0) != 0) {
+            log_error("Failed to start gang %d", i);
+            rng_bind_thread(main_rng);
+            goto out;
+        }
+        started_gangs++;
+    }
+
+    // The police infiltrates before any gang starts ticking
+    if (police_runtime_start(police, config, msg_queue_id, shared_state) != 0) {
+        log_error("Failed to start the police");
+        rng_bind_thread(main_rng);
+        goto out;
+    }
+    rng_bind_thread(main_rng);
+
+    // Partition the gangs round-robin over the shards; a shard sleeps on
+    // its own wake event, so the police wakes the shard of a gang
+    int next = 0;
+    for (int s = 0; s < shard_count; s++) {
+        shards[s].index = s;
+        shards[s].gangs = &shard_gangs[next];
+        for (int i = s; i < gang_count; i += shard_count) {
+            shard_gangs[next++] = &runtimes[i];
+            runtimes[i].gang->wake_slot = s;
+            shards[s].gang_count++;
+        }
+    }
+
+    // The virtual clock waits for every actor announced here
+    sim_clock_expect(1 + shard_count);
+    if (pthread_create(&police_thread, NULL, police_thread_main, police) != 0) {
+        log_error("Failed to create police thread");
+        sim_clock_expect(-1 - shard_count);
+        police_runtime_stop(police);
+        goto out;
+    }
+
+    for (int s = 0; s < shard_count; s++) {
+        if (pthread_create(&shards[s].thread, NULL, shard_thread_main, &shards[s]) != 0) {
+            log_error("Failed to create shard thread %d", s);
+            sim_clock_expect(started_shards - shard_count);
+            break;
+        }
+        started_shards++;
+    }
+    sim_clock_start();
+
+    log_message("Simulation started in-process with %d gangs on %d shard threads",
+                gang_count, started_shards);
+
+    if (started_shards < shard_count) {
+        set_simulation_status(shared_state, SIM_STATUS_SHUTDOWN);
+    }
+
+    pthread_join(police_thread, NULL);
+
+    // Make sure the shards see the end of the simulation
+    end_simulation(shared_state, SIM_STATUS_SHUTDOWN);
+
+    for (int s = 0; s < started_shards; s++) {
+        pthread_join(shards[s].thread, NULL);
+    }
+    police_runtime_stop(police);
+    result = started_shards == shard_count ? 0 : -1;
+
+out:
+    for (int i = 0; i < started_gangs; i++) {
+        gang_runtime_stop(&runtimes[i]);
+    }
+    free(police);
+    free(shards);
+    free(shard_gangs);
+    free(runtimes);
+    return result;
+}
@@ -0,0 +1,135 @@
+#include "../include/shared_state.h"
+#include "../include/bitset.h"
+
+#include <limits.h>
+
+// Reserve an aligned array of count elements at the end of the layout
+static size_t reserve(size_t *cursor, size_t count, size_t element_size) {
+    size_t offset = *cursor;
+    *cursor = SHARED_ALIGN(offset + count * element_size);
+    return offset;
+}
+
+// Smallest power of two holding at least count messages; a ring needs
+// two slots to tell a full slot from a free one
+static unsigned int ring_capacity(long long count) {
+    unsigned int capacity = 2;
+    while (capacity < count) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+int shared_layout_compute(SharedLayout *layout, const SimConfig *config) {
+    memset(layout, 0, sizeof(SharedLayout));
+
+    if (config->num_gangs <= 0 || config->max_members_per_gang <= 0 ||
+        config->max_concurrent_missions <= 0 || config->mission_members_count <= 0) {
+        return -1;
+    }
+
+    layout->gang_capacity = config->num_gangs;
+    layout->member_capacity = MEMBER_CAPACITY(config->max_members_per_gang);
+    layout->missions_per_gang = config->max_concurrent_missions;
+    layout->mission_member_capacity = config->mission_members_count;
+    layout->member_bitset_words = BITSET_WORDS(layout->member_capacity);
+
+    // Member slots and agent IDs are plain ints
+    long long member_slots = (long long)layout->gang_capacity * layout->member_capacity;
+    long long agent_capacity = (long long)layout->gang_capacity *
+                               (config->max_agents_per_gang > 0 ? config->max_agents_per_gang : 0);
+    if (member_slots > INT_MAX || agent_capacity > INT_MAX) {
+        return -1;
+    }
+    layout->member_slots = (int)member_slots;
+    layout->agent_capacity = (int)agent_capacity;
+
+    size_t gangs = layout->gang_capacity;
+    size_t missions = gangs * layout->missions_per_gang;
+    size_t slots = layout->member_slots;
+    size_t cursor = SHARED_GANGS_OFFSET;
+
+    layout->gangs_offset = reserve(&cursor, gangs, sizeof(Gang));
+    layout->missions_offset = reserve(&cursor, missions, sizeof(Mission));
+    layout->mission_members_offset = reserve(&cursor, missions * layout->mission_member_capacity, sizeof(int));
+    layout->agent_statuses_offset = reserve(&cursor, layout->agent_capacity, sizeof(AgentStatus));
+    layout->report_mailboxes_offset = reserve(&cursor, layout->agent_capacity, sizeof(ReportMailbox));
+    layout->wake_events_offset = reserve(&cursor, gangs, sizeof(SimEvent));
+    layout->preparation_offset = reserve(&cursor, slots, sizeof(float));
+    layout->knowledge_offset = reserve(&cursor, slots, sizeof(float));
+    layout->rank_offset = reserve(&cursor, slots, sizeof(int));
+    layout->member_status_offset = reserve(&cursor, slots, sizeof(MemberStatus));
+    layout->assigned_mission_offset = reserve(&cursor, slots, sizeof(int));
+    layout->assigned_slot_offset = reserve(&cursor, slots, sizeof(int));
+    layout->agent_id_offset = reserve(&cursor, slots, sizeof(int));
+    layout->release_time_offset = reserve(&cursor, slots, sizeof(time_t));
+    layout->member_rng_offset = reserve(&cursor, slots, sizeof(RngStream));
+    layout->active_bits_offset = reserve(&cursor, gangs * layout->member_bitset_words, sizeof(uint64_t));
+    layout->assigned_bits_offset = reserve(&cursor, gangs * layout->member_bitset_words, sizeof(uint64_t));
+    layout->arrested_bits_offset = reserve(&cursor, gangs * layout->member_bitset_words, sizeof(uint64_t));
+    layout->unprepared_bits_offset = reserve(&cursor, gangs * layout->member_bitset_words, sizeof(uint64_t));
+    layout->metrics_offset = reserve(&cursor, 1, sizeof(MetricsHeader));
+    layout->gang_metrics_offset = reserve(&cursor, gangs, sizeof(GangMetrics));
+    layout->agent_reports_offset = reserve(&cursor, layout->agent_capacity, sizeof(unsigned long));
+    layout->clock_offset = reserve(&cursor, 1, sizeof(SimClockShared) +
+                                   SIM_CLOCK_ACTORS(layout->gang_capacity) * sizeof(SimClockActor));
+
+    // One channel for the reports, one for status and one per gang for
+    // orders; in-process runs on the queue transport use an in-memory queue
+    layout->message_transport = config->message_transport;
+    if (config->message_transport == MESSAGE_TRANSPORT_RINGS ||
+        config->execution_mode == EXECUTION_MODE_PROCESS) {
+        long long reports = (long long)layout->agent_capacity * CHANNEL_REPORTS_PER_AGENT;
+        if (reports < CHANNEL_MIN_REPORTS) {
+            reports = CHANNEL_MIN_REPORTS;
+        } else if (reports > CHANNEL_MAX_REPORTS) {
+            reports = CHANNEL_MAX_REPORTS;
+        }
+        layout->channel_count = CHANNEL_GANG_ORDERS(layout->gang_capacity);
+        layout->report_channel_capacity = ring_capacity(reports);
+        layout->status_channel_capacity = CHANNEL_STATUS_CAPACITY;
+        layout->order_channel_capacity = CHANNEL_ORDER_CAPACITY;
+        layout->channels_offset = reserve(&cursor, layout->channel_count, sizeof(MessageChannel));
+    }
+    if (config->message_transport == MESSAGE_TRANSPORT_RINGS) {
+        layout->order_ring_stride = SHARED_ALIGN(shm_ring_size(layout->order_channel_capacity));
+        layout->report_ring_offset = reserve(&cursor, 1, shm_ring_size(layout->report_channel_capacity));
+        layout->status_ring_offset = reserve(&cursor, 1, shm_ring_size(layout->status_channel_capacity));
+        layout->order_rings_offset = reserve(&cursor, gangs, layout->order_ring_stride);
+    }
+    layout->total_size = cursor;
+
+    return 0;
+}
+
+size_t shared_state_size(const SimConfig *config) {
+    SharedLayout layout;
+    if (shared_layout_compute(&layout, config) != 0) {
+        return 0;
+    }
+    return layout.total_size;
+}
+
+MemberStore gang_members(const Gang *gang) {
+    SharedState *state = gang_shared_state(gang);
+    char *base = (char *)state;
+    size_t first = gang->member_base;
+    MemberStore ms;
+
+    ms.preparation_level = (float *)(base + state->layout.preparation_offset) + first;
+    ms.knowledge_level = (float *)(base + state->layout.knowledge_offset) + first;
+    ms.rank = (int *)(base + state->layout.rank_offset) + first;
+    ms.status = (MemberStatus *)(base + state->layout.member_status_offset) + first;
+    ms.assigned_mission_id = (int *)(base + state->layout.assigned_mission_offset) + first;
+    ms.assigned_mission_slot = (int *)(base + state->layout.assigned_slot_offset) + first;
+    ms.agent_id = (int *)(base + state->layout.agent_id_offset) + first;
+    ms.release_time = (time_t *)(base + state->layout.release_time_offset) + first;
+    ms.rng = (RngStream *)(base + state->layout.member_rng_offset) + first;
+
+    size_t first_word = (size_t)gang->id * state->layout.member_bitset_words;
+    ms.active_bits = (uint64_t *)(base + state->layout.active_bits_offset) + first_word;
+    ms.assigned_bits = (uint64_t *)(base + state->layout.assigned_bits_offset) + first_word;
+    ms.arrested_bits = (uint64_t *)(base + state->layout.arrested_bits_offset) + first_word;
+    ms.unprepared_bits = (uint64_t *)(base + state->layout.unprepared_bits_offset) + first_word;
+    return ms;
+}
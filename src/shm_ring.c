@@ -0,0 +1,74 @@
+#include "../include/shm_ring.h"
+
+size_t shm_ring_size(unsigned int capacity) {
+    return sizeof(ShmRing) + (size_t)capacity * sizeof(RingSlot);
+}
+
+// capacity must be a power of two, at least 2
+void shm_ring_init(ShmRing *ring, unsigned int capacity) {
+    ring->mask = capacity - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    for (unsigned int i = 0; i < capacity; i++) {
+        ring->slots[i].sequence = i;
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// Returns false when the ring is full
+bool shm_ring_push(ShmRing *ring, const IpcMessage *message) {
+    unsigned long position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    RingSlot *slot;
+
+    for (;;) {
+        slot = &ring->slots[position & ring->mask];
+        unsigned long sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        long difference = (long)(sequence - position);
+
+        if (difference == 0) {
+            // The slot is free for this lap; claim it
+            if (__atomic_compare_exchange_n(&ring->head, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // The consumer has not freed the slot from the previous lap
+            return false;
+        } else {
+            position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->message = *message;
+    __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Returns false when the ring is empty
+bool shm_ring_pop(ShmRing *ring, IpcMessage *message) {
+    unsigned long position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    RingSlot *slot;
+
+    for (;;) {
+        slot = &ring->slots[position & ring->mask];
+        unsigned long sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        long difference = (long)(sequence - (position + 1));
+
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(&ring->tail, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // Nothing has been pushed here yet
+            return false;
+        } else {
+            position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    *message = slot->message;
+    // Hand the slot to the producer of the next lap
+    __atomic_store_n(&slot->sequence, position + ring->mask + 1, __ATOMIC_RELEASE);
+    return true;
+}
@@ -0,0 +1,341 @@
+#include "../include/sim_clock.h"
+#include "../include/shared_state.h"
+#include "../include/ipc.h"
+
+#include <limits.h>
+#include <sched.h>
+
+static double g_time_scale = 1.0;
+static bool g_virtual = false;
+static struct timespec g_wall_origin;
+static time_t g_sim_origin = 0;
+static double g_sim_offset = 0.0; /* Simulated seconds carried over from a checkpoint */
+
+/* The virtual clock as this process maps it */
+static SharedState *g_state = NULL;
+static SimClockShared *g_clock = NULL;
+static __thread SimClockActor *t_actor = NULL;
+
+static double wall_seconds_since_origin(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - g_wall_origin.tv_sec) +
+           (double)(now.tv_nsec - g_wall_origin.tv_nsec) / 1e9;
+}
+
+void sim_clock_init(float time_scale) {
+    // A scale of 0 (or less) means run as fast as the actors go
+    g_virtual = time_scale <= 0.0f;
+    g_time_scale = g_virtual ? 0.0 : time_scale;
+    clock_gettime(CLOCK_MONOTONIC, &g_wall_origin);
+    g_sim_origin = time(NULL);
+    g_sim_offset = 0.0;
+    g_state = NULL;
+    g_clock = NULL;
+    t_actor = NULL;
+}
+
+// Carry on the simulated clock of the run a checkpoint was taken from
+void sim_clock_resume(time_t sim_origin, double elapsed_sim) {
+    g_sim_origin = sim_origin;
+    g_sim_offset = elapsed_sim;
+}
+
+time_t sim_clock_origin(void) {
+    return g_sim_origin;
+}
+
+// Simulated seconds per wall second, 0 on the virtual clock
+double sim_clock_scale(void) {
+    return g_time_scale;
+}
+
+bool sim_clock_virtual(void) {
+    return g_virtual;
+}
+
+// Current simulated time in seconds, anchored at the wall time of init
+time_t sim_time(void) {
+    if (g_sim_origin == 0) {
+        return time(NULL);
+    }
+    return g_sim_origin + (time_t)sim_clock_elapsed_sim();
+}
+
+// Current simulated time in milliseconds
+long long sim_time_ms(void) {
+    if (g_sim_origin == 0) {
+        return (long long)time(NULL) * 1000;
+    }
+    // Exact on the virtual clock, so deadlines land on the milliseconds it keeps
+    if (g_virtual && g_clock) {
+        return (long long)g_sim_origin * 1000 + (long long)(g_sim_offset * 1000.0) +
+               __atomic_load_n(&g_clock->now_ms, __ATOMIC_ACQUIRE);
+    }
+    return (long long)g_sim_origin * 1000 + (long long)(sim_clock_elapsed_sim() * 1000.0);
+}
+
+static bool clock_stopped(SimClockShared *clock) {
+    return __atomic_load_n(&clock->stopped, __ATOMIC_SEQ_CST);
+}
+
+// Sleep for the given number of simulated milliseconds
+void sim_sleep_ms(long ms) {
+    if (sim_clock_is_actor()) {
+        SimEvent *event = &t_actor->sleep_event;
+        long long deadline = sim_time_ms() + ms;
+        long long remaining;
+        while ((remaining = deadline - sim_time_ms()) > 0 && !clock_stopped(g_clock)) {
+            sim_clock_wait(event, event_prepare(event), (long)remaining);
+        }
+        return;
+    }
+
+    if (ms <= 0) {
+        sched_yield();
+        return;
+    }
+
+    double wall_us = (double)ms * 1000.0 / (g_virtual ? SIM_CLOCK_FAST_SCALE : g_time_scale);
+    if (wall_us < SIM_CLOCK_MIN_SLEEP_US) {
+        sched_yield();
+        return;
+    }
+
+    usleep((useconds_t)wall_us);
+}
+
+double sim_clock_elapsed_wall(void) {
+    return wall_seconds_since_origin();
+}
+
+double sim_clock_elapsed_sim(void) {
+    if (g_virtual) {
+        SimClockShared *clock = g_clock;
+        return g_sim_offset + (clock ? __atomic_load_n(&clock->now_ms, __ATOMIC_ACQUIRE) / 1000.0 : 0.0);
+    }
+    return g_sim_offset + wall_seconds_since_origin() * g_time_scale;
+}
+
+static SimEvent *actor_event(const SimClockActor *actor) {
+    return (SimEvent *)((char *)g_state + actor->event_offset);
+}
+
+// Once every actor sleeps and none has been woken yet, move the clock to
+// the earliest deadline and wake the actors it is due for; the caller
+// holds the clock lock
+static void advance_if_idle(SimClockShared *clock) {
+    if (clock->waiting < clock->live) {
+        return;
+    }
+
+    long long next = LLONG_MAX;
+    for (int i = 0; i < clock->actor_capacity; i++) {
+        SimClockActor *actor = &clock->actors[i];
+        if (!actor->live || !actor->waiting) {
+            continue;
+        }
+        // Signalled but not up yet: it still counts as running
+        if (__atomic_load_n(&actor_event(actor)->sequence, __ATOMIC_ACQUIRE) != actor->seen) {
+            return;
+        }
+        if (actor->deadline_ms < next) {
+            next = actor->deadline_ms;
+        }
+    }
+    if (next == LLONG_MAX) {
+        return;
+    }
+
+    if (next > clock->now_ms) {
+        __atomic_store_n(&clock->now_ms, next, __ATOMIC_RELEASE);
+    }
+    for (int i = 0; i < clock->actor_capacity; i++) {
+        SimClockActor *actor = &clock->actors[i];
+        if (actor->live && actor->waiting && actor->deadline_ms <= clock->now_ms) {
+            event_signal(actor_event(actor));
+        }
+    }
+}
+
+int sim_clock_setup(SharedState *state) {
+    if (!g_virtual) {
+        return 0;
+    }
+
+    SimClockShared *clock = shared_clock(state);
+    int capacity = SIM_CLOCK_ACTORS(state->layout.gang_capacity);
+    memset(clock, 0, sizeof(SimClockShared) + (size_t)capacity * sizeof(SimClockActor));
+    if (init_shared_mutex(&clock->lock) != 0) {
+        return -1;
+    }
+    clock->actor_capacity = capacity;
+    // Held until sim_clock_start, so early actors cannot run time ahead
+    clock->live = 1;
+
+    sim_clock_attach(state);
+    return 0;
+}
+
+void sim_clock_attach(SharedState *state) {
+    if (!g_virtual) {
+        return;
+    }
+    // Keep the time reached for whoever asks after the segment is gone
+    if (!state && g_clock) {
+        g_sim_offset = sim_clock_elapsed_sim();
+    }
+    g_state = state;
+    g_clock = state ? shared_clock(state) : NULL;
+    t_actor = NULL;
+}
+
+// Count actors about to start (or, negative, that never will)
+void sim_clock_expect(int actors) {
+    SimClockShared *clock = g_clock;
+    if (!clock) {
+        return;
+    }
+    pthread_mutex_lock(&clock->lock);
+    clock->live += actors;
+    advance_if_idle(clock);
+    pthread_mutex_unlock(&clock->lock);
+}
+
+void sim_clock_start(void) {
+    sim_clock_expect(-1);
+}
+
+// An actor process has exited; drop it if it did not leave on its own
+void sim_clock_reap(pid_t pid) {
+    SimClockShared *clock = g_clock;
+    bool joined = false;
+    if (!clock) {
+        return;
+    }
+
+    pthread_mutex_lock(&clock->lock);
+    for (int i = 0; i < clock->actor_capacity; i++) {
+        SimClockActor *actor = &clock->actors[i];
+        if (actor->pid != pid) {
+            continue;
+        }
+        joined = true;
+        if (actor->live) {
+            clock->waiting -= actor->waiting;
+            actor->waiting = false;
+            actor->live = false;
+            clock->live--;
+        }
+    }
+    // Expected, but it died before joining
+    if (!joined) {
+        clock->live--;
+    }
+    advance_if_idle(clock);
+    pthread_mutex_unlock(&clock->lock);
+}
+
+// End of the run: wake every actor asleep on the clock for good, since
+// the actors that would have moved it on may be gone already (a parent
+// killed by a signal never reaps its children); takes no lock, so the
+// signal handlers can call it
+void sim_clock_stop(void) {
+    SimClockShared *clock = g_clock;
+    if (!clock) {
+        return;
+    }
+
+    __atomic_store_n(&clock->stopped, true, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < clock->actor_capacity; i++) {
+        SimClockActor *actor = &clock->actors[i];
+        if (__atomic_load_n(&actor->waiting, __ATOMIC_SEQ_CST)) {
+            event_signal(actor_event(actor));
+        }
+    }
+}
+
+// Take a slot for the calling thread; sim_clock_expect counted it already
+void sim_clock_join(void) {
+    SimClockShared *clock = g_clock;
+    if (!clock) {
+        return;
+    }
+
+    pthread_mutex_lock(&clock->lock);
+    for (int i = 0; i < clock->actor_capacity; i++) {
+        SimClockActor *actor = &clock->actors[i];
+        if (actor->pid == 0) {
+            actor->pid = getpid();
+            actor->live = true;
+            t_actor = actor;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&clock->lock);
+
+    if (!t_actor) {
+        log_error("No room for another actor on the virtual clock");
+    }
+}
+
+void sim_clock_leave(void) {
+    SimClockShared *clock = g_clock;
+    if (!clock || !t_actor) {
+        return;
+    }
+
+    pthread_mutex_lock(&clock->lock);
+    t_actor->live = false;
+    clock->live--;
+    advance_if_idle(clock);
+    pthread_mutex_unlock(&clock->lock);
+    t_actor = NULL;
+}
+
+// Whether the caller's waits go through the virtual clock
+bool sim_clock_is_actor(void) {
+    return t_actor != NULL && !clock_stopped(g_clock);
+}
+
+// Sleep on an event in the segment until it is signalled or the virtual
+// clock reaches timeout_ms simulated milliseconds from now (never when
+// negative); returns true if it was signalled
+bool sim_clock_wait(SimEvent *event, unsigned int seen, long timeout_ms) {
+    SimClockShared *clock = g_clock;
+    SimClockActor *actor = t_actor;
+
+    if (__atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE) != seen) {
+        return true;
+    }
+    if (timeout_ms == 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&clock->lock);
+    actor->event_offset = (size_t)((char *)event - (char *)g_state);
+    actor->seen = seen;
+    actor->deadline_ms = timeout_ms < 0 ? LLONG_MAX : clock->now_ms + timeout_ms;
+    __atomic_store_n(&actor->waiting, true, __ATOMIC_SEQ_CST);
+    clock->waiting++;
+    advance_if_idle(clock);
+    pthread_mutex_unlock(&clock->lock);
+
+    // Only a signal or the clock reaching the deadline ends the wait, until
+    // the clock stops; sim_clock_stop sees us waiting or we see it stopped
+    bool signalled;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (clock_stopped(clock)) {
+        signalled = __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE) != seen;
+    } else {
+        signalled = event_wait_wall(event, seen, NULL);
+    }
+
+    pthread_mutex_lock(&clock->lock);
+    if (actor->waiting) {
+        actor->waiting = false;
+        clock->waiting--;
+    }
+    pthread_mutex_unlock(&clock->lock);
+    return signalled;
+}
@@ -1,12 +1,21 @@
 #include "../include/simulation.h"
 #include "../include/ipc.h"
+#ifndef HEADLESS_BUILD
 #include "../include/visualization.h"
+#endif
 #include "../include/utils.h"
 #include "../include/config.h"
 #include "../include/gang.h"
 #include "../include/police.h"
+#include "../include/sim_clock.h"
+#include "../include/shard.h"
+#include "../include/local_queue.h"
+#include "../include/shared_state.h"
+#include "../include/trace.h"
+#include "../include/checkpoint.h"
 
 #include <signal.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
 #include <errno.h>
 
@@ -16,144 +25,114 @@ static int g_msg_queue_id = -1;
 static pid_t *g_gang_pids = NULL;
 static pid_t g_police_pid = -1;
 static int g_gang_count = 0;
+static size_t g_shared_state_size = 0;
 static pthread_t g_viz_thread = 0;
 static pthread_t g_monitor_thread = 0;
 static volatile sig_atomic_t g_shutdown_flag = 0;
+static volatile sig_atomic_t g_interrupted = 0;
+static SharedState *volatile g_running_state = NULL;
+
+/* Longest the monitor thread sleeps without a status change (simulated ms) */
+#define MONITOR_IDLE_MS 1000
 
 
 int simulation_init(SimConfig *config, const char *config_file) {
     if (!config || !config_file) {
-        log_message("Invalid parameters for simulation initialization");
+        log_error("Invalid parameters for simulation initialization");
         return -1;
     }
     
     // Load configuration from file
     if (load_config(config_file, config) != 0) {
-        log_message("Failed to load configuration from %s", config_file);
+        log_error("Failed to load configuration from %s", config_file);
         return -1;
     }
     
     // Validate configuration
     if (!validate_config(config)) {
-        log_message("Invalid configuration parameters");
+        log_error("Invalid configuration parameters");
         return -1;
     }
     
     // Initialize random number generator
-    init_random();
+    init_random(config->seed);
     
     log_message("Simulation initialized with %d gangs", config->num_gangs);
     return 0;
 }
 
 int run_simulation(SimConfig *config, int argc, char **argv) {
-    int shared_state_id, msg_queue_id;
-    SharedState *shared_state;
-    int status;
+    SimulationSummary summary;
     
-    log_message("Starting secret agent simulation");
-    
-    // Create IPC resources
-    if (create_ipc_resources(&shared_state_id, &msg_queue_id, config) != 0) {
-        log_message("Failed to create IPC resources");
-        return -1;
-    }
-    
-    // Save global references for signal handler
-    g_shared_state_id = shared_state_id;
-    g_msg_queue_id = msg_queue_id;
+    int result = run_simulation_with_summary(config, argc, argv, &summary);
     
-    // Attach to shared memory
-    shared_state = (SharedState *)attach_shared_memory(shared_state_id);
-    if (!shared_state) {
-        log_message("Failed to attach to shared memory");
-        cleanup_ipc_resources(shared_state_id, msg_queue_id);
-        return -1;
+    if (result == 0 && config->headless) {
+        if (save_simulation_summary(&summary, config->summary_file) != 0) {
+            log_error("Failed to write simulation summary to %s", config->summary_file);
+        }
     }
-    
-    // Initialize shared state
-    if (init_shared_state(shared_state) != 0) {
-        log_message("Failed to initialize shared state");
-        detach_shared_memory(shared_state);
-        cleanup_ipc_resources(shared_state_id, msg_queue_id);
-        return -1;
+    if (result == 0) {
+        free_simulation_summary(&summary);
     }
     
-    // Set initial simulation status
-    shared_state->status = SIM_STATUS_RUNNING;
-    shared_state->gang_count = config->num_gangs;
-    shared_state->agent_execution_loss_count = config->agent_execution_loss_count;
-    // Create visualization thread
-    VisualizationThreadArgs *viz_args = malloc(sizeof(VisualizationThreadArgs));
-    if (!viz_args) {
-        log_message("Failed to allocate memory for visualization thread arguments");
-        detach_shared_memory(shared_state);
-        cleanup_ipc_resources(shared_state_id, msg_queue_id);
-        return -1;
+    return result;
+}
+
+// The shared state lives in a System V segment, or in private memory in-process
+static SharedState *map_shared_state(int shared_state_id) {
+    if (shared_state_id != -1) {
+        return (SharedState *)attach_shared_memory(shared_state_id);
     }
     
-    viz_args->shared_state = shared_state;
-    viz_args->config = config;
-    viz_args->argc = argc;
-    viz_args->argv = argv;
-    
-    if (pthread_create(&g_viz_thread, NULL, visualization_thread, viz_args) != 0) {
-        log_message("Failed to create visualization thread");
-        free(viz_args);
-        detach_shared_memory(shared_state);
-        cleanup_ipc_resources(shared_state_id, msg_queue_id);
-        return -1;
+    void *ptr = mmap(NULL, g_shared_state_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
     }
-    
-    // Create monitor thread
-    if (pthread_create(&g_monitor_thread, NULL, simulation_monitor_thread, shared_state) != 0) {
-        log_message("Failed to create monitor thread");
-        // Cancel visualization thread
-        pthread_cancel(g_viz_thread);
-        pthread_join(g_viz_thread, NULL);
-        free(viz_args);
+    return (SharedState *)ptr;
+}
+
+static void unmap_shared_state(SharedState *shared_state, int shared_state_id) {
+    ipc_attach_state(NULL);
+    sim_clock_attach(NULL);
+    if (shared_state_id != -1) {
         detach_shared_memory(shared_state);
-        cleanup_ipc_resources(shared_state_id, msg_queue_id);
-        return -1;
+    } else {
+        munmap(shared_state, g_shared_state_size);
     }
+}
+
+// Fork one process per gang plus the police and wait for them to finish
+static int run_process_simulation(SharedState *shared_state, SimConfig *config, int msg_queue_id,
+                                  int shared_state_id) {
+    int status;
     
     // Spawn gang processes
     g_gang_count = spawn_gang_processes(shared_state, config, msg_queue_id, shared_state_id);
     if (g_gang_count <= 0) {
-        log_message("Failed to spawn gang processes");
-        pthread_cancel(g_viz_thread);
-        pthread_cancel(g_monitor_thread);
-        pthread_join(g_viz_thread, NULL);
-        pthread_join(g_monitor_thread, NULL);
-        free(viz_args);
-        detach_shared_memory(shared_state);
-        cleanup_ipc_resources(shared_state_id, msg_queue_id);
+        log_error("Failed to spawn gang processes");
         return -1;
     }
     
     // Spawn police process
     g_police_pid = spawn_police_process(config, msg_queue_id, shared_state_id);
     if (g_police_pid <= 0) {
-        log_message("Failed to spawn police process");
+        log_error("Failed to spawn police process");
+        sim_clock_start();
         // Kill gang processes
         for (int i = 0; i < g_gang_count; i++) {
             if (g_gang_pids[i] > 0) {
                 kill(g_gang_pids[i], SIGTERM);
             }
         }
-        pthread_cancel(g_viz_thread);
-        pthread_cancel(g_monitor_thread);
-        pthread_join(g_viz_thread, NULL);
-        pthread_join(g_monitor_thread, NULL);
-        free(viz_args);
         free(g_gang_pids);
         g_gang_pids = NULL;
-        detach_shared_memory(shared_state);
-        cleanup_ipc_resources(shared_state_id, msg_queue_id);
         return -1;
     }
     
     log_message("Simulation started with %d gangs and police process", g_gang_count);
+    sim_clock_start();
     
     // Wait for all child processes to finish
     while (!g_shutdown_flag) {
@@ -170,6 +149,7 @@ int run_simulation(SimConfig *config, int argc, char **argv) {
                 break;
             }
         }
+        sim_clock_reap(terminated_pid);
         
         if (terminated_pid == g_police_pid) {
             log_message("Police process terminated with status %d", status);
@@ -199,14 +179,165 @@ int run_simulation(SimConfig *config, int argc, char **argv) {
         }
     }
     
-    // Wait for visualization thread to finish
-    pthread_join(g_viz_thread, NULL);
+    // Make sure gangs still running see the end of the simulation
+    end_simulation(shared_state, SIM_STATUS_SHUTDOWN);
+    
+    // Reap the gang processes so their final counters are in shared memory
+    for (int i = 0; i < g_gang_count; i++) {
+        if (g_gang_pids[i] > 0) {
+            waitpid(g_gang_pids[i], NULL, 0);
+            g_gang_pids[i] = -1;
+        }
+    }
+    
+    return 0;
+}
+
+static int run_actors(SimConfig *config, int argc, char **argv, SimulationSummary *summary) {
+    int shared_state_id, msg_queue_id;
+    SharedState *shared_state;
+    
+    log_message("Starting secret agent simulation");
+    
+    // Create IPC resources
+    if (create_ipc_resources(&shared_state_id, &msg_queue_id, config) != 0) {
+        log_error("Failed to create IPC resources");
+        return -1;
+    }
+    
+    // Save global references for signal handler
+    g_shared_state_id = shared_state_id;
+    g_msg_queue_id = msg_queue_id;
+    
+    // Attach to shared memory
+    shared_state = map_shared_state(shared_state_id);
+    if (!shared_state) {
+        log_error("Failed to attach to shared memory");
+        cleanup_ipc_resources(shared_state_id, msg_queue_id);
+        return -1;
+    }
+    g_running_state = shared_state;
+    
+    // Initialize shared state
+    if (init_shared_state(shared_state, config) != 0) {
+        log_error("Failed to initialize shared state");
+        g_running_state = NULL;
+        unmap_shared_state(shared_state, shared_state_id);
+        cleanup_ipc_resources(shared_state_id, msg_queue_id);
+        return -1;
+    }
+    
+    // Set initial simulation status
+    shared_state->status = SIM_STATUS_RUNNING;
+    shared_state->gang_count = config->num_gangs;
+    shared_state->agent_execution_loss_count = config->agent_execution_loss_count;
+    if (checkpoint_restoring()) {
+        checkpoint_restore_state(shared_state);
+    }
+    
+    // After the restore, which brings back the segment as it was
+    if (sim_clock_setup(shared_state) != 0) {
+        log_error("Failed to set up the simulated clock");
+        g_running_state = NULL;
+        unmap_shared_state(shared_state, shared_state_id);
+        cleanup_ipc_resources(shared_state_id, msg_queue_id);
+        return -1;
+    }
+    
+    // Create visualization thread unless running headless
+    VisualizationThreadArgs *viz_args = NULL;
+    if (!config->headless) {
+        viz_args = malloc(sizeof(VisualizationThreadArgs));
+        if (!viz_args) {
+            log_error("Failed to allocate memory for visualization thread arguments");
+            g_running_state = NULL;
+        unmap_shared_state(shared_state, shared_state_id);
+            cleanup_ipc_resources(shared_state_id, msg_queue_id);
+            return -1;
+        }
+        
+        viz_args->shared_state = shared_state;
+        viz_args->config = config;
+        viz_args->argc = argc;
+        viz_args->argv = argv;
+        
+        if (pthread_create(&g_viz_thread, NULL, visualization_thread, viz_args) != 0) {
+            log_error("Failed to create visualization thread");
+            free(viz_args);
+            g_running_state = NULL;
+        unmap_shared_state(shared_state, shared_state_id);
+            cleanup_ipc_resources(shared_state_id, msg_queue_id);
+            return -1;
+        }
+    }
+    
+    // Create monitor thread
+    sim_clock_expect(1);
+    if (pthread_create(&g_monitor_thread, NULL, simulation_monitor_thread, shared_state) != 0) {
+        log_error("Failed to create monitor thread");
+        sim_clock_expect(-1);
+        // Cancel visualization thread
+        if (g_viz_thread) {
+            pthread_cancel(g_viz_thread);
+            pthread_join(g_viz_thread, NULL);
+        }
+        free(viz_args);
+        g_running_state = NULL;
+        unmap_shared_state(shared_state, shared_state_id);
+        cleanup_ipc_resources(shared_state_id, msg_queue_id);
+        return -1;
+    }
+    
+    // Run the gangs and the police until the simulation ends
+    int result;
+    if (config->execution_mode == EXECUTION_MODE_INPROCESS) {
+        result = run_inprocess_simulation(shared_state, config, msg_queue_id);
+        g_shutdown_flag = 1;
+    } else {
+        result = run_process_simulation(shared_state, config, msg_queue_id, shared_state_id);
+    }
+    
+    if (result != 0) {
+        if (g_viz_thread) {
+            pthread_cancel(g_viz_thread);
+            pthread_join(g_viz_thread, NULL);
+        }
+        pthread_cancel(g_monitor_thread);
+        pthread_join(g_monitor_thread, NULL);
+        free(viz_args);
+        g_running_state = NULL;
+        unmap_shared_state(shared_state, shared_state_id);
+        cleanup_ipc_resources(shared_state_id, msg_queue_id);
+        return -1;
+    }
+    
+    // Wait for visualization thread to finish; after an interrupt nobody
+    // is left to close the window, whose main loop never returns
+#ifndef HEADLESS_BUILD
+    if (g_viz_thread && g_interrupted) {
+        shutdown_visualization();
+        pthread_cancel(g_viz_thread);
+    }
+#endif
+    if (g_viz_thread) {
+        pthread_join(g_viz_thread, NULL);
+    }
     pthread_join(g_monitor_thread, NULL);
     free(viz_args);
     
     // Cleanup
-    log_message("Simulation ended");
-    detach_shared_memory(shared_state);
+    log_message("Simulation ended after %.0f simulated seconds in %.3f wall seconds (%.1fx)",
+               sim_clock_elapsed_sim(), sim_clock_elapsed_wall(),
+               sim_clock_elapsed_sim() / sim_clock_elapsed_wall());
+    
+    log_channel_stats(shared_state);
+    trace_event(TRACE_SIMULATION_END, -1, -1, get_simulation_status(shared_state), 0, 0.0f);
+    if (summary) {
+        collect_simulation_summary(shared_state, summary);
+    }
+    
+    g_running_state = NULL;
+    unmap_shared_state(shared_state, shared_state_id);
     cleanup_ipc_resources(shared_state_id, msg_queue_id);
     free(g_gang_pids);
     g_gang_pids = NULL;
@@ -214,24 +345,66 @@ int run_simulation(SimConfig *config, int argc, char **argv) {
     return 0;
 }
 
+int run_simulation_with_summary(SimConfig *config, int argc, char **argv, SimulationSummary *summary) {
+    // Restoring moves the clock to the checkpoint, so it goes before anything reads it
+    if (config->restore_file[0] != '\0' && checkpoint_load(config->restore_file, config) != 0) {
+        checkpoint_unload();
+        return -1;
+    }
+    
+    // The trace and the checkpoint are mapped before any actor is forked, so they all share them
+    if (config->trace_file[0] != '\0' && trace_open(config->trace_file, config) != 0) {
+        checkpoint_unload();
+        return -1;
+    }
+    if (config->checkpoint_file[0] != '\0' && checkpoint_open(config->checkpoint_file, config) != 0) {
+        trace_close();
+        checkpoint_unload();
+        return -1;
+    }
+    
+    int result = run_actors(config, argc, argv, summary);
+    checkpoint_close();
+    trace_close();
+    checkpoint_unload();
+    return result;
+}
+
 int create_ipc_resources(int *shared_state_id, int *msg_queue_id, SimConfig *config) {
-    size_t shared_mem_size = sizeof(SharedState);
+    // Every array in the segment is sized from the configuration
+    size_t shared_mem_size = shared_state_size(config);
+    if (shared_mem_size == 0) {
+        log_message("Configuration too large for the shared state (%d gangs of %d members)",
+                    config->num_gangs, config->max_members_per_gang);
+        return -1;
+    }
+    g_shared_state_size = shared_mem_size;
+    
+    // In-process runs keep the state in private memory and use an in-memory queue
+    if (config->execution_mode == EXECUTION_MODE_INPROCESS) {
+        *shared_state_id = -1;
+        if (config->message_transport == MESSAGE_TRANSPORT_RINGS) {
+            *msg_queue_id = MESSAGE_CHANNELS_ID;
+            return 0;
+        }
+        *msg_queue_id = init_local_message_queue();
+        if (*msg_queue_id == -1) {
+            log_error("Failed to create in-memory message queue");
+            return -1;
+        }
+        return 0;
+    }
     
     // Create shared memory segment
     *shared_state_id = create_shared_memory(shared_mem_size);
     if (*shared_state_id == -1) {
-        log_message("Failed to create shared memory segment");
-        return -1;
-    }
-    
-    // Create message queue
-    *msg_queue_id = init_message_queue();
-    if (*msg_queue_id == -1) {
-        log_message("Failed to create message queue");
-        remove_shared_memory(*shared_state_id);
+        log_error("Failed to create shared memory segment");
         return -1;
     }
     
+    // Every gang and the police get channels of their own, described in the
+    // segment; init_shared_state() opens them
+    *msg_queue_id = MESSAGE_CHANNELS_ID;
     return 0;
 }
 
@@ -241,7 +414,7 @@ int spawn_gang_processes(SharedState *shared_state, SimConfig *config, int msg_q
     // Allocate array to store gang process IDs
     g_gang_pids = (pid_t *)malloc(gang_count * sizeof(pid_t));
     if (!g_gang_pids) {
-        log_message("Failed to allocate memory for gang PIDs");
+        log_error("Failed to allocate memory for gang PIDs");
         return -1;
     }
     
@@ -252,16 +425,32 @@ int spawn_gang_processes(SharedState *shared_state, SimConfig *config, int msg_q
     
     // Create gang processes
     for (int i = 0; i < gang_count; i++) {
-        // Determine number of members for this gang
-        int member_count = rand_range(config->min_members_per_gang, config->max_members_per_gang);
-        
-        // Initialize gang structure in shared memory
-        gang_init(&shared_state->gangs[i], i, member_count, config);
+        // Initialize gang structure in shared memory; a restored gang brings its members
+        int member_count;
+        if (checkpoint_restoring()) {
+            member_count = checkpoint_restore_gang(shared_state, i);
+        } else {
+            member_count = rand_range(config->min_members_per_gang, config->max_members_per_gang);
+            if (gang_init(shared_gang(shared_state, i), i, member_count, config) != 0) {
+                member_count = -1;
+            }
+        }
+        if (member_count < 0) {
+            log_error("Failed to initialize gang %d", i);
+            for (int j = 0; j < i; j++) {
+                if (g_gang_pids[j] > 0) {
+                    kill(g_gang_pids[j], SIGTERM);
+                }
+            }
+            return -1;
+        }
         
         // Fork gang process
+        sim_clock_expect(1);
         pid_t pid = fork();
         if (pid < 0) {
-            log_message("Failed to fork gang process %d", i);
+            log_error("Failed to fork gang process %d", i);
+            sim_clock_expect(-1);
             // Kill already created gang processes
             for (int j = 0; j < i; j++) {
                 if (g_gang_pids[j] > 0) {
@@ -285,10 +474,12 @@ int spawn_gang_processes(SharedState *shared_state, SimConfig *config, int msg_q
 }
 
 pid_t spawn_police_process(SimConfig *config, int msg_queue_id, int shared_state_id) {
+    sim_clock_expect(1);
     pid_t pid = fork();
     
     if (pid < 0) {
-        log_message("Failed to fork police process");
+        log_error("Failed to fork police process");
+        sim_clock_expect(-1);
         return -1;
     } else if (pid == 0) {
         // Child process - police
@@ -302,6 +493,11 @@ pid_t spawn_police_process(SimConfig *config, int msg_queue_id, int shared_state
 }
 
 void *visualization_thread(void *args) {
+#ifdef HEADLESS_BUILD
+    (void)args;
+    log_message("Visualization is not available in the headless build");
+    return NULL;
+#else
     VisualizationThreadArgs *viz_args = (VisualizationThreadArgs *)args;
     
     // Set cancellation state
@@ -310,7 +506,7 @@ void *visualization_thread(void *args) {
     
     // Initialize visualization
     if (init_visualization(viz_args->argc, viz_args->argv, viz_args->shared_state, viz_args->config) != 0) {
-        log_message("Failed to initialize visualization");
+        log_error("Failed to initialize visualization");
         return NULL;
     }
     
@@ -318,34 +514,48 @@ void *visualization_thread(void *args) {
     glutMainLoop();
     
     return NULL;
+#endif
 }
 
 void *simulation_monitor_thread(void *args) {
     SharedState *shared_state = (SharedState *)args;
     SimulationStatus prev_status = SIM_STATUS_RUNNING;
     
+    sim_clock_join();
     while (!g_shutdown_flag) {
-        // Lock mutex to read shared state
-        pthread_mutex_lock(&shared_state->status_mutex);
+        // The status is a single word; reading it never holds up the actors
+        unsigned int seen = event_prepare(&shared_state->status_event);
+        
+        // A signal asked us to stop: end the run here, outside the handler,
+        // so the actors wind down and run_actors removes the IPC resources
+        if (g_interrupted) {
+            end_simulation(shared_state, SIM_STATUS_SHUTDOWN);
+        }
+        SimulationStatus status = get_simulation_status(shared_state);
         
         // Check if simulation status has changed
-        if (shared_state->status != prev_status) {
+        if (status != prev_status) {
             log_message("Simulation status changed to: %s", 
-                       simulation_status_to_string(shared_state->status));
-            prev_status = shared_state->status;
+                       simulation_status_to_string(status));
+            prev_status = status;
             
             // If simulation ended, initiate shutdown
-            if (shared_state->status != SIM_STATUS_RUNNING) {
+            if (status != SIM_STATUS_RUNNING) {
                 g_shutdown_flag = 1;
             }
         }
         
-        pthread_mutex_unlock(&shared_state->status_mutex);
-        
-        // Sleep briefly
-        usleep(500000); // 500ms
+        // Sleep until the status changes; the timeout only bounds how long
+        // a shutdown requested through g_shutdown_flag goes unnoticed, or
+        // how long a checkpoint waits to be taken or finished
+        if (!g_shutdown_flag) {
+            event_wait_ms(&shared_state->status_event, seen, checkpoint_poll(shared_state, MONITOR_IDLE_MS));
+            pthread_testcancel();
+        }
     }
     
+    sim_clock_leave();
+    
     // Initiate shutdown if not already done
     if (!g_shutdown_flag) {
         shutdown_simulation(g_shared_state_id, g_msg_queue_id);
@@ -354,25 +564,37 @@ void *simulation_monitor_thread(void *args) {
     return NULL;
 }
 
+// Called from signal handlers, so it only raises a flag and wakes the
+// monitor thread, which ends the run from normal context
+void simulation_interrupt(void) {
+    g_interrupted = 1;
+    
+    SharedState *shared_state = g_running_state;
+    if (shared_state) {
+        event_signal(&shared_state->status_event);
+    }
+}
+
 void shutdown_simulation(int shared_state_id, int msg_queue_id) {
     log_message("Shutting down simulation...");
     g_shutdown_flag = 1;
     
     // First, request visualization shutdown before accessing shared memory
     // This prevents X11 errors when terminating
+#ifndef HEADLESS_BUILD
     if (g_viz_thread) {
         shutdown_visualization();
     }
+#endif
     
     // Attach to shared memory to get process IDs
-    SharedState *shared_state = (SharedState *)attach_shared_memory(shared_state_id);
+    SharedState *shared_state = shared_state_id != -1 ?
+        (SharedState *)attach_shared_memory(shared_state_id) : NULL;
     if (!shared_state) {
-        log_message("Error: Cannot attach to shared memory during shutdown");
+        log_error("Error: Cannot attach to shared memory during shutdown");
     } else {
         // Update simulation status to terminate
-        pthread_mutex_lock(&shared_state->status_mutex);
-        shared_state->status = SIM_STATUS_SHUTDOWN;
-        pthread_mutex_unlock(&shared_state->status_mutex);
+        set_simulation_status(shared_state, SIM_STATUS_SHUTDOWN);
         
         // Send shutdown message to all processes
         IpcMessage msg;
@@ -380,7 +602,7 @@ void shutdown_simulation(int shared_state_id, int msg_queue_id) {
         msg.data.status = SIM_STATUS_SHUTDOWN;
         
         if (send_message(msg_queue_id, &msg) != 0) {
-            log_message("Failed to send shutdown message");
+            log_error("Failed to send shutdown message");
         }
         
         // Detach from shared memory after use
@@ -447,14 +669,108 @@ void shutdown_simulation(int shared_state_id, int msg_queue_id) {
     cleanup_ipc_resources(shared_state_id, msg_queue_id);
 }
 
+void collect_simulation_summary(SharedState *shared_state, SimulationSummary *summary) {
+    memset(summary, 0, sizeof(SimulationSummary));
+    
+    // The actors are stopped by now; the loads only order us after their updates
+    summary->status = get_simulation_status(shared_state);
+    summary->total_thwarted_plans = __atomic_load_n(&shared_state->total_thwarted_plans, __ATOMIC_ACQUIRE);
+    summary->total_successful_plans = __atomic_load_n(&shared_state->total_successful_plans, __ATOMIC_ACQUIRE);
+    summary->total_executed_agents = __atomic_load_n(&shared_state->total_executed_agents, __ATOMIC_ACQUIRE);
+    summary->reports_delivered = __atomic_load_n(&shared_state->reports_delivered, __ATOMIC_ACQUIRE);
+    summary->reports_coalesced = __atomic_load_n(&shared_state->reports_coalesced, __ATOMIC_ACQUIRE);
+    summary->reports_dropped = __atomic_load_n(&shared_state->reports_dropped, __ATOMIC_ACQUIRE);
+    summary->agent_count = __atomic_load_n(&shared_state->agent_count, __ATOMIC_ACQUIRE);
+    summary->gang_count = shared_state->gang_count;
+    
+    summary->gangs = calloc(summary->gang_count, sizeof(GangOutcome));
+    if (!summary->gangs) {
+        summary->gang_count = 0;
+    }
+    
+    // Per-gang results come from the snapshots each gang published
+    for (int i = 0; i < summary->gang_count; i++) {
+        GangSnapshot snapshot;
+        read_gang_status(shared_state, i, &snapshot);
+        summary->gangs[i].member_count = snapshot.member_count;
+        summary->gangs[i].successful_missions = snapshot.successful_missions;
+        summary->gangs[i].failed_missions = snapshot.failed_missions;
+    }
+    for (int i = 0; i < shared_state->gang_count; i++) {
+        gang_metrics_accumulate(&summary->gang_metrics, shared_gang_metrics(shared_state, i));
+    }
+    summary->police_metrics = shared_metrics(shared_state)->police;
+    
+    summary->sim_seconds = sim_clock_elapsed_sim();
+    summary->wall_seconds = sim_clock_elapsed_wall();
+}
+
+void free_simulation_summary(SimulationSummary *summary) {
+    free(summary->gangs);
+    summary->gangs = NULL;
+    summary->gang_count = 0;
+}
+
+void write_simulation_summary(FILE *out, const SimulationSummary *summary) {
+    fprintf(out, "status=%s\n", simulation_status_to_string(summary->status));
+    fprintf(out, "total_thwarted_plans=%d\n", summary->total_thwarted_plans);
+    fprintf(out, "total_successful_plans=%d\n", summary->total_successful_plans);
+    fprintf(out, "total_executed_agents=%d\n", summary->total_executed_agents);
+    fprintf(out, "agent_count=%d\n", summary->agent_count);
+    fprintf(out, "reports_delivered=%lu\n", summary->reports_delivered);
+    fprintf(out, "reports_coalesced=%lu\n", summary->reports_coalesced);
+    fprintf(out, "reports_dropped=%lu\n", summary->reports_dropped);
+    fprintf(out, "sim_seconds=%.1f\n", summary->sim_seconds);
+    fprintf(out, "wall_seconds=%.3f\n", summary->wall_seconds);
+    fprintf(out, "gang_count=%d\n", summary->gang_count);
+    
+    for (int i = 0; i < summary->gang_count && summary->gangs; i++) {
+        fprintf(out, "gang.%d.members=%d\n", i, summary->gangs[i].member_count);
+        fprintf(out, "gang.%d.successful_missions=%d\n", i, summary->gangs[i].successful_missions);
+        fprintf(out, "gang.%d.failed_missions=%d\n", i, summary->gangs[i].failed_missions);
+    }
+}
+
+int save_simulation_summary(const SimulationSummary *summary, const char *path) {
+    // No path means stdout
+    if (!path || path[0] == '\0') {
+        logger_flush();
+        write_simulation_summary(stdout, summary);
+        fflush(stdout);
+        return 0;
+    }
+    
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror("Failed to open summary file");
+        return -1;
+    }
+    
+    write_simulation_summary(out, summary);
+    fclose(out);
+    return 0;
+}
+
 // Improve the cleanup_ipc_resources function:
 void cleanup_ipc_resources(int shared_state_id, int msg_queue_id) {
     // Remove message queue
-    if (msg_queue_id != -1) {
+    if (msg_queue_id == MESSAGE_CHANNELS_ID) {
+        // Channel queues are listed in the segment, so find them before it goes
+        SharedState *state = shared_state_id != -1 ?
+            (SharedState *)attach_shared_memory(shared_state_id) : NULL;
+        if (state) {
+            remove_message_channels(state);
+            detach_shared_memory(state);
+        }
+    } else if (local_queue_is_local(msg_queue_id)) {
+        if (remove_message_queue(msg_queue_id) == 0) {
+            log_message("Message queue removed");
+        }
+    } else if (msg_queue_id != -1) {
         struct msqid_ds queue_info;
         if (msgctl(msg_queue_id, IPC_STAT, &queue_info) == 0) {
             if (msgctl(msg_queue_id, IPC_RMID, NULL) != 0) {
-                log_message("Failed to remove message queue: %s", strerror(errno));
+                log_error("Failed to remove message queue: %s", strerror(errno));
             } else {
                 log_message("Message queue removed");
             }
@@ -466,17 +782,10 @@ void cleanup_ipc_resources(int shared_state_id, int msg_queue_id) {
         struct shmid_ds shm_info;
         if (shmctl(shared_state_id, IPC_STAT, &shm_info) == 0) {
             if (remove_shared_memory(shared_state_id) != 0) {
-                log_message("Failed to remove shared memory: %s", strerror(errno));
+                log_error("Failed to remove shared memory: %s", strerror(errno));
             } else {
                 log_message("Shared memory removed");
             }
         }
     }
-    
-    // Cleanup semaphores that might have been left open
-    for (int i = 0; i < MAX_GANGS; i++) {
-        char sem_name[32];
-        snprintf(sem_name, sizeof(sem_name), "/gang_sem_%d", i);
-        sem_unlink(sem_name);
-    }
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "../include/social_graph.h"
+#include "../include/shared_state.h"
+#include "../include/bitset.h"
+
+#include <limits.h>
+
+int social_graph_init(SocialGraph *graph, int member_capacity, int mission_capacity,
+                      int mission_member_capacity) {
+    memset(graph, 0, sizeof(SocialGraph));
+
+    // A peer and a superior link per member, plus a clique per mission
+    long long pairs = 2LL * member_capacity +
+                      (long long)mission_capacity * mission_member_capacity * (mission_member_capacity - 1) / 2;
+    if (2 * pairs > INT_MAX) {
+        return -1;
+    }
+
+    graph->member_capacity = member_capacity;
+    graph->edge_capacity = (int)(2 * pairs);
+    graph->row_offsets = malloc(sizeof(int) * (member_capacity + 1));
+    graph->neighbors = malloc(sizeof(int) * graph->edge_capacity);
+    graph->pairs = malloc(sizeof(int) * graph->edge_capacity);
+    graph->by_rank = malloc(sizeof(int) * member_capacity);
+    if (!graph->row_offsets || !graph->neighbors || !graph->pairs || !graph->by_rank) {
+        social_graph_free(graph);
+        return -1;
+    }
+    return 0;
+}
+
+void social_graph_free(SocialGraph *graph) {
+    free(graph->row_offsets);
+    free(graph->neighbors);
+    free(graph->pairs);
+    free(graph->by_rank);
+    memset(graph, 0, sizeof(SocialGraph));
+}
+
+static void add_pair(SocialGraph *graph, int *pair_count, int a, int b) {
+    graph->pairs[2 * *pair_count] = a;
+    graph->pairs[2 * *pair_count + 1] = b;
+    (*pair_count)++;
+}
+
+// Rebuild the graph from the gang's current ranks, statuses and missions
+void social_graph_build(SocialGraph *graph, Gang *gang) {
+    MemberStore ms = gang_members(gang);
+    Mission *missions = gang_missions(gang);
+    int count = gang->member_count;
+    int rank_start[MAX_RANKS + 1] = {0};
+    int pair_count = 0;
+
+    // Counting sort of the active members by rank, lowest first
+    for (int w = 0; w < BITSET_WORDS(count); w++) {
+        uint64_t word = ms.active_bits[w] & bitset_word_limit(w, count);
+        for (; word; word &= word - 1) {
+            int member_idx = w * BITSET_WORD_BITS + __builtin_ctzll(word);
+            rank_start[ms.rank[member_idx] + 1]++;
+        }
+    }
+    for (int r = 0; r < MAX_RANKS; r++) {
+        rank_start[r + 1] += rank_start[r];
+    }
+    int fill[MAX_RANKS];
+    memcpy(fill, rank_start, sizeof(fill));
+    for (int w = 0; w < BITSET_WORDS(count); w++) {
+        uint64_t word = ms.active_bits[w] & bitset_word_limit(w, count);
+        for (; word; word &= word - 1) {
+            int member_idx = w * BITSET_WORD_BITS + __builtin_ctzll(word);
+            graph->by_rank[fill[ms.rank[member_idx]]++] = member_idx;
+        }
+    }
+
+    // Chain of command: peers of a rank form a ring, and each member
+    // reports to one superior at the next occupied rank up
+    for (int r = 0; r < MAX_RANKS; r++) {
+        int *peers = &graph->by_rank[rank_start[r]];
+        int peer_count = rank_start[r + 1] - rank_start[r];
+        int ring_edges = peer_count > 2 ? peer_count : peer_count - 1;
+        for (int j = 0; j < ring_edges; j++) {
+            add_pair(graph, &pair_count, peers[j], peers[(j + 1) % peer_count]);
+        }
+
+        int above = r + 1;
+        while (above < MAX_RANKS && rank_start[above + 1] == rank_start[above]) {
+            above++;
+        }
+        if (above == MAX_RANKS) {
+            continue;
+        }
+        int *superiors = &graph->by_rank[rank_start[above]];
+        int superior_count = rank_start[above + 1] - rank_start[above];
+        for (int j = 0; j < peer_count; j++) {
+            add_pair(graph, &pair_count, peers[j], superiors[j % superior_count]);
+        }
+    }
+
+    // Members working on the same mission all talk to each other
+    for (int i = 0; i < gang_mission_capacity(gang); i++) {
+        Mission *mission = &missions[i];
+        if (mission->mission_id == -1 || !mission->in_progress || mission->disrupted) {
+            continue;
+        }
+        int *assigned = mission_assigned_members(gang, mission);
+        for (int a = 0; a < mission->assigned_count; a++) {
+            int first = assigned[a];
+            if (!bitset_test(ms.active_bits, first) || ms.assigned_mission_id[first] != mission->mission_id) {
+                continue;
+            }
+            for (int b = a + 1; b < mission->assigned_count; b++) {
+                int second = assigned[b];
+                if (bitset_test(ms.active_bits, second) && ms.assigned_mission_id[second] == mission->mission_id) {
+                    add_pair(graph, &pair_count, first, second);
+                }
+            }
+        }
+    }
+
+    // Degrees, then their prefix sums, then the rows; filling advances
+    // each row start to the next row's, so shift them back afterwards
+    int *rows = graph->row_offsets;
+    memset(rows, 0, sizeof(int) * (count + 1));
+    for (int e = 0; e < 2 * pair_count; e++) {
+        rows[graph->pairs[e] + 1]++;
+    }
+    for (int i = 0; i < count; i++) {
+        rows[i + 1] += rows[i];
+    }
+    for (int e = 0; e < pair_count; e++) {
+        int a = graph->pairs[2 * e];
+        int b = graph->pairs[2 * e + 1];
+        graph->neighbors[rows[a]++] = b;
+        graph->neighbors[rows[b]++] = a;
+    }
+    memmove(rows + 1, rows, sizeof(int) * count);
+    rows[0] = 0;
+
+    graph->member_count = count;
+    graph->edge_count = 2 * pair_count;
+}
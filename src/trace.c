@@ -0,0 +1,139 @@
+#include "../include/trace.h"
+#include "../include/sim_clock.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+static TraceHeader *g_trace;
+static TraceRecord *g_trace_records;
+static size_t g_trace_size;
+static pid_t g_trace_owner;
+static char g_trace_path[256];
+
+static const char *trace_event_names[TRACE_EVENT_TYPES] = {
+    "none",
+    "mission_created",
+    "mission_succeeded",
+    "mission_failed",
+    "mission_abandoned",
+    "member_arrested",
+    "member_released",
+    "member_killed",
+    "member_recruited",
+    "member_promoted",
+    "agent_report",
+    "police_action",
+    "agent_executed",
+    "simulation_end"
+};
+
+int trace_open(const char *path, const SimConfig *config) {
+    long capacity = config->trace_capacity;
+    size_t size = sizeof(TraceHeader) + (size_t)capacity * sizeof(TraceRecord);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        log_error("Failed to open trace file %s: %s", path, strerror(errno));
+        return -1;
+    }
+    // Pages are only allocated as records reach them
+    if (ftruncate(fd, size) != 0) {
+        log_error("Failed to size trace file %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_error("Failed to map trace file %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    g_trace = (TraceHeader *)map;
+    g_trace_records = (TraceRecord *)((char *)map + sizeof(TraceHeader));
+    g_trace_size = size;
+    g_trace_owner = getpid();
+    safe_strcpy(g_trace_path, path, sizeof(g_trace_path));
+
+    memcpy(g_trace->magic, TRACE_MAGIC, sizeof(g_trace->magic));
+    g_trace->version = TRACE_VERSION;
+    g_trace->record_size = sizeof(TraceRecord);
+    g_trace->capacity = capacity;
+    g_trace->claimed = 0;
+    g_trace->start_time = time(NULL);
+    g_trace->seed = config->seed;
+    g_trace->gang_count = config->num_gangs;
+    g_trace->time_scale = (float)sim_clock_scale();
+
+    log_message("Tracing events to %s (room for %ld records)", path, capacity);
+    return 0;
+}
+
+void trace_event(TraceEventType type, int gang_id, int subject, int arg, int detail, float value) {
+    if (!g_trace) {
+        return;
+    }
+
+    // Slots past the end are still counted, so the reader can tell how many were lost
+    uint64_t slot = __atomic_fetch_add(&g_trace->claimed, 1, __ATOMIC_RELAXED);
+    if (slot >= g_trace->capacity) {
+        return;
+    }
+
+    TraceRecord *record = &g_trace_records[slot];
+    record->sim_ms = (uint64_t)(sim_clock_elapsed_sim() * 1000.0);
+    record->gang_id = (int16_t)gang_id;
+    record->subject = subject;
+    record->arg = arg;
+    record->detail = detail;
+    record->value = value;
+    record->spare = 0;
+    __atomic_store_n(&record->type, (uint16_t)type, __ATOMIC_RELEASE);
+}
+
+// Only the process that opened the trace shrinks the file; forked
+// actors just lose their mapping when they exit
+void trace_close(void) {
+    if (!g_trace) {
+        return;
+    }
+
+    bool owner = getpid() == g_trace_owner;
+    uint64_t claimed = __atomic_load_n(&g_trace->claimed, __ATOMIC_ACQUIRE);
+    uint64_t records = claimed < g_trace->capacity ? claimed : g_trace->capacity;
+
+    if (owner && claimed > records) {
+        log_message("Trace file %s filled up; %llu events were not recorded",
+                    g_trace_path, (unsigned long long)(claimed - records));
+    }
+    munmap(g_trace, g_trace_size);
+    g_trace = NULL;
+    g_trace_records = NULL;
+
+    if (owner) {
+        if (truncate(g_trace_path, sizeof(TraceHeader) + records * sizeof(TraceRecord)) != 0) {
+            log_error("Failed to trim trace file %s: %s", g_trace_path, strerror(errno));
+        } else {
+            log_message("Trace file %s holds %llu events", g_trace_path, (unsigned long long)records);
+        }
+    }
+}
+
+const char *trace_event_name(TraceEventType type) {
+    if (type >= 0 && type < TRACE_EVENT_TYPES) {
+        return trace_event_names[type];
+    }
+    return "unknown";
+}
+
+bool trace_event_from_name(const char *name, TraceEventType *type) {
+    for (int i = TRACE_NONE + 1; i < TRACE_EVENT_TYPES; i++) {
+        if (strcmp(name, trace_event_names[i]) == 0) {
+            *type = (TraceEventType)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,4 +1,6 @@
 #include "../include/utils.h"
+#include "../include/sim_clock.h"
+#include "../include/rng.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -37,40 +39,35 @@ static const char* simulation_status_strings[] = {
     "Running",
     "Police Win",
     "Gangs Win",
-    "Agents Lost"
+    "Agents Lost",
+    "Time Limit",
+    "Shutdown"
 };
 
-// Initialize random number generator
-void init_random(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    srand((unsigned int)(tv.tv_sec * 1000 + tv.tv_usec / 1000));
+static RngStream g_main_rng;
+
+// Initialize random number generator, seed 0 means seed from the clock.
+// Every actor derives its own stream from this master seed.
+void init_random(unsigned int seed) {
+    uint64_t master = seed;
+    if (master == 0) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        master = (uint64_t)tv.tv_sec * 1000000ULL + (uint64_t)tv.tv_usec;
+    }
+    rng_set_master_seed(master);
+    rng_seed_stream(&g_main_rng, RNG_STREAM_MAIN);
+    rng_bind_thread(&g_main_rng);
 }
 
-// Generate a random float between 0.0 and 1.0
+// Generate a random float between 0.0 and 1.0 from the thread's stream
 float rand_float(void) {
-    return (float)rand() / (float)RAND_MAX;
+    return rng_float(rng_thread_stream());
 }
 
 // Generate a random integer in the specified range (inclusive)
 int rand_range(int min, int max) {
-    return min + rand() % (max - min + 1);
-}
-
-// Log a message with timestamp
-void log_message(const char *format, ...) {
-    char buffer[256];
-    char timestamp[32];
-    va_list args;
-    
-    format_timestamp(timestamp, sizeof(timestamp));
-    
-    va_start(args, format);
-    vsnprintf(buffer, sizeof(buffer), format, args);
-    va_end(args);
-    
-    printf("[%s] %s\n", timestamp, buffer);
-    fflush(stdout);
+    return rng_range(rng_thread_stream(), min, max);
 }
 
 // Format current timestamp
@@ -92,10 +89,15 @@ const char* get_target_name(CrimeTarget target) {
     return "Unknown";
 }
 
+// Build a semaphore name that is unique to this simulation instance
+void format_semaphore_name(char *buffer, size_t size, int id) {
+    snprintf(buffer, size, "/gang_sem_%d_%d", (int)getpid(), id);
+}
+
 // Create a named semaphore
 sem_t* create_named_semaphore(int id, int initial_value) {
     char name[32];
-    snprintf(name, sizeof(name), "/gang_sem_%d", id);
+    format_semaphore_name(name, sizeof(name), id);
     
     sem_t *sem = sem_open(name, O_CREAT | O_EXCL, 0644, initial_value);
     if (sem == SEM_FAILED) {
@@ -133,25 +135,71 @@ char* safe_strcpy(char *dest, const char *src, size_t dest_size) {
 
 // Validate configuration parameters
 int validate_config(SimConfig *config) {
-    if (config->num_gangs <= 0 || config->num_gangs > MAX_GANGS) {
-        log_message("Invalid number of gangs: %d (max: %d)", config->num_gangs, MAX_GANGS);
+    // Gang and member counts only have to fit the shared state layout
+    if (config->num_gangs <= 0) {
+        log_error("Invalid number of gangs: %d", config->num_gangs);
         return 0;
     }
     
-    if (config->min_members_per_gang <= 0 || config->max_members_per_gang > MAX_MEMBERS) {
-        log_message("Invalid member range: %d-%d (max: %d)", 
-                   config->min_members_per_gang, config->max_members_per_gang, MAX_MEMBERS);
+    if (config->min_members_per_gang <= 0 || 
+        config->max_members_per_gang < config->min_members_per_gang) {
+        log_error("Invalid member range: %d-%d", 
+                 config->min_members_per_gang, config->max_members_per_gang);
+        return 0;
+    }
+    
+    if (config->max_concurrent_missions <= 0) {
+        log_error("Invalid max concurrent missions: %d", config->max_concurrent_missions);
+        return 0;
+    }
+    
+    if (config->max_agents_per_gang < 0) {
+        log_error("Invalid max agents per gang: %d", config->max_agents_per_gang);
         return 0;
     }
     
     if (config->num_ranks <= 0 || config->num_ranks > MAX_RANKS) {
-        log_message("Invalid number of ranks: %d (max: %d)", config->num_ranks, MAX_RANKS);
+        log_error("Invalid number of ranks: %d (max: %d)", config->num_ranks, MAX_RANKS);
         return 0;
     }
     
     if (config->agent_infiltration_rate < 0.0 || config->agent_infiltration_rate > 1.0) {
-        log_message("Invalid agent infiltration rate: %.2f (should be 0.0-1.0)", 
-                   config->agent_infiltration_rate);
+        log_error("Invalid agent infiltration rate: %.2f (should be 0.0-1.0)", 
+                 config->agent_infiltration_rate);
+        return 0;
+    }
+    
+    if (config->worker_threads < 0) {
+        log_error("Invalid worker thread count: %d (should be >= 0, 0 = a share of the cores)",
+                 config->worker_threads);
+        return 0;
+    }
+    
+    if (config->shard_threads < 0) {
+        log_error("Invalid shard thread count: %d (should be >= 0, 0 = one per core)",
+                 config->shard_threads);
+        return 0;
+    }
+    
+    if (config->time_scale < 0.0f) {
+        log_error("Invalid time scale: %.2f (should be >= 0, 0 = virtual clock)",
+                 config->time_scale);
+        return 0;
+    }
+    
+    if (config->trace_file[0] != '\0' && config->trace_capacity <= 0) {
+        log_error("Invalid trace capacity: %ld (should be > 0)", config->trace_capacity);
+        return 0;
+    }
+    
+    if (config->max_sim_seconds < 0.0f) {
+        log_error("Invalid simulated time limit: %.2f (should be >= 0, 0 = no limit)",
+                 config->max_sim_seconds);
+        return 0;
+    }
+    
+    if (config->checkpoint_file[0] != '\0' && config->checkpoint_at < 0.0f) {
+        log_error("Invalid checkpoint time: %.2f (should be >= 0)", config->checkpoint_at);
         return 0;
     }
     
@@ -160,7 +208,22 @@ int validate_config(SimConfig *config) {
 
 // Print help information
 void print_help(const char *program_name) {
-    printf("Usage: %s [config_file]\n", program_name);
+    printf("Usage: %s [options] config_file\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  --time-scale N   Run simulated time N times faster than wall time\n");
+    printf("  --fast           Run on the virtual clock, as fast as the actors go (same as --time-scale 0)\n");
+    printf("  --seed N         Master random seed, runs with the same seed draw the same streams\n");
+    printf("  --headless       Run without visualization and print a final summary\n");
+    printf("  --summary FILE   Write the headless summary to FILE (implies --headless)\n");
+    printf("  --in-process     Run all gangs and the police in one process\n");
+    printf("  --shards N       Gang shard threads in in-process mode (implies --in-process)\n");
+    printf("  --rings          Pass messages through lock-free rings in shared memory\n");
+    printf("  --trace FILE     Record a binary event trace to FILE (read it with simtrace)\n");
+    printf("  --log-level L    Log only up to L: error, info or verbose (default: verbose)\n");
+    printf("  --checkpoint FILE  Save the whole simulation to FILE once it has warmed up\n");
+    printf("  --checkpoint-at S  Take the checkpoint S simulated seconds into the run (default: 60)\n");
+    printf("  --restore FILE   Start from the checkpoint in FILE; a new --seed branches it\n");
     printf("\n");
     printf("If config isnt valid, the program will use default values\n");
 }
@@ -183,7 +246,7 @@ const char* agent_status_to_string(AgentStatus status) {
 
 // Convert simulation status to string
 const char* simulation_status_to_string(SimulationStatus status) {
-    if (status >= 0 && status <= SIM_STATUS_AGENTS_LOST) {
+    if (status >= 0 && status <= SIM_STATUS_SHUTDOWN) {
         return simulation_status_strings[status];
     }
     return "Unknown";
@@ -191,8 +254,7 @@ const char* simulation_status_to_string(SimulationStatus status) {
 
 // Sleep for a random time within a range
 void random_sleep(int min_ms, int max_ms) {
-    int sleep_time = rand_range(min_ms, max_ms);
-    usleep(sleep_time * 1000);
+    sim_sleep_ms(rand_range(min_ms, max_ms));
 }
 
 // Generate a member name for visualization
@@ -1,5 +1,7 @@
 #include "../include/visualization.h"
 #include "../include/utils.h"
+#include "../include/shared_state.h"
+#include "../include/ipc.h"
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
@@ -43,7 +45,7 @@ int setup_visualization(const char *window_title) {
     // Create window
     g_window_id = glutCreateWindow(window_title);
     if (g_window_id == 0) {
-        log_message("Failed to create visualization window");
+        log_error("Failed to create visualization window");
         return -1;
     }
     
@@ -78,8 +80,8 @@ void display_callback(void) {
         return;
     }
     
-    // Lock the shared state mutex for reading
-    pthread_mutex_lock(&g_shared_state->status_mutex);
+    // No lock for the frame: gangs come from their published snapshots, and
+    // the counters below are single ints that only need to be recent
     
     // Render gangs information
     float y_offset = 50;
@@ -87,7 +89,7 @@ void display_callback(void) {
     render_string(50, 30, FONT_TITLE, "Criminal Gangs");
     
     for (int i = 0; i < g_shared_state->gang_count; i++) {
-        render_gang_box(50, y_offset, &g_shared_state->gangs[i]);
+        render_gang_box(50, y_offset, shared_gang(g_shared_state, i));
         y_offset += 120;
         
         // Start new column if we're running out of space
@@ -104,10 +106,7 @@ void display_callback(void) {
     render_statistics(g_window_width - 350, g_window_height - 200, g_shared_state, g_config);
     
     // Render status message
-    render_status_message(g_shared_state->status);
-    
-    // Unlock the mutex
-    pthread_mutex_unlock(&g_shared_state->status_mutex);
+    render_status_message(get_simulation_status(g_shared_state));
     
     // Swap buffers
     glutSwapBuffers();
@@ -201,6 +200,9 @@ void render_rectangle(float x, float y, float width, float height, float r, floa
 
 void render_gang_box(float x, float y, Gang *gang) {
     char buffer[MAX_TEXT_LENGTH];
+    GangSnapshot snapshot;
+    
+    read_gang_status(gang_shared_state(gang), gang->id, &snapshot);
     
     // Draw background
     render_rectangle(x, y, 300, 100, COLOR_GANG_BG);
@@ -212,25 +214,17 @@ void render_gang_box(float x, float y, Gang *gang) {
     
     // Draw active missions info
     glColor3f(COLOR_TEXT);
-    snprintf(buffer, MAX_TEXT_LENGTH, "Active Missions: %d/%d", gang->active_mission_count, MAX_CONCURRENT_MISSIONS);
+    snprintf(buffer, MAX_TEXT_LENGTH, "Active Missions: %d/%d", snapshot.active_mission_count, gang_mission_capacity(gang));
     render_string(x + 10, y + 40, FONT_NORMAL, buffer);
     
     // Show details of first active mission (if any)
-    Mission *first_mission = NULL;
-    for (int i = 0; i < MAX_CONCURRENT_MISSIONS; i++) {
-        if (gang->missions[i].mission_id != -1 && gang->missions[i].in_progress) {
-            first_mission = &gang->missions[i];
-            break;
-        }
-    }
-    
-    if (first_mission) {
-        snprintf(buffer, MAX_TEXT_LENGTH, "Next Target: %s", get_target_name(first_mission->target));
+    if (snapshot.has_mission) {
+        snprintf(buffer, MAX_TEXT_LENGTH, "Next Target: %s", get_target_name(snapshot.mission_target));
         render_string(x + 10, y + 55, FONT_NORMAL, buffer);
         
         snprintf(buffer, MAX_TEXT_LENGTH, "Prep Required: %d%% (%d members)", 
-                 (int)(first_mission->required_preparation_level * 100),
-                 first_mission->assigned_count);
+                 (int)(snapshot.mission_required_preparation * 100),
+                 snapshot.mission_assigned_count);
         render_string(x + 10, y + 70, FONT_NORMAL, buffer);
     } else {
         snprintf(buffer, MAX_TEXT_LENGTH, "No active missions");
@@ -238,12 +232,12 @@ void render_gang_box(float x, float y, Gang *gang) {
     }
     
     // Draw member count
-    snprintf(buffer, MAX_TEXT_LENGTH, "Members: %d", gang->member_count);
+    snprintf(buffer, MAX_TEXT_LENGTH, "Members: %d", snapshot.member_count);
     render_string(x + 10, y + 85, FONT_NORMAL, buffer);
     
     // Draw mission stats
     snprintf(buffer, MAX_TEXT_LENGTH, "Success: %d / Fails: %d", 
-             gang->successful_missions, gang->failed_missions);
+             snapshot.successful_missions, snapshot.failed_missions);
     render_string(x + 10, y + 100, FONT_NORMAL, buffer);
     
     // Draw member icons
@@ -252,8 +246,8 @@ void render_gang_box(float x, float y, Gang *gang) {
     float icon_size = 10;
     int row_count = 0;
     
-    for (int i = 0; i < gang->member_count; i++) {
-        render_member_icon(member_x, member_y, icon_size, &gang->members[i]);
+    for (int i = 0; i < snapshot.member_count; i++) {
+        render_member_icon(member_x, member_y, icon_size, gang, i);
         member_x += icon_size + 5;
         row_count++;
         
@@ -276,17 +270,18 @@ void render_police_box(float x, float y, SharedState *shared_state) {
     glColor3f(COLOR_TITLE);
     render_string(x + 10, y + 20, FONT_TITLE, "Police Department");
     
-    // Count active agents - only count up to agent_count instead of MAX_AGENTS
+    // Count active agents - only count up to agent_count
     int active_agents = 0;
     int dead_agents = 0;
     int uncovered_agents = 0;
     
     for (int i = 0; i < shared_state->agent_count; i++) {
-        if (shared_state->agent_statuses[i] == AGENT_STATUS_ACTIVE) {
+        AgentStatus status = read_agent_status(shared_state, i);
+        if (status == AGENT_STATUS_ACTIVE) {
             active_agents++;
-        } else if (shared_state->agent_statuses[i] == AGENT_STATUS_DEAD) {
+        } else if (status == AGENT_STATUS_DEAD) {
             dead_agents++;
-        } else if (shared_state->agent_statuses[i] == AGENT_STATUS_UNCOVERED) {
+        } else if (status == AGENT_STATUS_UNCOVERED) {
             uncovered_agents++;
         }
     }
@@ -357,11 +352,14 @@ void render_statistics(float x, float y, SharedState *shared_state, SimConfig *c
     render_progress_bar(x + 120, y + 135, 160, 10, agent_loss_progress, 0.8f, 0.8f, 0.2f);
 }
 
-void render_member_icon(float x, float y, float size, GangMember *member) {
+void render_member_icon(float x, float y, float size, const Gang *gang, int member_index) {
+    MemberStore members = gang_members(gang);
+    int rank = members.rank[member_index];
+    
     // Choose color based on status
-    switch (member->status) {
+    switch (members.status[member_index]) {
         case MEMBER_STATUS_ACTIVE:
-            if (member->is_agent) {
+            if (members.agent_id[member_index] >= 0) {
                 glColor3f(COLOR_AGENT); // Secret agent color (but only we can see it)
             } else {
                 glColor3f(COLOR_MEMBER); // Regular member
@@ -400,16 +398,16 @@ void render_member_icon(float x, float y, float size, GangMember *member) {
     glEnd();
     
     // Draw rank indicator (small dot inside for higher ranks)
-    if (member->rank > 0) {
+    if (rank > 0) {
         // Higher rank = brighter indicator
-        float brightness = 0.5f + (member->rank / 10.0f) * 0.5f;
+        float brightness = 0.5f + (rank / 10.0f) * 0.5f;
         glColor3f(brightness, brightness, brightness);
         
         glBegin(GL_TRIANGLE_FAN);
         glVertex2f(x, y); // center
         
         // Smaller inner circle, size based on rank
-        float inner_size = size * 0.3f * (member->rank / 5.0f);
+        float inner_size = size * 0.3f * (rank / 5.0f);
         for (int i = 0; i <= 8; i++) {
             float angle = 2.0f * M_PI * i / 8;
             glVertex2f(x + inner_size * cos(angle), y + inner_size * sin(angle));
@@ -470,6 +468,10 @@ void render_status_message(SimulationStatus status) {
             snprintf(buffer, MAX_TEXT_LENGTH, "SIMULATION ENDED: Too many secret agents have been discovered and executed!");
             glColor3f(COLOR_WARNING);
             break;
+        case SIM_STATUS_TIME_LIMIT:
+            snprintf(buffer, MAX_TEXT_LENGTH, "SIMULATION ENDED: Time limit reached");
+            glColor3f(COLOR_TEXT);
+            break;
         default:
             snprintf(buffer, MAX_TEXT_LENGTH, "Unknown Status");
             glColor3f(COLOR_TEXT);
@@ -0,0 +1,309 @@
+#include "../include/common.h"
+#include "../include/checkpoint.h"
+#include "../include/config.h"
+#include "../include/simulation.h"
+#include "../include/sim_clock.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+
+/*
+ * What-if branching. Loads one checkpoint of a live run and forks a
+ * worker per branch; every worker applies its branch's configuration
+ * overrides and runs the simulation on from the checkpoint, in-process
+ * and headless. The checkpoint is mapped once, before the forks, so the
+ * branches share its pages instead of each reading the file, and none
+ * of them pays for warming up or for a process per gang. The outcomes
+ * are printed side by side.
+ */
+
+#define BRANCH_NAME_WIDTH 32
+
+typedef struct {
+    pid_t pid;
+    int fd;
+    int branch;
+} BranchWorker;
+
+typedef struct {
+    const char *name;
+    SimConfig config;
+    bool done;
+    SimulationSummary summary;
+} Branch;
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [options] config_file checkpoint_file [branch ...]\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  --jobs N         Number of branches run in parallel (default: all cores)\n");
+    printf("  --time-scale N   Simulated seconds per wall second (default: the virtual clock)\n");
+    printf("\n");
+    printf("A branch is a comma-separated list of configuration overrides, such as\n");
+    printf("initial_raid_gang=3 or police_thwart_win_count=20,seed=5; \"base\" runs\n");
+    printf("the checkpoint unchanged. Without branches only the base runs. A branch\n");
+    printf("without a seed of its own continues the checkpoint's random streams.\n");
+}
+
+// Apply "key=value,key=value" on top of the base configuration, whose
+// checkpoint has gang_count gangs
+static int apply_overrides(SimConfig *config, const char *spec, int gang_count) {
+    char buffer[512];
+    if (strcmp(spec, "base") == 0) {
+        return 0;
+    }
+    safe_strcpy(buffer, spec, sizeof(buffer));
+
+    char *saveptr = NULL;
+    for (char *item = strtok_r(buffer, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        char *value = strchr(item, '=');
+        if (!value) {
+            fprintf(stderr, "Branch '%s': '%s' is not key=value\n", spec, item);
+            return -1;
+        }
+        *value++ = '\0';
+        if (!config_set(config, item, value)) {
+            fprintf(stderr, "Branch '%s': unknown configuration key '%s'\n", spec, item);
+            return -1;
+        }
+    }
+    // The police would skip a raid on a gang the checkpoint does not have
+    if (config->initial_raid_gang < -1 || config->initial_raid_gang >= gang_count) {
+        fprintf(stderr, "Branch '%s': initial_raid_gang %d is not a gang of the checkpoint (0-%d)\n",
+                spec, config->initial_raid_gang, gang_count - 1);
+        return -1;
+    }
+    return 0;
+}
+
+static void run_worker(SimConfig *config, int fd) {
+    SimulationSummary summary;
+
+    // Keep worker logs out of the report
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull != -1) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+
+    init_random(config->seed);
+    sim_clock_init(config->time_scale);
+
+    int result = run_simulation_with_summary(config, 0, NULL, &summary);
+    if (result == 0) {
+        ssize_t written = write(fd, &summary, sizeof(summary));
+        if (written != (ssize_t)sizeof(summary)) {
+            result = -1;
+        }
+        free_simulation_summary(&summary);
+    }
+
+    close(fd);
+    logger_flush();
+    _exit(result == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static int start_worker(BranchWorker *worker, Branch *branch, int index) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    } else if (pid == 0) {
+        close(fds[0]);
+        run_worker(&branch->config, fds[1]);
+    }
+
+    close(fds[1]);
+    worker->pid = pid;
+    worker->fd = fds[0];
+    worker->branch = index;
+    return 0;
+}
+
+static int read_summary(int fd, SimulationSummary *summary) {
+    size_t total = 0;
+    while (total < sizeof(*summary)) {
+        ssize_t n = read(fd, (char *)summary + total, sizeof(*summary) - total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        total += n;
+    }
+    return 0;
+}
+
+static void print_branches(const Branch *branches, int count) {
+    printf("%-*s %-12s %11s %9s %11s %9s %12s\n", BRANCH_NAME_WIDTH, "branch", "outcome",
+           "sim_seconds", "thwarted", "successful", "executed", "wall_seconds");
+    for (int i = 0; i < count; i++) {
+        const Branch *branch = &branches[i];
+        if (!branch->done) {
+            printf("%-*s %-12s\n", BRANCH_NAME_WIDTH, branch->name, "failed");
+            continue;
+        }
+        const SimulationSummary *s = &branch->summary;
+        printf("%-*s %-12s %11.1f %9d %11d %9d %12.3f\n", BRANCH_NAME_WIDTH, branch->name,
+               simulation_status_to_string(s->status), s->sim_seconds, s->total_thwarted_plans,
+               s->total_successful_plans, s->total_executed_agents, s->wall_seconds);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *positional[2];
+    int positional_count = 0;
+    const char **specs = calloc(argc, sizeof(char *));
+    int spec_count = 0;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    float time_scale = 0.0f;
+
+    if (!specs) {
+        perror("calloc");
+        return 1;
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--time-scale") == 0 && i + 1 < argc) {
+            time_scale = atof(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            print_usage(argv[0]);
+            return 1;
+        } else if (positional_count < 2) {
+            positional[positional_count++] = argv[i];
+        } else {
+            specs[spec_count++] = argv[i];
+        }
+    }
+    if (positional_count != 2 || jobs <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (spec_count == 0) {
+        specs[spec_count++] = "base";
+    }
+
+    const char *config_file = positional[0];
+    const char *checkpoint_file = positional[1];
+    SimConfig base;
+    if (load_config(config_file, &base) != 0) {
+        fprintf(stderr, "Failed to load the configuration from %s\n", config_file);
+        return 1;
+    }
+    // Branches run in one process each and only report their summary
+    base.time_scale = time_scale;
+    base.headless = true;
+    base.execution_mode = EXECUTION_MODE_INPROCESS;
+    base.trace_file[0] = '\0';
+    base.checkpoint_file[0] = '\0';
+    logger_set_level(LOG_LEVEL_ERROR);
+
+    // Work out every branch's configuration before anything runs
+    Branch *branches = calloc(spec_count, sizeof(Branch));
+    BranchWorker *workers = calloc(jobs, sizeof(BranchWorker));
+    if (!branches || !workers) {
+        perror("calloc");
+        return 1;
+    }
+    for (int i = 0; i < spec_count; i++) {
+        branches[i].name = specs[i];
+        branches[i].config = base;
+        if (apply_overrides(&branches[i].config, specs[i], base.num_gangs) != 0) {
+            return 1;
+        }
+        safe_strcpy(branches[i].config.restore_file, checkpoint_file, sizeof(branches[i].config.restore_file));
+        if (!validate_config(&branches[i].config)) {
+            fprintf(stderr, "Branch '%s' has an invalid configuration\n", specs[i]);
+            return 1;
+        }
+    }
+
+    // Mapped here, so every worker forked below inherits the same pages
+    if (checkpoint_load(checkpoint_file, &base) != 0) {
+        return 1;
+    }
+
+    int next = 0, running = 0, finished = 0, failed = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (finished < spec_count) {
+        // Keep every job slot busy
+        while (running < jobs && next < spec_count) {
+            BranchWorker *slot = NULL;
+            for (int i = 0; i < jobs; i++) {
+                if (workers[i].pid == 0) {
+                    slot = &workers[i];
+                    break;
+                }
+            }
+            if (start_worker(slot, &branches[next], next) != 0) {
+                finished++;
+                failed++;
+            } else {
+                running++;
+            }
+            next++;
+        }
+
+        if (running == 0) {
+            break;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (int i = 0; i < jobs; i++) {
+            if (workers[i].pid != pid) {
+                continue;
+            }
+
+            Branch *branch = &branches[workers[i].branch];
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+                read_summary(workers[i].fd, &branch->summary) == 0) {
+                // Only the totals cross the pipe; the gang table stays behind
+                branch->summary.gangs = NULL;
+                branch->done = true;
+            } else {
+                fprintf(stderr, "Branch '%s' failed\n", branch->name);
+                failed++;
+            }
+
+            close(workers[i].fd);
+            workers[i].pid = 0;
+            running--;
+            finished++;
+            break;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("# %s: %d branches, %d jobs, %.3f wall seconds\n", checkpoint_file, spec_count, jobs, wall);
+    print_branches(branches, spec_count);
+
+    checkpoint_unload();
+    free(workers);
+    free(branches);
+    free(specs);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,270 @@
+#include "../include/common.h"
+#include "../include/config.h"
+#include "../include/simulation.h"
+#include "../include/sim_clock.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+
+/*
+ * Monte Carlo ensemble driver. Runs many independent headless
+ * simulations of one configuration, each in its own forked worker with
+ * private IPC resources and its own seed, and reports the distribution
+ * of outcomes.
+ */
+
+#define ENSEMBLE_OUTCOMES (SIM_STATUS_SHUTDOWN + 1)
+
+/* Running mean/variance (Welford) for one counter */
+typedef struct {
+    long count;
+    double mean;
+    double m2;
+} RunningStat;
+
+typedef struct {
+    pid_t pid;
+    int fd;
+    int run_index;
+} EnsembleWorker;
+
+static void stat_add(RunningStat *stat, double value) {
+    stat->count++;
+    double delta = value - stat->mean;
+    stat->mean += delta / stat->count;
+    stat->m2 += delta * (value - stat->mean);
+}
+
+static double stat_variance(const RunningStat *stat) {
+    return stat->count > 1 ? stat->m2 / (stat->count - 1) : 0.0;
+}
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [options] config_file runs base_seed\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  --jobs N         Number of simulations run in parallel (default: all cores)\n");
+    printf("  --time-scale N   Simulated seconds per wall second (default: the virtual clock)\n");
+}
+
+static void run_worker(const SimConfig *base_config, unsigned int seed, int fd) {
+    SimConfig config = *base_config;
+    SimulationSummary summary;
+
+    // Keep worker logs out of the ensemble report
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull != -1) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+
+    config.seed = seed;
+    config.headless = true;
+    config.trace_file[0] = '\0';  // Workers would all write the same file
+    config.checkpoint_file[0] = '\0';
+    logger_set_level(LOG_LEVEL_ERROR);
+    init_random(config.seed);
+    sim_clock_init(config.time_scale);
+
+    int result = run_simulation_with_summary(&config, 0, NULL, &summary);
+    if (result == 0) {
+        ssize_t written = write(fd, &summary, sizeof(summary));
+        if (written != (ssize_t)sizeof(summary)) {
+            result = -1;
+        }
+        free_simulation_summary(&summary);
+    }
+
+    close(fd);
+    logger_flush();
+    _exit(result == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static int start_worker(EnsembleWorker *worker, const SimConfig *config, unsigned int seed, int run_index) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    } else if (pid == 0) {
+        close(fds[0]);
+        run_worker(config, seed, fds[1]);
+    }
+
+    close(fds[1]);
+    worker->pid = pid;
+    worker->fd = fds[0];
+    worker->run_index = run_index;
+    return 0;
+}
+
+static int read_summary(int fd, SimulationSummary *summary) {
+    size_t total = 0;
+    while (total < sizeof(*summary)) {
+        ssize_t n = read(fd, (char *)summary + total, sizeof(*summary) - total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        total += n;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *positional[3];
+    int positional_count = 0;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    // The virtual clock: runs end as they would in real time, only sooner
+    float time_scale = 0.0f;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--time-scale") == 0 && i + 1 < argc) {
+            time_scale = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && positional_count < 3) {
+            positional[positional_count++] = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (positional_count != 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char *config_file = positional[0];
+    int runs = atoi(positional[1]);
+    unsigned int base_seed = (unsigned int)strtoul(positional[2], NULL, 10);
+    if (runs <= 0 || jobs <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    SimConfig config;
+    if (load_config(config_file, &config) != 0 || !validate_config(&config)) {
+        fprintf(stderr, "Failed to load a valid configuration from %s\n", config_file);
+        return 1;
+    }
+    config.time_scale = time_scale;
+
+    EnsembleWorker *workers = calloc(jobs, sizeof(EnsembleWorker));
+    if (!workers) {
+        perror("calloc");
+        return 1;
+    }
+
+    int outcome_counts[ENSEMBLE_OUTCOMES] = {0};
+    RunningStat thwarted = {0}, successful = {0}, executed = {0}, sim_seconds = {0};
+    int next_run = 0, running = 0, completed = 0, failed = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (completed + failed < runs) {
+        // Keep every job slot busy
+        while (running < jobs && next_run < runs) {
+            EnsembleWorker *slot = NULL;
+            for (int i = 0; i < jobs; i++) {
+                if (workers[i].pid == 0) {
+                    slot = &workers[i];
+                    break;
+                }
+            }
+            if (start_worker(slot, &config, base_seed + next_run, next_run) != 0) {
+                failed++;
+            } else {
+                running++;
+            }
+            next_run++;
+        }
+
+        if (running == 0) {
+            break;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (int i = 0; i < jobs; i++) {
+            if (workers[i].pid != pid) {
+                continue;
+            }
+
+            SimulationSummary summary;
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+                read_summary(workers[i].fd, &summary) == 0) {
+                // Only the totals cross the pipe; the gang table stays behind
+                summary.gangs = NULL;
+                if (summary.status >= 0 && summary.status < ENSEMBLE_OUTCOMES) {
+                    outcome_counts[summary.status]++;
+                }
+                stat_add(&thwarted, summary.total_thwarted_plans);
+                stat_add(&successful, summary.total_successful_plans);
+                stat_add(&executed, summary.total_executed_agents);
+                stat_add(&sim_seconds, summary.sim_seconds);
+                completed++;
+            } else {
+                fprintf(stderr, "Run %d (seed %u) failed\n", workers[i].run_index,
+                        base_seed + workers[i].run_index);
+                failed++;
+            }
+
+            close(workers[i].fd);
+            workers[i].pid = 0;
+            running--;
+            break;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("runs=%d\n", runs);
+    printf("completed=%d\n", completed);
+    printf("failed=%d\n", failed);
+    printf("base_seed=%u\n", base_seed);
+    printf("jobs=%d\n", jobs);
+    printf("time_scale=%.1f\n", time_scale);
+    printf("wall_seconds=%.3f\n", wall);
+    printf("outcome.police_win=%d\n", outcome_counts[SIM_STATUS_POLICE_WIN]);
+    printf("outcome.gangs_win=%d\n", outcome_counts[SIM_STATUS_GANGS_WIN]);
+    printf("outcome.agents_lost=%d\n", outcome_counts[SIM_STATUS_AGENTS_LOST]);
+    printf("outcome.time_limit=%d\n", outcome_counts[SIM_STATUS_TIME_LIMIT]);
+    printf("outcome.other=%d\n", outcome_counts[SIM_STATUS_RUNNING] + outcome_counts[SIM_STATUS_SHUTDOWN]);
+    if (completed > 0) {
+        printf("outcome.police_win.frequency=%.4f\n", (double)outcome_counts[SIM_STATUS_POLICE_WIN] / completed);
+        printf("outcome.gangs_win.frequency=%.4f\n", (double)outcome_counts[SIM_STATUS_GANGS_WIN] / completed);
+        printf("outcome.agents_lost.frequency=%.4f\n", (double)outcome_counts[SIM_STATUS_AGENTS_LOST] / completed);
+    }
+    printf("total_thwarted_plans.mean=%.4f\n", thwarted.mean);
+    printf("total_thwarted_plans.variance=%.4f\n", stat_variance(&thwarted));
+    printf("total_successful_plans.mean=%.4f\n", successful.mean);
+    printf("total_successful_plans.variance=%.4f\n", stat_variance(&successful));
+    printf("total_executed_agents.mean=%.4f\n", executed.mean);
+    printf("total_executed_agents.variance=%.4f\n", stat_variance(&executed));
+    printf("sim_seconds.mean=%.4f\n", sim_seconds.mean);
+    printf("sim_seconds.variance=%.4f\n", stat_variance(&sim_seconds));
+
+    free(workers);
+    return failed == 0 ? 0 : 1;
+}
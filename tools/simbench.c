@@ -0,0 +1,925 @@
+#define _GNU_SOURCE  // sched_setaffinity
+#include "../include/common.h"
+#include "../include/config.h"
+#include "../include/gang.h"
+#include "../include/police.h"
+#include "../include/ipc.h"
+#include "../include/shared_state.h"
+#include "../include/sim_clock.h"
+#include "../include/utils.h"
+#include "../include/visualization.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+/*
+ * Microbenchmarks of the simulation kernels, the message round trips and
+ * the render functions. Every benchmark runs on a world built the way
+ * the in-process runs build theirs, from a fixed seed, so two runs of
+ * the same tree measure the same work. A benchmark is timed in batches
+ * of calls sized to take at least BENCH_BATCH_NS each; the percentiles
+ * are over the batches. Results go to a table on stdout and optionally
+ * to JSON, which a later run can compare itself against.
+ *
+ * The render functions draw into an offscreen Mesa context (EGL on the
+ * surfaceless platform), so no window is needed; the ones that draw text
+ * also need the GLUT fonts, which GLUT only hands out with an X display.
+ */
+
+#define BENCH_SEED 12345
+#define BENCH_JSON_VERSION 1
+#define BENCH_BATCH_NS 200000LL      /* Shortest batch worth timing */
+#define BENCH_WARMUP_NS 50000000LL
+#define BENCH_MIN_SAMPLES 20
+#define BENCH_MAX_SAMPLES 2000
+#define BENCH_DEFAULT_MIN_TIME 0.5   /* Wall seconds of samples per benchmark */
+#define BENCH_DEFAULT_THRESHOLD 0.10 /* Slowdown flagged as a regression */
+#define BENCH_REPORTS 256            /* Distinct reports cycled through */
+#define BENCH_NAME_WIDTH 44
+
+typedef enum {
+    BENCH_CPU,
+    BENCH_GL,        /* Needs the offscreen context */
+    BENCH_GL_FONTS   /* Also needs the GLUT fonts */
+} BenchNeeds;
+
+typedef struct {
+    const char *name;
+    BenchNeeds needs;
+    int (*setup)(void);
+    void (*run)(long ops);
+    void (*teardown)(void);
+} Benchmark;
+
+typedef struct {
+    const char *name;
+    double ns_per_op;   /* Median over the batches */
+    double ops_per_sec;
+    double mean_ns;
+    double min_ns;
+    double p50_ns;
+    double p90_ns;
+    double p99_ns;
+    int samples;
+    long batch;
+    bool skipped;
+    const char *skip_reason;
+} BenchResult;
+
+typedef struct {
+    char name[128];
+    double ns_per_op;
+} BaselineEntry;
+
+// The world the current benchmark runs on, built by its setup
+typedef struct {
+    SimConfig config;
+    SharedState *state;
+    size_t size;
+    int msg_queue_id;
+    GangRuntime *gangs;
+    int started_gangs;
+    PoliceRuntime police;
+    bool police_started;
+} BenchWorld;
+
+static SimConfig g_base_config;
+static BenchWorld g_world;
+static AgentReport g_reports[BENCH_REPORTS];
+static volatile long g_sink;  // Keeps results the compiler could otherwise drop
+
+static EGLDisplay g_egl_display = EGL_NO_DISPLAY;
+static bool g_gl_ready = false;
+static bool g_fonts_ready = false;
+
+static long long bench_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/* ---------------------------------------------------------------- world */
+
+static void world_destroy(void) {
+    BenchWorld *world = &g_world;
+    if (world->police_started) {
+        police_runtime_stop(&world->police);
+    }
+    for (int i = 0; i < world->started_gangs; i++) {
+        gang_runtime_stop(&world->gangs[i]);
+    }
+    free(world->gangs);
+    if (world->state) {
+        remove_message_channels(world->state);
+        ipc_attach_state(NULL);
+        munmap(world->state, world->size);
+    }
+    if (world->msg_queue_id != MESSAGE_CHANNELS_ID) {
+        remove_message_queue(world->msg_queue_id);
+    }
+    memset(world, 0, sizeof(*world));
+}
+
+// Build the gangs and the police in private memory, as an in-process run
+// does; the execution mode and transport pick how the messages travel
+static int world_create(ExecutionMode mode, MessageTransport transport) {
+    BenchWorld *world = &g_world;
+    memset(world, 0, sizeof(*world));
+    world->config = g_base_config;
+    world->config.execution_mode = mode;
+    world->config.message_transport = transport;
+    world->msg_queue_id = MESSAGE_CHANNELS_ID;
+
+    init_random(BENCH_SEED);
+    world->size = shared_state_size(&world->config);
+    if (world->size == 0) {
+        log_error("Configuration too large for the shared state");
+        return -1;
+    }
+    void *ptr = mmap(NULL, world->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    world->state = (SharedState *)ptr;
+
+    // In-process runs on the queue transport share one in-memory queue
+    if (mode == EXECUTION_MODE_INPROCESS && transport == MESSAGE_TRANSPORT_QUEUE) {
+        world->msg_queue_id = init_local_message_queue();
+        if (world->msg_queue_id == -1) {
+            world->msg_queue_id = MESSAGE_CHANNELS_ID;
+            world_destroy();
+            return -1;
+        }
+    }
+    if (init_shared_state(world->state, &world->config) != 0) {
+        world_destroy();
+        return -1;
+    }
+
+    SharedState *state = world->state;
+    SimConfig *config = &world->config;
+    state->status = SIM_STATUS_RUNNING;
+    state->gang_count = config->num_gangs;
+    state->agent_execution_loss_count = config->agent_execution_loss_count;
+
+    world->gangs = calloc(config->num_gangs, sizeof(GangRuntime));
+    if (!world->gangs) {
+        perror("calloc");
+        world_destroy();
+        return -1;
+    }
+    for (int i = 0; i < config->num_gangs; i++) {
+        int member_count = rand_range(config->min_members_per_gang, config->max_members_per_gang);
+        if (gang_init(shared_gang(state, i), i, member_count, config) != 0) {
+            log_error("Failed to initialize gang %d", i);
+            world_destroy();
+            return -1;
+        }
+    }
+
+    RngStream *main_rng = rng_thread_stream();
+    for (int i = 0; i < config->num_gangs; i++) {
+        if (gang_runtime_start(&world->gangs[i], i, config, world->msg_queue_id, state, 0) != 0) {
+            log_error("Failed to start gang %d", i);
+            rng_bind_thread(main_rng);
+            world_destroy();
+            return -1;
+        }
+        world->started_gangs++;
+    }
+    if (police_runtime_start(&world->police, config, world->msg_queue_id, state) != 0) {
+        log_error("Failed to start the police");
+        rng_bind_thread(main_rng);
+        world_destroy();
+        return -1;
+    }
+    world->police_started = true;
+    rng_bind_thread(main_rng);
+    return 0;
+}
+
+static int world_create_default(void) {
+    return world_create(EXECUTION_MODE_INPROCESS, MESSAGE_TRANSPORT_RINGS);
+}
+
+// Fill every mission slot of a gang that its members allow
+static void fill_missions(Gang *gang) {
+    rng_bind_thread(&gang->rng);
+    while (create_new_mission(gang, &g_world.config) != -1) {
+    }
+}
+
+// Free every mission slot of a gang and its members with it
+static void clear_missions(Gang *gang) {
+    Mission *missions = gang_missions(gang);
+    for (int i = 0; i < gang_mission_capacity(gang); i++) {
+        if (missions[i].mission_id != -1) {
+            abandon_mission(gang, &missions[i]);
+        }
+    }
+}
+
+/* -------------------------------------------------------------- kernels */
+
+static int setup_diffuse_knowledge(void) {
+    if (world_create_default() != 0) {
+        return -1;
+    }
+    fill_missions(g_world.gangs[0].gang);
+    return 0;
+}
+
+static void run_diffuse_knowledge(long ops) {
+    GangRuntime *runtime = &g_world.gangs[0];
+    for (long i = 0; i < ops; i++) {
+        diffuse_knowledge(runtime);
+    }
+}
+
+static int setup_assign_members(void) {
+    if (world_create_default() != 0) {
+        return -1;
+    }
+    Gang *gang = g_world.gangs[0].gang;
+    clear_missions(gang);
+    rng_bind_thread(&gang->rng);
+
+    Mission *mission = &gang_missions(gang)[0];
+    mission->mission_id = gang->next_mission_id++;
+    mission->target = TARGET_BANK_ROBBERY;
+    mission->required_preparation_level = 1.0f;
+    mission->in_progress = true;
+    mission->disrupted = false;
+    mission->assigned_count = 0;
+    mission->unprepared_count = 0;
+    gang->active_mission_count = 1;
+    return 0;
+}
+
+// Each call also releases the members again, so the next one finds them free
+static void run_assign_members(long ops) {
+    Gang *gang = g_world.gangs[0].gang;
+    Mission *mission = &gang_missions(gang)[0];
+    MemberStore ms = gang_members(gang);
+    int *assigned = mission_assigned_members(gang, mission);
+
+    for (long i = 0; i < ops; i++) {
+        assign_members_to_mission(gang, mission, &g_world.config);
+        for (int j = 0; j < mission->assigned_count; j++) {
+            set_member_mission(gang, &ms, assigned[j], -1, -1);
+        }
+    }
+}
+
+static int setup_check_missions_idle(void) {
+    if (world_create_default() != 0) {
+        return -1;
+    }
+    fill_missions(g_world.gangs[0].gang);
+    return 0;
+}
+
+// Nothing is ready: the scan every gang tick pays
+static void run_check_missions_idle(long ops) {
+    Gang *gang = g_world.gangs[0].gang;
+    for (long i = 0; i < ops; i++) {
+        check_and_execute_ready_missions(gang, &g_world.config, g_world.msg_queue_id);
+    }
+}
+
+static int setup_check_missions_execute(void) {
+    if (world_create_default() != 0) {
+        return -1;
+    }
+    Gang *gang = g_world.gangs[0].gang;
+    clear_missions(gang);
+    rng_bind_thread(&gang->rng);
+    return 0;
+}
+
+// A full mission per call: created, brought to its required preparation,
+// executed and completed, then the dead are replaced
+static void run_check_missions_execute(long ops) {
+    Gang *gang = g_world.gangs[0].gang;
+    SimConfig *config = &g_world.config;
+    MemberStore ms = gang_members(gang);
+
+    for (long i = 0; i < ops; i++) {
+        if (create_new_mission(gang, config) != -1) {
+            Mission *missions = gang_missions(gang);
+            for (int slot = 0; slot < gang_mission_capacity(gang); slot++) {
+                Mission *mission = &missions[slot];
+                if (mission->mission_id == -1) {
+                    continue;
+                }
+                int *assigned = mission_assigned_members(gang, mission);
+                for (int j = 0; j < mission->assigned_count; j++) {
+                    ms.preparation_level[assigned[j]] = mission->required_preparation_level;
+                    set_member_mission(gang, &ms, assigned[j], slot, mission->mission_id);
+                }
+            }
+        }
+        check_and_execute_ready_missions(gang, config, g_world.msg_queue_id);
+        recruit_new_members(gang, config);
+    }
+}
+
+static int setup_police(void) {
+    if (world_create_default() != 0) {
+        return -1;
+    }
+    PoliceRuntime *police = &g_world.police;
+    if (police->agent_count == 0) {
+        log_error("No agents infiltrated; raise agent_infiltration_rate");
+        world_destroy();
+        return -1;
+    }
+
+    rng_bind_thread(&police->rng);
+    for (int i = 0; i < BENCH_REPORTS; i++) {
+        const SecretAgent *agent = &police->agents[i % police->agent_count];
+        g_reports[i].agent_id = agent->id;
+        g_reports[i].gang_id = agent->gang_id;
+        g_reports[i].suspected_target = (CrimeTarget)rand_range(0, TARGET_COUNT - 1);
+        g_reports[i].confidence_level = rand_float();
+        g_reports[i].estimated_execution_time = sim_time() + rand_range(1, 10);
+    }
+    return 0;
+}
+
+static void run_process_agent_report(long ops) {
+    PoliceRuntime *police = &g_world.police;
+    long acted = 0;
+    for (long i = 0; i < ops; i++) {
+        acted += process_agent_report(&g_reports[i % BENCH_REPORTS], police->agents, police->intel,
+                                      &g_world.config, police->agent_count);
+    }
+    g_sink += acted;
+}
+
+// Every gang under surveillance, with a target far enough off that no
+// review lifts it, so each call analyses them all
+static int setup_review_intelligence(void) {
+    if (setup_police() != 0) {
+        return -1;
+    }
+    PoliceRuntime *police = &g_world.police;
+    for (int i = 0; i < g_world.state->gang_count; i++) {
+        police->intel[i].under_surveillance = true;
+        police->intel[i].suspicion_level = 0.5f;
+        police->intel[i].estimated_execution_time = sim_time() + 3600;
+    }
+    return 0;
+}
+
+static void run_review_intelligence(long ops) {
+    PoliceRuntime *police = &g_world.police;
+    time_t now = sim_time();
+    for (long i = 0; i < ops; i++) {
+        review_intelligence(police->intel, g_world.state, g_world.state->gang_count, now);
+    }
+}
+
+/* ------------------------------------------------------------- messages */
+
+static int setup_roundtrip_rings(void) {
+    return world_create(EXECUTION_MODE_INPROCESS, MESSAGE_TRANSPORT_RINGS);
+}
+
+static int setup_roundtrip_local(void) {
+    return world_create(EXECUTION_MODE_INPROCESS, MESSAGE_TRANSPORT_QUEUE);
+}
+
+static int setup_roundtrip_sysv(void) {
+    return world_create(EXECUTION_MODE_PROCESS, MESSAGE_TRANSPORT_QUEUE);
+}
+
+// One report sent and received back on the same thread
+static void run_roundtrip(long ops) {
+    IpcMessage message;
+    long received = 0;
+    memset(&message, 0, sizeof(message));
+    for (long i = 0; i < ops; i++) {
+        message.mtype = MSG_TYPE_AGENT_REPORT;
+        message.data.agent_report = g_reports[i % BENCH_REPORTS];
+        send_message(g_world.msg_queue_id, &message);
+        received += receive_message(g_world.msg_queue_id, &message, MSG_TYPE_AGENT_REPORT, true) == 0;
+    }
+    g_sink += received;
+}
+
+/* --------------------------------------------------------------- render */
+
+// An offscreen context of the window's size on Mesa's surfaceless platform
+static bool render_init(int argc, char **argv) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!get_platform_display) {
+        return false;
+    }
+    g_egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (g_egl_display == EGL_NO_DISPLAY || !eglInitialize(g_egl_display, NULL, NULL)) {
+        g_egl_display = EGL_NO_DISPLAY;
+        return false;
+    }
+
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    const EGLint surface_attributes[] = { EGL_WIDTH, WINDOW_WIDTH, EGL_HEIGHT, WINDOW_HEIGHT, EGL_NONE };
+    EGLConfig egl_config;
+    EGLint configs = 0;
+    if (!eglChooseConfig(g_egl_display, config_attributes, &egl_config, 1, &configs) || configs == 0 ||
+        !eglBindAPI(EGL_OPENGL_API)) {
+        return false;
+    }
+    EGLContext context = eglCreateContext(g_egl_display, egl_config, EGL_NO_CONTEXT, NULL);
+    EGLSurface surface = eglCreatePbufferSurface(g_egl_display, egl_config, surface_attributes);
+    if (context == EGL_NO_CONTEXT || surface == EGL_NO_SURFACE ||
+        !eglMakeCurrent(g_egl_display, surface, surface, context)) {
+        return false;
+    }
+
+    // The same projection as the window; GLUT only for its fonts
+    reshape_callback(WINDOW_WIDTH, WINDOW_HEIGHT);
+    glClearColor(COLOR_BACKGROUND, 1.0f);
+    if (getenv("DISPLAY") && getenv("DISPLAY")[0]) {
+        glutInit(&argc, argv);
+        g_fonts_ready = true;
+    }
+    return true;
+}
+
+static void render_shutdown(void) {
+    if (g_egl_display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(g_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglTerminate(g_egl_display);
+    }
+}
+
+// Every batch ends once the frame is drawn, not when the calls are queued
+#define RENDER_BATCH(ops, call)           \
+    do {                                  \
+        for (long i = 0; i < (ops); i++) { \
+            call;                         \
+        }                                 \
+        glFinish();                       \
+    } while (0)
+
+static void run_render_rectangle(long ops) {
+    RENDER_BATCH(ops, render_rectangle(10 + i % 100, 10, 300, 100, COLOR_GANG_BG));
+}
+
+static void run_render_progress_bar(long ops) {
+    RENDER_BATCH(ops, render_progress_bar(120, 95, 160, 10, (i % 100) / 100.0f, 0.2f, 0.6f, 1.0f));
+}
+
+static void run_render_member_icon(long ops) {
+    Gang *gang = g_world.gangs[0].gang;
+    RENDER_BATCH(ops, render_member_icon(200 + i % 100, 30, 10, gang, (int)(i % gang->member_count)));
+}
+
+static void run_render_string(long ops) {
+    RENDER_BATCH(ops, render_string(10, 20, FONT_NORMAL, "Successful Gang Plans: 12"));
+}
+
+static void run_render_gang_box(long ops) {
+    int gangs = g_world.state->gang_count;
+    RENDER_BATCH(ops, render_gang_box(50, 50, g_world.gangs[i % gangs].gang));
+}
+
+static void run_render_police_box(long ops) {
+    RENDER_BATCH(ops, render_police_box(400, 50, g_world.state));
+}
+
+static void run_render_statistics(long ops) {
+    RENDER_BATCH(ops, render_statistics(750, 50, g_world.state, &g_world.config));
+}
+
+static void run_render_target_info(long ops) {
+    RENDER_BATCH(ops, render_target_info(10, 10, (CrimeTarget)(i % TARGET_COUNT)));
+}
+
+static void run_render_status_message(long ops) {
+    RENDER_BATCH(ops, render_status_message(SIM_STATUS_RUNNING));
+}
+
+static const Benchmark g_benchmarks[] = {
+    { "diffuse_knowledge", BENCH_CPU, setup_diffuse_knowledge, run_diffuse_knowledge, world_destroy },
+    { "assign_members_to_mission", BENCH_CPU, setup_assign_members, run_assign_members, world_destroy },
+    { "check_and_execute_ready_missions/idle", BENCH_CPU, setup_check_missions_idle,
+      run_check_missions_idle, world_destroy },
+    { "check_and_execute_ready_missions/execute", BENCH_CPU, setup_check_missions_execute,
+      run_check_missions_execute, world_destroy },
+    { "process_agent_report", BENCH_CPU, setup_police, run_process_agent_report, world_destroy },
+    { "review_intelligence", BENCH_CPU, setup_review_intelligence, run_review_intelligence, world_destroy },
+    { "message_roundtrip/rings", BENCH_CPU, setup_roundtrip_rings, run_roundtrip, world_destroy },
+    { "message_roundtrip/local_queue", BENCH_CPU, setup_roundtrip_local, run_roundtrip, world_destroy },
+    { "message_roundtrip/sysv_queue", BENCH_CPU, setup_roundtrip_sysv, run_roundtrip, world_destroy },
+    { "render_rectangle", BENCH_GL, world_create_default, run_render_rectangle, world_destroy },
+    { "render_progress_bar", BENCH_GL, world_create_default, run_render_progress_bar, world_destroy },
+    { "render_member_icon", BENCH_GL, world_create_default, run_render_member_icon, world_destroy },
+    { "render_string", BENCH_GL_FONTS, world_create_default, run_render_string, world_destroy },
+    { "render_gang_box", BENCH_GL_FONTS, world_create_default, run_render_gang_box, world_destroy },
+    { "render_police_box", BENCH_GL_FONTS, world_create_default, run_render_police_box, world_destroy },
+    { "render_statistics", BENCH_GL_FONTS, world_create_default, run_render_statistics, world_destroy },
+    { "render_target_info", BENCH_GL_FONTS, world_create_default, run_render_target_info, world_destroy },
+    { "render_status_message", BENCH_GL_FONTS, world_create_default, run_render_status_message, world_destroy },
+};
+
+#define BENCHMARK_COUNT ((int)(sizeof(g_benchmarks) / sizeof(g_benchmarks[0])))
+
+/* -------------------------------------------------------------- harness */
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, int count, double p) {
+    int rank = (int)(p / 100.0 * count + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    } else if (rank > count) {
+        rank = count;
+    }
+    return sorted[rank - 1];
+}
+
+static long long time_batch(const Benchmark *bench, long ops) {
+    long long start = bench_now_ns();
+    bench->run(ops);
+    return bench_now_ns() - start;
+}
+
+static int measure(const Benchmark *bench, double min_time, BenchResult *result) {
+    double *samples = malloc(sizeof(double) * BENCH_MAX_SAMPLES);
+    if (!samples) {
+        perror("malloc");
+        return -1;
+    }
+
+    // Grow the batch until it is long enough to time
+    long ops = 1;
+    while (time_batch(bench, ops) < BENCH_BATCH_NS && ops < (1L << 30)) {
+        ops *= 2;
+    }
+
+    long long warmup_end = bench_now_ns() + BENCH_WARMUP_NS;
+    while (bench_now_ns() < warmup_end) {
+        time_batch(bench, ops);
+    }
+
+    long long min_ns = (long long)(min_time * 1e9);
+    long long start = bench_now_ns();
+    int count = 0;
+    while (count < BENCH_MAX_SAMPLES &&
+           (count < BENCH_MIN_SAMPLES || bench_now_ns() - start < min_ns)) {
+        samples[count++] = (double)time_batch(bench, ops) / ops;
+    }
+
+    qsort(samples, count, sizeof(double), compare_double);
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+    result->samples = count;
+    result->batch = ops;
+    result->min_ns = samples[0];
+    result->mean_ns = sum / count;
+    result->p50_ns = percentile(samples, count, 50);
+    result->p90_ns = percentile(samples, count, 90);
+    result->p99_ns = percentile(samples, count, 99);
+    result->ns_per_op = result->p50_ns;
+    result->ops_per_sec = result->ns_per_op > 0 ? 1e9 / result->ns_per_op : 0.0;
+    free(samples);
+    return 0;
+}
+
+// A JSON string literal: quotes, backslashes and control characters escaped
+static void write_json_string(FILE *out, const char *text) {
+    fputc('"', out);
+    for (const unsigned char *at = (const unsigned char *)text; *at; at++) {
+        if (*at == '"' || *at == '\\') {
+            fprintf(out, "\\%c", *at);
+        } else if (*at < 0x20) {
+            fprintf(out, "\\u%04x", *at);
+        } else {
+            fputc(*at, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static int write_json(const char *path, const char *config_file, const BenchResult *results, int count) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(out, "{\n  \"version\": %d,\n  \"config\": ", BENCH_JSON_VERSION);
+    write_json_string(out, config_file);
+    fprintf(out, ",\n  \"seed\": %d,\n  \"benchmarks\": [", BENCH_SEED);
+    bool first = true;
+    for (int i = 0; i < count; i++) {
+        const BenchResult *r = &results[i];
+        if (r->skipped) {
+            continue;
+        }
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"ops_per_sec\": %.1f, "
+                "\"mean_ns\": %.3f, \"min_ns\": %.3f, \"p50_ns\": %.3f, \"p90_ns\": %.3f, "
+                "\"p99_ns\": %.3f, \"samples\": %d, \"batch\": %ld}",
+                first ? "" : ",", r->name, r->ns_per_op, r->ops_per_sec, r->mean_ns, r->min_ns,
+                r->p50_ns, r->p90_ns, r->p99_ns, r->samples, r->batch);
+        first = false;
+    }
+    fprintf(out, "\n  ],\n  \"skipped\": [");
+    first = true;
+    for (int i = 0; i < count; i++) {
+        if (results[i].skipped) {
+            fprintf(out, "%s\"%s\"", first ? "" : ", ", results[i].name);
+            first = false;
+        }
+    }
+    fprintf(out, "]\n}\n");
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// Only reads what write_json writes: the name and ns_per_op of each entry
+static int load_baseline(const char *path, BaselineEntry **entries, int *count) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Cannot open baseline %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    char *text = malloc(size + 1);
+    if (!text || fread(text, 1, size, in) != (size_t)size) {
+        fprintf(stderr, "Cannot read baseline %s\n", path);
+        free(text);
+        fclose(in);
+        return -1;
+    }
+    text[size] = '\0';
+    fclose(in);
+
+    *entries = NULL;
+    *count = 0;
+    int capacity = 0;
+    for (char *at = strstr(text, "\"name\": \""); at; at = strstr(at, "\"name\": \"")) {
+        at += strlen("\"name\": \"");
+        char *end = strchr(at, '"');
+        char *value = end ? strstr(end, "\"ns_per_op\": ") : NULL;
+        if (!value) {
+            break;
+        }
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 32;
+            BaselineEntry *grown = realloc(*entries, capacity * sizeof(BaselineEntry));
+            if (!grown) {
+                perror("realloc");
+                free(text);
+                return -1;
+            }
+            *entries = grown;
+        }
+        BaselineEntry *entry = &(*entries)[(*count)++];
+        size_t length = end - at < (long)sizeof(entry->name) - 1 ? (size_t)(end - at) : sizeof(entry->name) - 1;
+        memcpy(entry->name, at, length);
+        entry->name[length] = '\0';
+        entry->ns_per_op = atof(value + strlen("\"ns_per_op\": "));
+        at = value;
+    }
+    free(text);
+
+    if (*count == 0) {
+        fprintf(stderr, "%s holds no benchmark results\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static const BaselineEntry *find_baseline(const BaselineEntry *entries, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void print_header(bool comparing) {
+    printf("%-*s %12s %14s %12s %12s %12s", BENCH_NAME_WIDTH, "benchmark", "ns/op", "ops/sec",
+           "p50_ns", "p90_ns", "p99_ns");
+    if (comparing) {
+        printf(" %12s %8s", "base_ns/op", "change");
+    }
+    printf("\n");
+}
+
+// Prints one result; returns true when it is a regression against the baseline
+static bool print_result(const BenchResult *r, const BaselineEntry *base, double threshold) {
+    if (r->skipped) {
+        printf("%-*s skipped: %s\n", BENCH_NAME_WIDTH, r->name, r->skip_reason);
+        return false;
+    }
+    printf("%-*s %12.1f %14.0f %12.1f %12.1f %12.1f", BENCH_NAME_WIDTH, r->name, r->ns_per_op,
+           r->ops_per_sec, r->p50_ns, r->p90_ns, r->p99_ns);
+
+    bool regression = false;
+    if (base && base->ns_per_op > 0) {
+        double change = r->ns_per_op / base->ns_per_op - 1.0;
+        regression = change > threshold;
+        printf(" %12.1f %+7.1f%%%s", base->ns_per_op, change * 100.0,
+               regression ? "  REGRESSION" : change < -threshold ? "  faster" : "");
+    } else if (base) {
+        printf(" %12s %8s", "-", "");
+    }
+    printf("\n");
+    fflush(stdout);
+    return regression;
+}
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [options] [config_file]\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  --filter TEXT      Only benchmarks whose name contains TEXT\n");
+    printf("  --min-time S       Wall seconds of samples per benchmark (default: %.1f)\n", BENCH_DEFAULT_MIN_TIME);
+    printf("  --members N        Members in every gang (default: as configured)\n");
+    printf("  --cpu N            Pin the benchmarks to CPU N\n");
+    printf("  --json FILE        Write the results as JSON\n");
+    printf("  --compare FILE     Compare with the JSON results in FILE; exits with 1 on regressions\n");
+    printf("  --threshold F      Slowdown counted as a regression (default: %.2f)\n", BENCH_DEFAULT_THRESHOLD);
+    printf("  --list             List the benchmarks\n");
+    printf("\n");
+    printf("The configuration defaults to config.txt.\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *config_file = "config.txt";
+    const char *filter = NULL;
+    const char *json_file = NULL;
+    const char *baseline_file = NULL;
+    double min_time = BENCH_DEFAULT_MIN_TIME;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    int members = 0;
+    int cpu = -1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            min_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--members") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            members = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+            cpu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_file = argv[++i];
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc && atof(argv[i + 1]) >= 0) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--list") == 0) {
+            for (int b = 0; b < BENCHMARK_COUNT; b++) {
+                printf("%s\n", g_benchmarks[b].name);
+            }
+            return 0;
+        } else if (argv[i][0] != '-') {
+            config_file = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (load_config(config_file, &g_base_config) != 0) {
+        fprintf(stderr, "Failed to load the configuration from %s\n", config_file);
+        return 1;
+    }
+    if (members > 0) {
+        g_base_config.min_members_per_gang = members;
+        g_base_config.max_members_per_gang = members;
+    }
+    g_base_config.headless = true;
+    g_base_config.trace_file[0] = '\0';
+    g_base_config.checkpoint_file[0] = '\0';
+    g_base_config.restore_file[0] = '\0';
+    g_base_config.initial_raid_gang = -1;
+    if (!validate_config(&g_base_config)) {
+        fprintf(stderr, "Invalid configuration\n");
+        return 1;
+    }
+    logger_set_level(LOG_LEVEL_ERROR);
+
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            perror("sched_setaffinity");
+            return 1;
+        }
+    }
+
+    BaselineEntry *baseline = NULL;
+    int baseline_count = 0;
+    if (baseline_file && load_baseline(baseline_file, &baseline, &baseline_count) != 0) {
+        return 1;
+    }
+
+    // Every benchmark measures the simulated clock as fast as it goes
+    sim_clock_init(0.0f);
+
+    bool wants_gl = false;
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        if (g_benchmarks[i].needs != BENCH_CPU && (!filter || strstr(g_benchmarks[i].name, filter))) {
+            wants_gl = true;
+        }
+    }
+    g_gl_ready = wants_gl && render_init(argc, argv);
+
+    BenchResult results[BENCHMARK_COUNT];
+    int count = 0, regressions = 0;
+    printf("# %s, seed %d, %d gangs of %d-%d members\n", config_file, BENCH_SEED, g_base_config.num_gangs,
+           g_base_config.min_members_per_gang, g_base_config.max_members_per_gang);
+    print_header(baseline != NULL);
+
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        const Benchmark *bench = &g_benchmarks[i];
+        if (filter && !strstr(bench->name, filter)) {
+            continue;
+        }
+
+        BenchResult *result = &results[count++];
+        memset(result, 0, sizeof(*result));
+        result->name = bench->name;
+        if (bench->needs != BENCH_CPU && !g_gl_ready) {
+            result->skipped = true;
+            result->skip_reason = "no offscreen OpenGL context";
+        } else if (bench->needs == BENCH_GL_FONTS && !g_fonts_ready) {
+            result->skipped = true;
+            result->skip_reason = "the GLUT fonts need an X display (try xvfb-run)";
+        } else if (bench->setup() != 0) {
+            result->skipped = true;
+            result->skip_reason = "setup failed";
+        } else {
+            int measured = measure(bench, min_time, result);
+            bench->teardown();
+            if (measured != 0) {
+                result->skipped = true;
+                result->skip_reason = "measurement failed";
+            }
+        }
+
+        const BaselineEntry *base = NULL;
+        if (baseline) {
+            base = find_baseline(baseline, baseline_count, bench->name);
+            if (!base) {
+                static const BaselineEntry missing = { "", 0.0 };
+                base = &missing;
+            }
+        }
+        if (print_result(result, base, threshold)) {
+            regressions++;
+        }
+    }
+
+    if (g_gl_ready) {
+        render_shutdown();
+    }
+    logger_flush();
+
+    int status = 0;
+    if (json_file && write_json(json_file, config_file, results, count) != 0) {
+        status = 1;
+    }
+    if (baseline) {
+        if (regressions > 0) {
+            printf("# %d regression%s over %.0f%% against %s\n", regressions, regressions == 1 ? "" : "s",
+                   threshold * 100.0, baseline_file);
+            status = 1;
+        } else {
+            printf("# No regressions over %.0f%% against %s\n", threshold * 100.0, baseline_file);
+        }
+        free(baseline);
+    }
+    return status;
+}
@@ -0,0 +1,385 @@
+#include "../include/common.h"
+#include "../include/config.h"
+#include "../include/metrics.h"
+#include "../include/simulation.h"
+#include "../include/sim_clock.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+
+/*
+ * End-to-end macrobenchmark. Sweeps gang count, members per gang and
+ * agent density and runs every combination as a whole headless
+ * simulation, on the fastest clock, for a fixed stretch of simulated
+ * time. Scenarios run one after another, each in a forked worker, so
+ * the resources the parent reads back from wait4() belong to that
+ * scenario alone: peak RSS is the largest process of the run, context
+ * switches are those of every process or thread it had.
+ *
+ * An event is a member step or a change of state: a mission created,
+ * succeeded, failed, disrupted or abandoned, an arrest, a kill, a
+ * recruit, a report sent or processed, a police action or a discovered
+ * agent. Events per wall second is the number tracked for capacity
+ * planning; report to order latency is the wall time from an agent
+ * sending a report to the police order it set off.
+ */
+
+#define SIMSCALE_MAX_VALUES 16
+#define SIMSCALE_JSON_VERSION 1
+#define SIMSCALE_NEVER 1000000000  /* Win and loss counts no run reaches */
+
+typedef struct {
+    int gangs;
+    int members;
+    float density;
+    bool done;
+    SimulationSummary summary;
+    unsigned long events;
+    double events_per_sec;
+    long max_rss_kb;
+    long voluntary_switches;
+    long involuntary_switches;
+} Scenario;
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [options] config_file\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  --gangs LIST       Gang counts to sweep (default: 5,20,80)\n");
+    printf("  --members LIST     Members per gang to sweep (default: 15,50,200)\n");
+    printf("  --density LIST     Agent infiltration rates to sweep (default: 0.1,0.3)\n");
+    printf("  --duration S       Simulated seconds every scenario runs (default: 300)\n");
+    printf("  --time-scale N     Simulated seconds per wall second (default: the virtual clock)\n");
+    printf("  --in-process       Run every scenario in one process, gangs sharded over threads\n");
+    printf("  --shards N         Gang shard threads in in-process mode (default: one per core)\n");
+    printf("  --rings            Carry messages over lock-free rings in the shared state\n");
+    printf("  --seed N           Random seed of every scenario (default: 1)\n");
+    printf("  --json FILE        Write the results as JSON\n");
+    printf("\n");
+    printf("LIST is comma-separated, at most %d values. The win and loss counts of\n", SIMSCALE_MAX_VALUES);
+    printf("the configuration are lifted so every scenario runs for the full duration.\n");
+}
+
+static int parse_ints(const char *spec, int *values) {
+    char buffer[256];
+    char *saveptr = NULL;
+    int count = 0;
+
+    safe_strcpy(buffer, spec, sizeof(buffer));
+    for (char *item = strtok_r(buffer, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        if (count == SIMSCALE_MAX_VALUES || atoi(item) <= 0) {
+            return -1;
+        }
+        values[count++] = atoi(item);
+    }
+    return count > 0 ? count : -1;
+}
+
+static int parse_floats(const char *spec, float *values) {
+    char buffer[256];
+    char *saveptr = NULL;
+    int count = 0;
+
+    safe_strcpy(buffer, spec, sizeof(buffer));
+    for (char *item = strtok_r(buffer, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        float value = atof(item);
+        if (count == SIMSCALE_MAX_VALUES || value < 0.0f || value > 1.0f) {
+            return -1;
+        }
+        values[count++] = value;
+    }
+    return count > 0 ? count : -1;
+}
+
+static unsigned long count_events(const SimulationSummary *summary) {
+    const GangMetrics *g = &summary->gang_metrics;
+    const PoliceMetrics *p = &summary->police_metrics;
+    return g->member_steps + g->missions_created + g->missions_succeeded + g->missions_failed +
+           g->missions_disrupted + g->missions_abandoned + g->arrests + g->members_killed +
+           g->members_recruited + g->reports_sent + p->reports_processed + p->actions +
+           p->agents_discovered;
+}
+
+static void run_worker(const SimConfig *config, int fd) {
+    SimulationSummary summary;
+
+    // Keep worker logs out of the report
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull != -1) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+
+    init_random(config->seed);
+    sim_clock_init(config->time_scale);
+
+    int result = run_simulation_with_summary((SimConfig *)config, 0, NULL, &summary);
+    if (result == 0) {
+        ssize_t written = write(fd, &summary, sizeof(summary));
+        if (written != (ssize_t)sizeof(summary)) {
+            result = -1;
+        }
+        free_simulation_summary(&summary);
+    }
+
+    close(fd);
+    logger_flush();
+    _exit(result == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static int read_summary(int fd, SimulationSummary *summary) {
+    size_t total = 0;
+    while (total < sizeof(*summary)) {
+        ssize_t n = read(fd, (char *)summary + total, sizeof(*summary) - total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        total += n;
+    }
+    return 0;
+}
+
+static int run_scenario(const SimConfig *base, Scenario *scenario) {
+    SimConfig config = *base;
+    config.num_gangs = scenario->gangs;
+    config.min_members_per_gang = scenario->members;
+    config.max_members_per_gang = scenario->members;
+    config.max_agents_per_gang = scenario->members;
+    config.agent_infiltration_rate = scenario->density;
+    if (config.mission_members_count > scenario->members) {
+        config.mission_members_count = scenario->members;
+    }
+    if (!validate_config(&config)) {
+        return -1;
+    }
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    } else if (pid == 0) {
+        close(fds[0]);
+        run_worker(&config, fds[1]);
+    }
+    close(fds[1]);
+
+    // The summary fits the pipe, so the worker never blocks on it
+    int got_summary = read_summary(fds[0], &scenario->summary);
+    close(fds[0]);
+
+    // Covers the worker and every process it reaped
+    int status;
+    struct rusage usage;
+    while (wait4(pid, &status, 0, &usage) == -1) {
+        if (errno != EINTR) {
+            perror("wait4");
+            return -1;
+        }
+    }
+    if (got_summary != 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+
+    // Only the totals cross the pipe; the gang table stays behind
+    scenario->summary.gangs = NULL;
+    scenario->events = count_events(&scenario->summary);
+    scenario->events_per_sec = scenario->summary.wall_seconds > 0.0
+        ? scenario->events / scenario->summary.wall_seconds : 0.0;
+    scenario->max_rss_kb = usage.ru_maxrss;
+    scenario->voluntary_switches = usage.ru_nvcsw;
+    scenario->involuntary_switches = usage.ru_nivcsw;
+    scenario->done = true;
+    return 0;
+}
+
+static void print_header(void) {
+    printf("%6s %7s %7s %6s %-11s %8s %8s %11s %11s %9s %9s %9s %8s %9s %9s\n",
+           "gangs", "members", "density", "agents", "outcome", "sim_s", "wall_s", "events", "events/s",
+           "rss_mb", "vcsw", "ivcsw", "orders", "p50_us", "p99_us");
+}
+
+static void print_scenario(const Scenario *s) {
+    printf("%6d %7d %7.2f ", s->gangs, s->members, s->density);
+    if (!s->done) {
+        printf("%6s %-11s\n", "-", "failed");
+        return;
+    }
+
+    const PoliceMetrics *p = &s->summary.police_metrics;
+    printf("%6d %-11s %8.1f %8.3f %11lu %11.0f %9.1f %9ld %9ld %8lu %9.1f %9.1f\n",
+           s->summary.agent_count, simulation_status_to_string(s->summary.status), s->summary.sim_seconds,
+           s->summary.wall_seconds, s->events, s->events_per_sec, s->max_rss_kb / 1024.0,
+           s->voluntary_switches, s->involuntary_switches, p->order_latency_count,
+           metrics_latency_percentile(p->order_latency_hist, 50) / 1e3,
+           metrics_latency_percentile(p->order_latency_hist, 99) / 1e3);
+}
+
+static int write_json(const char *path, const char *config_file, const SimConfig *base,
+                      const Scenario *scenarios, int count) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(out, "{\n  \"version\": %d,\n  \"config\": \"%s\",\n  \"seed\": %u,\n"
+            "  \"duration\": %.1f,\n  \"time_scale\": %.1f,\n  \"execution_mode\": \"%s\",\n"
+            "  \"transport\": \"%s\",\n  \"scenarios\": [",
+            SIMSCALE_JSON_VERSION, config_file, base->seed, base->max_sim_seconds, base->time_scale,
+            base->execution_mode == EXECUTION_MODE_INPROCESS ? "in-process" : "process",
+            base->message_transport == MESSAGE_TRANSPORT_RINGS ? "rings" : "queue");
+    for (int i = 0; i < count; i++) {
+        const Scenario *s = &scenarios[i];
+        fprintf(out, "%s\n    {\"gangs\": %d, \"members\": %d, \"density\": %.3f, ",
+                i == 0 ? "" : ",", s->gangs, s->members, s->density);
+        if (!s->done) {
+            fprintf(out, "\"outcome\": \"failed\"}");
+            continue;
+        }
+        const PoliceMetrics *p = &s->summary.police_metrics;
+        double mean_ns = p->order_latency_count > 0
+            ? (double)p->order_latency_ns / p->order_latency_count : 0.0;
+        fprintf(out, "\"agents\": %d, \"outcome\": \"%s\", \"sim_seconds\": %.3f, \"wall_seconds\": %.6f, "
+                "\"events\": %lu, \"events_per_sec\": %.1f, \"member_steps\": %lu, "
+                "\"max_rss_kb\": %ld, \"voluntary_switches\": %ld, \"involuntary_switches\": %ld, "
+                "\"orders\": %lu, \"order_latency_mean_ns\": %.1f, \"order_latency_p50_ns\": %.1f, "
+                "\"order_latency_p99_ns\": %.1f}",
+                s->summary.agent_count, simulation_status_to_string(s->summary.status),
+                s->summary.sim_seconds, s->summary.wall_seconds, s->events, s->events_per_sec,
+                s->summary.gang_metrics.member_steps, s->max_rss_kb, s->voluntary_switches,
+                s->involuntary_switches, p->order_latency_count, mean_ns,
+                metrics_latency_percentile(p->order_latency_hist, 50),
+                metrics_latency_percentile(p->order_latency_hist, 99));
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int gangs[SIMSCALE_MAX_VALUES] = {5, 20, 80};
+    int members[SIMSCALE_MAX_VALUES] = {15, 50, 200};
+    float densities[SIMSCALE_MAX_VALUES] = {0.1f, 0.3f};
+    int gang_count = 3, member_count = 3, density_count = 2;
+    float duration = 300.0f;
+    float time_scale = 0.0f;
+    bool in_process = false, rings = false;
+    int shards = -1;
+    unsigned int seed = 1;
+    const char *json_file = NULL;
+    const char *config_file = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--gangs") == 0 && i + 1 < argc) {
+            gang_count = parse_ints(argv[++i], gangs);
+        } else if (strcmp(argv[i], "--members") == 0 && i + 1 < argc) {
+            member_count = parse_ints(argv[++i], members);
+        } else if (strcmp(argv[i], "--density") == 0 && i + 1 < argc) {
+            density_count = parse_floats(argv[++i], densities);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--time-scale") == 0 && i + 1 < argc) {
+            time_scale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--in-process") == 0) {
+            in_process = true;
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shards = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rings") == 0) {
+            rings = true;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_file = argv[++i];
+        } else if (argv[i][0] == '-' || config_file) {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            config_file = argv[i];
+        }
+    }
+    if (!config_file || gang_count < 0 || member_count < 0 || density_count < 0 ||
+        duration <= 0.0f || time_scale < 0.0f || seed == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    SimConfig base;
+    if (load_config(config_file, &base) != 0) {
+        fprintf(stderr, "Failed to load the configuration from %s\n", config_file);
+        return 1;
+    }
+    // Every scenario runs headless for the same simulated time and only
+    // reports its summary
+    base.seed = seed;
+    base.time_scale = time_scale;
+    base.max_sim_seconds = duration;
+    base.police_thwart_win_count = SIMSCALE_NEVER;
+    base.gang_success_win_count = SIMSCALE_NEVER;
+    base.agent_execution_loss_count = SIMSCALE_NEVER;
+    base.headless = true;
+    base.trace_file[0] = '\0';
+    base.checkpoint_file[0] = '\0';
+    base.restore_file[0] = '\0';
+    if (in_process) {
+        base.execution_mode = EXECUTION_MODE_INPROCESS;
+    }
+    if (shards >= 0) {
+        base.shard_threads = shards;
+    }
+    if (rings) {
+        base.message_transport = MESSAGE_TRANSPORT_RINGS;
+    }
+    logger_set_level(LOG_LEVEL_ERROR);
+
+    int count = gang_count * member_count * density_count;
+    Scenario *scenarios = calloc(count, sizeof(Scenario));
+    if (!scenarios) {
+        perror("calloc");
+        return 1;
+    }
+
+    printf("# %s: %d scenarios of %.0f simulated seconds, seed %u, %s, %s\n", config_file, count,
+           duration, seed, in_process ? "in-process" : "process per gang", rings ? "rings" : "queues");
+    print_header();
+
+    int failed = 0;
+    for (int g = 0, n = 0; g < gang_count; g++) {
+        for (int m = 0; m < member_count; m++) {
+            for (int d = 0; d < density_count; d++, n++) {
+                Scenario *scenario = &scenarios[n];
+                scenario->gangs = gangs[g];
+                scenario->members = members[m];
+                scenario->density = densities[d];
+                if (run_scenario(&base, scenario) != 0) {
+                    failed++;
+                }
+                print_scenario(scenario);
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (json_file && write_json(json_file, config_file, &base, scenarios, count) != 0) {
+        failed++;
+    }
+    free(scenarios);
+    return failed == 0 ? 0 : 1;
+}
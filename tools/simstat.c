@@ -0,0 +1,383 @@
+#include "../include/common.h"
+#include "../include/ipc.h"
+#include "../include/shared_state.h"
+#include "../include/metrics.h"
+
+#include <errno.h>
+#include <signal.h>
+
+/*
+ * Live statistics of a running simulation, in the manner of vmstat.
+ * Attaches the run's shared segment read-only and prints one line of
+ * rates per interval from the counters the actors keep in it (see
+ * metrics.h); the first line covers the whole run so far. The reader
+ * never takes a lock or writes to the segment, so it cannot slow the
+ * run down beyond the cache misses of its reads.
+ *
+ * Only runs whose actors share a System V segment can be watched:
+ * in-process runs keep their state in private memory.
+ */
+
+#define SIMSTAT_HEADER_EVERY 20 /* Lines between repeated headers */
+
+typedef struct {
+    uint64_t at_ns;
+    double sim_s;             /* Simulated clock at the sample */
+    GangMetrics gang_total;
+    GangMetrics *gangs;       /* Per gang, for --gangs */
+    unsigned long *agent_reports;
+    PoliceMetrics police;
+    unsigned long reports_sent, reports_received;
+    unsigned long orders_sent, orders_received;
+    unsigned long status_sent, status_received;
+    int active_missions;      /* Gauges, read at the sample */
+    int live_agents;
+} Sample;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_signal(int sig) {
+    stop_requested = 1;
+}
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [options] [interval [count]]\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  --shm ID   Shared memory ID of the run (default: the newest run of this user)\n");
+    printf("  --gangs    Also print a line per gang for every interval\n");
+    printf("  --agents   Also print the reports of every agent that reported in the interval\n");
+    printf("\n");
+    printf("Prints a line every interval seconds (default 1), count times or until\n");
+    printf("the run ends. Rates are per wall second.\n");
+}
+
+static unsigned long load(const unsigned long *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+// Attach a segment read-only if it holds a simulation with metrics
+static SharedState *attach_run(int shm_id, size_t size) {
+    if (size < sizeof(SharedState)) {
+        return NULL;
+    }
+    void *ptr = shmat(shm_id, NULL, SHM_RDONLY);
+    if (ptr == (void *)-1) {
+        return NULL;
+    }
+
+    SharedState *state = (SharedState *)ptr;
+    const SharedLayout *layout = &state->layout;
+    if (layout->total_size > size ||
+        layout->metrics_offset + sizeof(MetricsHeader) > layout->total_size ||
+        layout->gang_metrics_offset + (size_t)layout->gang_capacity * sizeof(GangMetrics) > layout->total_size ||
+        layout->agent_reports_offset + (size_t)layout->agent_capacity * sizeof(unsigned long) > layout->total_size ||
+        layout->clock_offset + sizeof(SimClockShared) > layout->total_size) {
+        shmdt(ptr);
+        return NULL;
+    }
+
+    MetricsHeader *metrics = shared_metrics(state);
+    if (memcmp(metrics->magic, METRICS_MAGIC, sizeof(metrics->magic)) != 0) {
+        shmdt(ptr);
+        return NULL;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (metrics->version != METRICS_VERSION) {
+        shmdt(ptr);
+        return NULL;
+    }
+    return state;
+}
+
+// The newest segment of this user that holds a simulation with metrics
+static int find_run(void) {
+    FILE *file = fopen("/proc/sysvipc/shm", "r");
+    char line[512];
+    int best_id = -1;
+    long long best_ctime = -1;
+
+    if (!file) {
+        perror("/proc/sysvipc/shm");
+        return -1;
+    }
+    // Skip the column names
+    if (!fgets(line, sizeof(line), file)) {
+        fclose(file);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        long long key, ctime_s;
+        int shm_id, nattch;
+        unsigned int perms, uid;
+        unsigned long long size;
+        long long cpid, lpid, gid, cuid, cgid, atime_s, dtime_s;
+        if (sscanf(line, "%lld %d %o %llu %lld %lld %d %u %lld %lld %lld %lld %lld %lld",
+                   &key, &shm_id, &perms, &size, &cpid, &lpid, &nattch, &uid, &gid,
+                   &cuid, &cgid, &atime_s, &dtime_s, &ctime_s) != 14) {
+            continue;
+        }
+        if (uid != getuid() || nattch == 0 || ctime_s < best_ctime) {
+            continue;
+        }
+        SharedState *state = attach_run(shm_id, (size_t)size);
+        if (state) {
+            shmdt(state);
+            best_id = shm_id;
+            best_ctime = ctime_s;
+        }
+    }
+    fclose(file);
+    return best_id;
+}
+
+// Whether the run still owns the segment; the owner removes it at the end
+static bool run_alive(int shm_id, SharedState *state) {
+    struct shmid_ds ds;
+    if (shmctl(shm_id, IPC_STAT, &ds) != 0 || (ds.shm_perm.mode & SHM_DEST)) {
+        return false;
+    }
+    return get_simulation_status(state) == SIM_STATUS_RUNNING;
+}
+
+static void load_gang_metrics(GangMetrics *copy, GangMetrics *m) {
+    memset(copy, 0, sizeof(*copy));
+    copy->ticks = load(&m->ticks);
+    copy->member_steps = load(&m->member_steps);
+    copy->missions_created = load(&m->missions_created);
+    copy->missions_succeeded = load(&m->missions_succeeded);
+    copy->missions_failed = load(&m->missions_failed);
+    copy->missions_disrupted = load(&m->missions_disrupted);
+    copy->missions_abandoned = load(&m->missions_abandoned);
+    copy->arrests = load(&m->arrests);
+    copy->members_killed = load(&m->members_killed);
+    copy->members_recruited = load(&m->members_recruited);
+    copy->reports_sent = load(&m->reports_sent);
+    copy->lock_waits = load(&m->lock_waits);
+    copy->lock_wait_ns = load(&m->lock_wait_ns);
+}
+
+static double sim_seconds(SharedState *state, uint64_t at_ns) {
+    const MetricsHeader *metrics = shared_metrics(state);
+    if (metrics->time_scale == 0.0) {
+        return metrics->clock_sim + __atomic_load_n(&shared_clock(state)->now_ms, __ATOMIC_ACQUIRE) / 1000.0;
+    }
+    return metrics->clock_sim + (double)(at_ns - metrics->clock_ns) / 1e9 * metrics->time_scale;
+}
+
+static void take_sample(SharedState *state, Sample *sample) {
+    MetricsHeader *metrics = shared_metrics(state);
+    int gangs = state->gang_count;
+    int agents = state->agent_count;
+
+    sample->at_ns = metrics_now_ns();
+    sample->sim_s = sim_seconds(state, sample->at_ns);
+    memset(&sample->gang_total, 0, sizeof(sample->gang_total));
+    sample->active_missions = 0;
+    for (int i = 0; i < gangs; i++) {
+        load_gang_metrics(&sample->gangs[i], shared_gang_metrics(state, i));
+        gang_metrics_accumulate(&sample->gang_total, &sample->gangs[i]);
+
+        GangSnapshot snapshot;
+        read_gang_status(state, i, &snapshot);
+        sample->active_missions += snapshot.active_mission_count;
+    }
+
+    sample->police.ticks = load(&metrics->police.ticks);
+    sample->police.reports_processed = load(&metrics->police.reports_processed);
+    sample->police.actions = load(&metrics->police.actions);
+    sample->police.agents_discovered = load(&metrics->police.agents_discovered);
+
+    // Every channel carries one message type
+    MessageChannel *reports = shared_channel(state, CHANNEL_REPORTS);
+    MessageChannel *status = shared_channel(state, CHANNEL_STATUS);
+    sample->reports_sent = load(&reports->sent);
+    sample->reports_received = load(&reports->received);
+    sample->status_sent = load(&status->sent);
+    sample->status_received = load(&status->received);
+    sample->orders_sent = sample->orders_received = 0;
+    for (int i = 0; i < gangs; i++) {
+        MessageChannel *orders = shared_channel(state, CHANNEL_GANG_ORDERS(i));
+        sample->orders_sent += load(&orders->sent);
+        sample->orders_received += load(&orders->received);
+    }
+
+    AgentStatus *statuses = shared_agent_statuses(state);
+    unsigned long *agent_reports = shared_agent_reports(state);
+    sample->live_agents = 0;
+    for (int i = 0; i < agents; i++) {
+        sample->agent_reports[i] = load(&agent_reports[i]);
+        if (__atomic_load_n(&statuses[i], __ATOMIC_RELAXED) == AGENT_STATUS_ACTIVE) {
+            sample->live_agents++;
+        }
+    }
+}
+
+static void print_header(void) {
+    printf("%-9s %-14s %-25s %-17s %-24s %-13s %-10s\n", "--time--", "----gang----",
+           "--------missions--------", "----members----", "--messages in/out--", "----lock----", "--gauges--");
+    printf("%9s %6s %7s %5s %4s %4s %4s %4s %5s %5s %5s %5s %5s %5s %5s %5s %6s %6s %4s %5s\n",
+           "sim_s", "tick", "steps", "new", "ok", "fail", "dis", "abn", "arr", "kill", "rcrt",
+           "rep", "rep>", "ord", "ord>", "sts", "waits", "avg_us", "miss", "agnt");
+}
+
+// Counters as rates over the interval between two samples
+#define RATE(field) ((double)(now->field - before->field) / seconds)
+
+static void print_line(const Sample *before, const Sample *now) {
+    double seconds = (double)(now->at_ns - before->at_ns) / 1e9;
+    unsigned long waits = now->gang_total.lock_waits - before->gang_total.lock_waits;
+    double wait_us = waits ? (double)(now->gang_total.lock_wait_ns - before->gang_total.lock_wait_ns) / waits / 1e3 : 0.0;
+    if (seconds <= 0) {
+        seconds = 1e-9;
+    }
+
+    printf("%9.1f %6.0f %7.0f %5.0f %4.0f %4.0f %4.0f %4.0f %5.0f %5.0f %5.0f %5.0f %5.0f %5.0f %5.0f %5.0f %6.0f %6.1f %4d %5d\n",
+           now->sim_s,
+           RATE(gang_total.ticks), RATE(gang_total.member_steps),
+           RATE(gang_total.missions_created), RATE(gang_total.missions_succeeded),
+           RATE(gang_total.missions_failed), RATE(gang_total.missions_disrupted),
+           RATE(gang_total.missions_abandoned),
+           RATE(gang_total.arrests), RATE(gang_total.members_killed), RATE(gang_total.members_recruited),
+           RATE(reports_sent), RATE(reports_received), RATE(orders_sent), RATE(orders_received),
+           RATE(status_sent), RATE(gang_total.lock_waits), wait_us,
+           now->active_missions, now->live_agents);
+}
+
+static void print_gangs(int gangs, const Sample *before, const Sample *now) {
+    double seconds = (double)(now->at_ns - before->at_ns) / 1e9;
+    if (seconds <= 0) {
+        seconds = 1e-9;
+    }
+    for (int i = 0; i < gangs; i++) {
+        const GangMetrics *b = &before->gangs[i];
+        const GangMetrics *n = &now->gangs[i];
+        unsigned long waits = n->lock_waits - b->lock_waits;
+        printf("  gang %-3d tick=%.0f steps=%.0f missions=%lu/%lu/%lu arrests=%lu reports=%lu lock_waits=%lu avg_us=%.1f\n",
+               i, (n->ticks - b->ticks) / seconds, (n->member_steps - b->member_steps) / seconds,
+               n->missions_created - b->missions_created, n->missions_succeeded - b->missions_succeeded,
+               n->missions_failed - b->missions_failed, n->arrests - b->arrests,
+               n->reports_sent - b->reports_sent, waits,
+               waits ? (double)(n->lock_wait_ns - b->lock_wait_ns) / waits / 1e3 : 0.0);
+    }
+}
+
+static void print_agents(int agents, const Sample *before, const Sample *now) {
+    for (int i = 0; i < agents; i++) {
+        unsigned long reports = now->agent_reports[i] - before->agent_reports[i];
+        if (reports > 0) {
+            printf("  agent %-4d reports=%lu total=%lu\n", i, reports, now->agent_reports[i]);
+        }
+    }
+}
+
+static int alloc_sample(Sample *sample, const SharedLayout *layout) {
+    memset(sample, 0, sizeof(*sample));
+    sample->gangs = calloc(layout->gang_capacity, sizeof(GangMetrics));
+    sample->agent_reports = calloc(layout->agent_capacity, sizeof(unsigned long));
+    if (!sample->gangs || !sample->agent_reports) {
+        perror("calloc");
+        return -1;
+    }
+    return 0;
+}
+
+static void free_sample(Sample *sample) {
+    free(sample->gangs);
+    free(sample->agent_reports);
+}
+
+int main(int argc, char *argv[]) {
+    int shm_id = -1;
+    bool show_gangs = false, show_agents = false;
+    double interval = 1.0;
+    long count = -1;
+    int positional = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shm_id = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--gangs") == 0) {
+            show_gangs = true;
+        } else if (strcmp(argv[i], "--agents") == 0) {
+            show_agents = true;
+        } else if (argv[i][0] != '-' && positional == 0 && atof(argv[i]) > 0) {
+            interval = atof(argv[i]);
+            positional++;
+        } else if (argv[i][0] != '-' && positional == 1 && atol(argv[i]) > 0) {
+            count = atol(argv[i]);
+            positional++;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (shm_id == -1) {
+        shm_id = find_run();
+        if (shm_id == -1) {
+            fprintf(stderr, "No running simulation found; in-process runs cannot be watched\n");
+            return 1;
+        }
+    }
+    struct shmid_ds ds;
+    if (shmctl(shm_id, IPC_STAT, &ds) != 0) {
+        fprintf(stderr, "Shared memory %d: %s\n", shm_id, strerror(errno));
+        return 1;
+    }
+    SharedState *state = attach_run(shm_id, ds.shm_segsz);
+    if (!state) {
+        fprintf(stderr, "Shared memory %d is not a version %d simulation segment\n", shm_id, METRICS_VERSION);
+        return 1;
+    }
+
+    const MetricsHeader *metrics = shared_metrics(state);
+    Sample samples[2];
+    if (alloc_sample(&samples[0], &state->layout) != 0 || alloc_sample(&samples[1], &state->layout) != 0) {
+        return 1;
+    }
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    printf("# shm %d: pid %d, %d gangs, %d agents, ", shm_id, (int)metrics->owner_pid,
+           state->gang_count, state->agent_count);
+    if (metrics->time_scale == 0.0) {
+        printf("virtual clock\n");
+    } else {
+        printf("time scale %.1f\n", metrics->time_scale);
+    }
+
+    // The first line covers the run so far, from all-zero counters
+    Sample *before = &samples[0], *now = &samples[1];
+    before->at_ns = metrics->clock_ns;
+    int lines = 0;
+
+    while (!stop_requested) {
+        take_sample(state, now);
+        if (lines % SIMSTAT_HEADER_EVERY == 0) {
+            print_header();
+        }
+        print_line(before, now);
+        if (show_gangs) {
+            print_gangs(state->gang_count, before, now);
+        }
+        if (show_agents) {
+            print_agents(state->agent_count, before, now);
+        }
+        fflush(stdout);
+        lines++;
+
+        if ((count > 0 && lines >= count) || !run_alive(shm_id, state)) {
+            break;
+        }
+        Sample *swap = before;
+        before = now;
+        now = swap;
+        usleep((useconds_t)(interval * 1e6));
+    }
+
+    free_sample(&samples[0]);
+    free_sample(&samples[1]);
+    shmdt(state);
+    return 0;
+}
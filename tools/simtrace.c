@@ -0,0 +1,255 @@
+#include "../include/common.h"
+#include "../include/trace.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Reader for the binary event traces written with --trace. Lists the
+ * events, optionally filtered by type, gang and simulated time, counts
+ * them per type and gang, or replays them paced in simulated time.
+ */
+
+typedef struct {
+    unsigned int type_mask; /* Bit per TraceEventType, 0 = every type */
+    int gang_id;            /* -1 = events without a gang, -2 = every gang */
+    double from_s;
+    double to_s;            /* Negative = until the end */
+} TraceFilter;
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [options] trace_file\n", program_name);
+    printf("\n");
+    printf("Options:\n");
+    printf("  --type T[,T...]  Only events of these types\n");
+    printf("  --gang N         Only events of gang N (-1 for the police and the simulation)\n");
+    printf("  --from S         Only events at or after S simulated seconds\n");
+    printf("  --to S           Only events before S simulated seconds\n");
+    printf("  --stats          Count the events per type and per gang instead of listing them\n");
+    printf("  --replay SPEED   List the events paced at SPEED simulated seconds per wall second\n");
+    printf("\n");
+    printf("Event types:");
+    for (int i = TRACE_NONE + 1; i < TRACE_EVENT_TYPES; i++) {
+        printf(" %s", trace_event_name((TraceEventType)i));
+    }
+    printf("\n");
+}
+
+static int parse_types(char *list, unsigned int *mask) {
+    for (char *name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+        TraceEventType type;
+        if (!trace_event_from_name(name, &type)) {
+            fprintf(stderr, "Unknown event type '%s'\n", name);
+            return -1;
+        }
+        *mask |= 1u << type;
+    }
+    return 0;
+}
+
+static bool filter_matches(const TraceFilter *filter, const TraceRecord *record) {
+    double at = record->sim_ms / 1000.0;
+    if (record->type == TRACE_NONE) {
+        return false;  // Claimed but never written
+    }
+    if (filter->type_mask && !(filter->type_mask & (1u << record->type))) {
+        return false;
+    }
+    if (filter->gang_id != -2 && record->gang_id != filter->gang_id) {
+        return false;
+    }
+    return at >= filter->from_s && (filter->to_s < 0 || at < filter->to_s);
+}
+
+static void print_record(const TraceRecord *record) {
+    printf("%10.3f  ", record->sim_ms / 1000.0);
+    if (record->gang_id >= 0) {
+        printf("gang %-3d ", record->gang_id);
+    } else {
+        printf("%-8s ", "-");
+    }
+    printf("%-18s", trace_event_name((TraceEventType)record->type));
+
+    switch (record->type) {
+    case TRACE_MISSION_CREATED:
+        printf(" mission=%d target=%s members=%d preparation=%.2f", record->subject,
+               get_target_name((CrimeTarget)record->arg), record->detail, record->value);
+        break;
+    case TRACE_MISSION_SUCCEEDED:
+    case TRACE_MISSION_FAILED:
+    case TRACE_MISSION_ABANDONED:
+        printf(" mission=%d target=%s", record->subject, get_target_name((CrimeTarget)record->arg));
+        break;
+    case TRACE_MEMBER_ARRESTED:
+        printf(" member=%d seconds=%d mission=%d", record->subject, record->arg, record->detail);
+        break;
+    case TRACE_MEMBER_KILLED:
+        printf(" member=%d mission=%d", record->subject, record->detail);
+        break;
+    case TRACE_MEMBER_RELEASED:
+    case TRACE_MEMBER_RECRUITED:
+        printf(" member=%d", record->subject);
+        break;
+    case TRACE_MEMBER_PROMOTED:
+        printf(" member=%d rank=%d", record->subject, record->arg);
+        break;
+    case TRACE_AGENT_REPORT:
+        printf(" agent=%d target=%s mission=%d confidence=%.2f", record->subject,
+               get_target_name((CrimeTarget)record->arg), record->detail, record->value);
+        break;
+    case TRACE_POLICE_ACTION:
+        printf(" seconds=%d", record->arg);
+        break;
+    case TRACE_AGENT_EXECUTED:
+        printf(" agent=%d member=%d", record->subject, record->detail);
+        break;
+    case TRACE_SIMULATION_END:
+        printf(" status=%s", simulation_status_to_string((SimulationStatus)record->arg));
+        break;
+    }
+    printf("\n");
+}
+
+static void print_stats(const TraceHeader *header, const TraceRecord *records, size_t count,
+                        const TraceFilter *filter) {
+    int gangs = header->gang_count;
+    // One row per gang, plus one for events without a gang
+    long *counts = calloc((size_t)(gangs + 1) * TRACE_EVENT_TYPES, sizeof(long));
+    long totals[TRACE_EVENT_TYPES] = {0};
+    if (!counts) {
+        perror("calloc");
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const TraceRecord *record = &records[i];
+        if (!filter_matches(filter, record) || record->type >= TRACE_EVENT_TYPES) {
+            continue;
+        }
+        int row = record->gang_id >= 0 && record->gang_id < gangs ? record->gang_id : gangs;
+        counts[(size_t)row * TRACE_EVENT_TYPES + record->type]++;
+        totals[record->type]++;
+    }
+
+    for (int type = TRACE_NONE + 1; type < TRACE_EVENT_TYPES; type++) {
+        printf("%s=%ld\n", trace_event_name((TraceEventType)type), totals[type]);
+    }
+    for (int row = 0; row < gangs; row++) {
+        for (int type = TRACE_NONE + 1; type < TRACE_EVENT_TYPES; type++) {
+            long n = counts[(size_t)row * TRACE_EVENT_TYPES + type];
+            if (n > 0) {
+                printf("gang.%d.%s=%ld\n", row, trace_event_name((TraceEventType)type), n);
+            }
+        }
+    }
+    free(counts);
+}
+
+int main(int argc, char *argv[]) {
+    TraceFilter filter = { .type_mask = 0, .gang_id = -2, .from_s = 0.0, .to_s = -1.0 };
+    const char *path = NULL;
+    bool stats = false;
+    double replay_speed = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--type") == 0 && i + 1 < argc) {
+            if (parse_types(argv[++i], &filter.type_mask) != 0) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--gang") == 0 && i + 1 < argc) {
+            filter.gang_id = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            filter.from_s = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            filter.to_s = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            replay_speed = atof(argv[++i]);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!path) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+        fprintf(stderr, "%s is not a trace file\n", path);
+        close(fd);
+        return 1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    const TraceHeader *header = (const TraceHeader *)map;
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != TRACE_VERSION || header->record_size != sizeof(TraceRecord)) {
+        fprintf(stderr, "%s is not a version %d trace file\n", path, TRACE_VERSION);
+        munmap(map, st.st_size);
+        return 1;
+    }
+
+    // A trace cut short (a killed run) is never trimmed; trust the file size last
+    const TraceRecord *records = (const TraceRecord *)((const char *)map + sizeof(TraceHeader));
+    size_t count = header->claimed < header->capacity ? header->claimed : header->capacity;
+    size_t fits = (st.st_size - sizeof(TraceHeader)) / sizeof(TraceRecord);
+    if (count > fits) {
+        count = fits;
+    }
+
+    time_t start = (time_t)header->start_time;
+    printf("# %s: %zu events, seed %u, %u gangs, ", path, count, header->seed, header->gang_count);
+    if (header->time_scale == 0.0f) {
+        printf("virtual clock, started %s", ctime(&start));
+    } else {
+        printf("time scale %.1f, started %s", header->time_scale, ctime(&start));
+    }
+    if (header->claimed > header->capacity) {
+        printf("# %llu events did not fit\n", (unsigned long long)(header->claimed - header->capacity));
+    }
+
+    if (stats) {
+        print_stats(header, records, count, &filter);
+    } else {
+        struct timespec wall_start;
+        clock_gettime(CLOCK_MONOTONIC, &wall_start);
+        for (size_t i = 0; i < count; i++) {
+            if (!filter_matches(&filter, &records[i])) {
+                continue;
+            }
+            if (replay_speed > 0) {
+                // Wait until the event is due at the replay speed
+                double due = (records[i].sim_ms / 1000.0 - filter.from_s) / replay_speed;
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                double elapsed = (now.tv_sec - wall_start.tv_sec) + (now.tv_nsec - wall_start.tv_nsec) / 1e9;
+                if (due > elapsed) {
+                    fflush(stdout);
+                    usleep((useconds_t)((due - elapsed) * 1e6));
+                }
+            }
+            print_record(&records[i]);
+        }
+    }
+
+    munmap(map, st.st_size);
+    return 0;
+}